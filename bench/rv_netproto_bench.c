@@ -0,0 +1,93 @@
+/*
+ * Parse throughput of rv_netproto.
+ *
+ *   rv_netproto_bench [iterations]
+ *
+ * "two-pass" is the path ingest used before rv_pkt_view_t: header parse
+ * followed by rv_parse_voice_packet, which parses the header again.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "rv_netproto.h"
+#include "rv_time.h"
+
+#define BENCH_PACKETS 64
+
+static uint8_t  g_pkts[BENCH_PACKETS][128];
+static int      g_lens[BENCH_PACKETS];
+static volatile uint32_t g_sink;
+
+static void build_packets(uint8_t wire_version) {
+    uint8_t opus[60];
+    for (int i = 0; i < (int)sizeof(opus); ++i) opus[i] = (uint8_t)(i * 13);
+
+    for (int i = 0; i < BENCH_PACKETS; ++i) {
+        g_lens[i] = rv_build_voice_packet_red(g_pkts[i], (int)sizeof(g_pkts[i]),
+                                              wire_version,
+                                              (uint16_t)(1 + i % 16), (uint16_t)i,
+                                              rv_flags_make(0, 0, 1),
+                                              NULL,
+                                              NULL,
+                                              NULL, 0,
+                                              opus, (uint16_t)sizeof(opus));
+    }
+}
+
+static double run_two_pass(long iters) {
+    uint32_t acc = 0;
+    const uint64_t t0 = rv_time_now_us();
+    for (long n = 0; n < iters; ++n) {
+        const uint8_t* p = g_pkts[n & (BENCH_PACKETS - 1)];
+        const int len = g_lens[n & (BENCH_PACKETS - 1)];
+
+        rv_pkt_hdr_t hdr;
+        if (rv_parse_packet_header(p, len, &hdr) != 0) continue;
+        if (hdr.type != RV_PKT_VOICE) continue;
+
+        uint16_t speaker = 0, seq = 0, plen = 0;
+        uint8_t flags = 0;
+        const uint8_t* payload = NULL;
+        if (rv_parse_voice_packet(p, len, &speaker, &seq, &flags, &payload, &plen) != 0) continue;
+        acc += speaker + seq + plen + payload[0];
+    }
+    const uint64_t t1 = rv_time_now_us();
+    g_sink = acc;
+    return (double)(t1 - t0);
+}
+
+static double run_view(long iters) {
+    uint32_t acc = 0;
+    const uint64_t t0 = rv_time_now_us();
+    for (long n = 0; n < iters; ++n) {
+        rv_pkt_view_t v;
+        if (rv_pkt_view_parse(g_pkts[n & (BENCH_PACKETS - 1)], g_lens[n & (BENCH_PACKETS - 1)], &v) != 0) continue;
+        if (v.type != RV_PKT_VOICE) continue;
+        acc += v.speaker_id + v.seq + v.payload_len + v.payload[0];
+    }
+    const uint64_t t1 = rv_time_now_us();
+    g_sink = acc;
+    return (double)(t1 - t0);
+}
+
+static void report(const char* name, long iters, double us) {
+    if (us <= 0.0) us = 1.0;
+    printf("  %-10s %8.2f Mpkt/s  %6.2f ns/pkt\n", name, (double)iters / us, us * 1000.0 / (double)iters);
+}
+
+int main(int argc, char** argv) {
+    long iters = 20000000;
+    if (argc >= 2) iters = strtol(argv[1], NULL, 10);
+    if (iters <= 0) iters = 20000000;
+
+    const uint8_t versions[2] = { RV_PROTO_VER, RV_PROTO_VER2 };
+    for (int i = 0; i < 2; ++i) {
+        build_packets(versions[i]);
+        printf("wire v%u (%d bytes/packet), %ld packets\n", (unsigned)versions[i], g_lens[0], iters);
+
+        (void)run_view(iters / 10); // warm up
+        report("two-pass", iters, run_two_pass(iters));
+        report("view", iters, run_view(iters));
+    }
+    return 0;
+}
@@ -0,0 +1,355 @@
+/*
+ * Relay load generator: S sessions of C clients against a running relay.
+ *
+ *   rv_relay_loadgen [port] [--relay=IP] [--sessions=S] [--clients=C] [--seconds=T]
+ *                    [--talk=PCT] [--payload=BYTES] [--bundle] [--relay-pid=PID]
+ *
+ * The relay defaults to 127.0.0.1 on port 40000, like residual_relay.
+ *
+ * Every client has its own socket and joins like the engine does. It then
+ * alternates talk spurts and pauses of exponential length (1 s mean talk,
+ * the pause mean set so clients talk PCT% of the time, 40 by default).
+ * While talking it sends one 20 ms frame every 20 ms: a v2 VOICE packet
+ * with the audio level and an RV_EXT_TS send timestamp. While silent it
+ * sends only the 5 s keepalive JOIN, as the engine does with DTX.
+ *
+ * Every VOICE packet that comes back, also inside a bundle (--bundle
+ * advertises them), counts as a forward. Its latency is the receive time
+ * minus the embedded timestamp, so it includes both loopback hops. With
+ * --relay-pid the relay's CPU time is read from /proc and reported per
+ * 1000 forwards per second.
+ *
+ * The generator runs on one thread. On a machine with fewer cores than
+ * relay shards + 1 it competes with the relay, so only compare runs made
+ * on the same machine.
+ */
+#define _GNU_SOURCE
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "rv_netproto.h"
+#include "rv_time.h"
+#include "rv_udp.h"
+
+#define LG_FRAME_MS       20
+#define LG_KEEPALIVE_US   5000000ull
+#define LG_TALK_MEAN_MS   1000.0
+#define LG_WARMUP_US      1000000ull
+#define LG_HIST_STEP_US   10u
+#define LG_HIST_BUCKETS   100000u      // 10 us steps up to 1 s, then one overflow bucket
+
+typedef struct lg_client {
+    rv_udp_socket_t* sock;
+    uint64_t session_id;
+    uint16_t player_id;
+    uint16_t seq;
+    uint16_t keepalives;
+    uint8_t  talking;
+    uint8_t  level;                // this spurt's audio level
+    uint64_t toggle_us;            // end of the current spurt or pause
+    uint64_t keepalive_us;         // next keepalive JOIN
+} lg_client_t;
+
+typedef struct lg_run {
+    lg_client_t* clients;
+    int count;
+    int session_size;
+    uint16_t caps;
+    int payload;
+    double pause_mean_ms;
+    rv_sockaddr_t relay;
+    uint64_t rng;
+
+    uint64_t measure_us;           // counting window [measure_us, end_us) of send times
+    uint64_t end_us;
+    uint64_t sent;                 // VOICE sent inside the window
+    uint64_t expected;             // forwards those should cause
+    uint64_t received;             // forwards of those received
+    uint64_t other;                // ACKs and anything else
+    uint64_t lat_max;
+    uint32_t* hist;                // latency, LG_HIST_STEP_US per bucket
+} lg_run_t;
+
+static uint64_t lg_rand(lg_run_t* run) {
+    uint64_t x = run->rng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    run->rng = x;
+    return x;
+}
+
+static uint64_t lg_exp_us(lg_run_t* run, double mean_ms) {
+    const double u = ((double)(lg_rand(run) >> 11) + 1.0) / 9007199254740993.0;   // (0, 1]
+    return (uint64_t)(-log(u) * mean_ms * 1000.0);
+}
+
+static void send_join(lg_run_t* run, lg_client_t* c, uint64_t now_us) {
+    uint8_t b[64];
+    const int n = c->keepalives == 0
+        ? rv_build_join_packet(b, (int)sizeof(b), c->session_id, c->player_id, run->caps)
+        : rv_build_keepalive_packet(b, (int)sizeof(b), c->session_id, c->player_id, run->caps, c->keepalives);
+    if (n > 0) (void)rv_udp_sendto(c->sock, &run->relay, b, n);
+    if (++c->keepalives == 0) c->keepalives = 1;
+    c->keepalive_us = now_us + LG_KEEPALIVE_US;
+}
+
+static void send_voice(lg_run_t* run, lg_client_t* c, uint64_t now_us) {
+    uint8_t payload[1200];
+    uint8_t b[1400];
+    memset(payload, (int)(c->seq & 0xFF), (size_t)run->payload);
+    const uint32_t ts = (uint32_t)now_us;
+    const int n = rv_build_voice_packet_red(b, (int)sizeof(b), RV_PROTO_VER2, c->player_id, c->seq++,
+                                            rv_flags_make(0, 0, 1), &ts, &c->level, NULL, 0,
+                                            payload, (uint16_t)run->payload);
+    if (n <= 0) return;
+    (void)rv_udp_sendto(c->sock, &run->relay, b, n);
+    if (now_us >= run->measure_us && now_us < run->end_us) {
+        run->sent++;
+        run->expected += (uint64_t)(run->session_size - 1);
+    }
+}
+
+// One client's 20 ms frame slot
+static void client_frame(lg_run_t* run, lg_client_t* c, uint64_t now_us) {
+    while (now_us >= c->toggle_us) {
+        c->talking = !c->talking;
+        c->level = (uint8_t)(20 + lg_rand(run) % 30);
+        c->toggle_us += lg_exp_us(run, c->talking ? LG_TALK_MEAN_MS : run->pause_mean_ms);
+    }
+    if (now_us >= c->keepalive_us) send_join(run, c, now_us);
+    if (c->talking) send_voice(run, c, now_us);
+}
+
+static void count_voice(lg_run_t* run, const uint8_t* pkt, int len, uint64_t now_us) {
+    rv_pkt_view_t v;
+    uint32_t ts = 0;
+    if (rv_pkt_view_parse(pkt, len, &v) != 0 || v.type != RV_PKT_VOICE || rv_pkt_view_take_ts(&v, &ts) != 1) {
+        run->other++;
+        return;
+    }
+    // Counted by when it was sent, like expected
+    if ((uint32_t)(ts - (uint32_t)run->measure_us) >= (uint32_t)(run->end_us - run->measure_us)) return;
+
+    const uint32_t lat = (uint32_t)now_us - ts;
+    uint32_t b = lat / LG_HIST_STEP_US;
+    if (b > LG_HIST_BUCKETS) b = LG_HIST_BUCKETS;
+    run->hist[b]++;
+    if (lat > run->lat_max) run->lat_max = lat;
+    run->received++;
+}
+
+static void drain(lg_run_t* run, lg_client_t* c) {
+    static uint8_t bufs[RV_UDP_BATCH_MAX][1500];
+    rv_udp_msg_t msgs[RV_UDP_BATCH_MAX];
+    for (;;) {
+        for (int i = 0; i < RV_UDP_BATCH_MAX; ++i) {
+            msgs[i].data = bufs[i];
+            msgs[i].cap = (int)sizeof(bufs[i]);
+        }
+        const int n = rv_udp_recv_batch(c->sock, msgs, RV_UDP_BATCH_MAX);
+        if (n <= 0) return;
+
+        const uint64_t now = rv_time_now_us();
+        for (int i = 0; i < n; ++i) {
+            rv_pkt_view_t v;
+            if (rv_pkt_view_parse(msgs[i].data, msgs[i].len, &v) == 0 && v.type == RV_PKT_BUNDLE) {
+                uint32_t pos = 0;
+                const uint8_t* inner;
+                uint16_t inner_len;
+                while (rv_pkt_view_bundle_next(&v, &pos, &inner, &inner_len) == 1)
+                    count_voice(run, inner, inner_len, now);
+            } else {
+                count_voice(run, msgs[i].data, msgs[i].len, now);
+            }
+        }
+        if (n < RV_UDP_BATCH_MAX) return;
+    }
+}
+
+static uint64_t percentile(const lg_run_t* run, double p) {
+    if (run->received == 0) return 0;
+    const uint64_t rank = (uint64_t)ceil(p * (double)run->received);
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b <= LG_HIST_BUCKETS; ++b) {
+        seen += run->hist[b];
+        if (seen < rank) continue;
+        const uint64_t upper = (uint64_t)(b + 1) * LG_HIST_STEP_US;   // bucket's upper edge
+        return b == LG_HIST_BUCKETS || upper > run->lat_max ? run->lat_max : upper;
+    }
+    return run->lat_max;
+}
+
+// utime + stime of pid in microseconds, or -1
+static double proc_cpu_us(int pid) {
+    char path[64], line[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE* f = fopen(path, "r");
+    if (!f) return -1.0;
+    const int ok = fgets(line, sizeof(line), f) != NULL;
+    fclose(f);
+    const char* p = ok ? strrchr(line, ')') : NULL;
+    if (!p) return -1.0;
+
+    // Fields after the command name start with state (3); utime is 14
+    unsigned long long utime = 0, stime = 0;
+    if (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2)
+        return -1.0;
+    return (double)(utime + stime) * 1e6 / (double)sysconf(_SC_CLK_TCK);
+}
+
+static double self_cpu_us(void) {
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0.0;
+    return (double)ru.ru_utime.tv_sec * 1e6 + (double)ru.ru_utime.tv_usec +
+           (double)ru.ru_stime.tv_sec * 1e6 + (double)ru.ru_stime.tv_usec;
+}
+
+int main(int argc, char** argv) {
+    const char* host = "127.0.0.1";
+    uint16_t port = 40000;
+    int sessions = 10, clients = 10, seconds = 10, talk_pct = 40, payload = 60, relay_pid = 0;
+    uint16_t caps = RV_CAP_V2;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--sessions=", 11) == 0) sessions = atoi(argv[i] + 11);
+        else if (strncmp(argv[i], "--clients=", 10) == 0) clients = atoi(argv[i] + 10);
+        else if (strncmp(argv[i], "--seconds=", 10) == 0) seconds = atoi(argv[i] + 10);
+        else if (strncmp(argv[i], "--talk=", 7) == 0) talk_pct = atoi(argv[i] + 7);
+        else if (strncmp(argv[i], "--payload=", 10) == 0) payload = atoi(argv[i] + 10);
+        else if (strncmp(argv[i], "--relay-pid=", 12) == 0) relay_pid = atoi(argv[i] + 12);
+        else if (strcmp(argv[i], "--bundle") == 0) caps |= RV_CAP_BUNDLE;
+        else if (strncmp(argv[i], "--relay=", 8) == 0) host = argv[i] + 8;
+        else if (argv[i][0] != '-') port = (uint16_t)atoi(argv[i]);
+        else {
+            fprintf(stderr, "usage: %s [port] [--relay=IP] [--sessions=S] [--clients=C] [--seconds=T] "
+                            "[--talk=PCT] [--payload=BYTES] [--bundle] [--relay-pid=PID]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (sessions < 1 || clients < 2 || clients > 65535 || seconds < 1 || seconds > 3600 ||
+        talk_pct < 1 || talk_pct > 100 || payload < 1 || payload > 1200) {
+        fprintf(stderr, "loadgen: needs S >= 1, 2 <= C <= 65535, 1 <= T <= 3600, 1 <= PCT <= 100, 1 <= BYTES <= 1200\n");
+        return 1;
+    }
+
+    lg_run_t run;
+    memset(&run, 0, sizeof(run));
+    run.count = sessions * clients;
+    run.session_size = clients;
+    run.caps = caps;
+    run.payload = payload;
+    run.pause_mean_ms = LG_TALK_MEAN_MS * (double)(100 - talk_pct) / (double)talk_pct;
+    run.rng = rv_time_now_us() * 0x9e3779b97f4a7c15ull | 1u;
+    if (rv_udp_startup() != 0 || rv_parse_ip_port(host, port, &run.relay) != 0) {
+        fprintf(stderr, "loadgen: %s is not an IP address\n", host);
+        return 1;
+    }
+
+    // One descriptor per client, plus stdio and epoll
+    struct rlimit nofile;
+    if (getrlimit(RLIMIT_NOFILE, &nofile) == 0 && nofile.rlim_cur < (rlim_t)run.count + 16) {
+        nofile.rlim_cur = nofile.rlim_max;
+        (void)setrlimit(RLIMIT_NOFILE, &nofile);
+        if (nofile.rlim_cur < (rlim_t)run.count + 16) {
+            fprintf(stderr, "loadgen: %d clients need more open files than the limit (%llu)\n",
+                    run.count, (unsigned long long)nofile.rlim_cur);
+            return 1;
+        }
+    }
+
+    run.clients = (lg_client_t*)calloc((size_t)run.count, sizeof(lg_client_t));
+    run.hist = (uint32_t*)calloc(LG_HIST_BUCKETS + 1, sizeof(uint32_t));
+    const int ep = epoll_create1(0);
+    if (!run.clients || !run.hist || ep < 0) {
+        fprintf(stderr, "loadgen: out of memory\n");
+        return 1;
+    }
+
+    // Fresh session ids, so sessions a previous run left on the relay stay apart
+    const uint64_t session_base = lg_rand(&run) & 0xFFFFFFFF00000000ull;
+    uint64_t now = rv_time_now_us();
+    for (int i = 0; i < run.count; ++i) {
+        lg_client_t* c = &run.clients[i];
+        c->sock = rv_udp_create_dualstack(0, 1 /*nonblocking*/);
+        if (!c->sock) {
+            fprintf(stderr, "loadgen: could not open socket %d\n", i);
+            return 1;
+        }
+        c->session_id = session_base + (uint64_t)(i / clients);
+        c->player_id = (uint16_t)(1 + i % clients);
+        c->talking = lg_rand(&run) % 100 < (uint64_t)talk_pct;
+        c->toggle_us = now + lg_exp_us(&run, c->talking ? LG_TALK_MEAN_MS : run.pause_mean_ms);
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u32 = (uint32_t)i;
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, rv_udp_fd(c->sock), &ev) != 0) {
+            fprintf(stderr, "loadgen: epoll_ctl failed\n");
+            return 1;
+        }
+        send_join(&run, c, now);
+    }
+
+    printf("loadgen: %d sessions x %d clients, talking %d%%, %d-byte frames, %s, %d s after %llu ms warm-up\n",
+           sessions, clients, talk_pct, payload, (caps & RV_CAP_BUNDLE) ? "bundles" : "no bundles",
+           seconds, (unsigned long long)(LG_WARMUP_US / 1000));
+
+    // Client i sends in millisecond i % LG_FRAME_MS of every frame, so the
+    // load is spread over the frame instead of arriving in one burst
+    now = rv_time_now_us();
+    run.measure_us = now + LG_WARMUP_US;
+    run.end_us = run.measure_us + (uint64_t)seconds * 1000000u;
+    const uint64_t stop_us = run.end_us + 200000u;   // late forwards still drain
+    uint64_t ms = now / 1000u;
+    double relay_cpu0 = -1.0, self_cpu0 = 0.0;
+    int measuring = 0;
+
+    struct epoll_event evs[256];
+    while (now < stop_us) {
+        if (!measuring && now >= run.measure_us) {
+            measuring = 1;
+            relay_cpu0 = relay_pid ? proc_cpu_us(relay_pid) : -1.0;
+            self_cpu0 = self_cpu_us();
+        }
+        for (; ms <= now / 1000u; ++ms) {
+            if (ms * 1000u >= run.end_us) break;
+            for (int i = (int)(ms % LG_FRAME_MS); i < run.count; i += LG_FRAME_MS)
+                client_frame(&run, &run.clients[i], now);
+        }
+
+        const int n = epoll_wait(ep, evs, 256, 1);
+        for (int i = 0; i < n; ++i) drain(&run, &run.clients[evs[i].data.u32]);
+        now = rv_time_now_us();
+    }
+
+    const double secs = (double)seconds;
+    const double relay_cpu1 = relay_pid ? proc_cpu_us(relay_pid) : -1.0;
+    const double self_cpu = self_cpu_us() - self_cpu0;
+    const double fwd_pps = (double)run.received / secs;
+    printf("sent      %.0f voice pkt/s\n", (double)run.sent / secs);
+    printf("forwarded %.0f pkt/s (expected %.0f, %.2f%% missing)\n", fwd_pps, (double)run.expected / secs,
+           run.expected ? 100.0 * (1.0 - (double)run.received / (double)run.expected) : 0.0);
+    printf("latency   p50 %llu us  p99 %llu us  p999 %llu us  max %llu us\n",
+           (unsigned long long)percentile(&run, 0.50), (unsigned long long)percentile(&run, 0.99),
+           (unsigned long long)percentile(&run, 0.999), (unsigned long long)run.lat_max);
+    if (relay_cpu0 >= 0.0 && relay_cpu1 >= relay_cpu0) {
+        const double core = (relay_cpu1 - relay_cpu0) / (secs * 1e6);
+        printf("relay cpu %.1f%% of a core, %.3f%% per 1k forwarded pkt/s\n", core * 100.0,
+               fwd_pps > 0.0 ? core * 100.0 / (fwd_pps / 1000.0) : 0.0);
+    } else if (relay_pid) {
+        printf("relay cpu unavailable (no /proc/%d/stat)\n", relay_pid);
+    }
+    printf("loadgen cpu %.1f%% of a core\n", self_cpu / (secs * 1e6) * 100.0);
+
+    for (int i = 0; i < run.count; ++i) rv_udp_destroy(run.clients[i].sock);
+    close(ep);
+    free(run.clients);
+    free(run.hist);
+    rv_udp_cleanup();
+    return 0;
+}
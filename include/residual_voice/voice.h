@@ -28,7 +28,7 @@ extern "C" {
    API versioning
    =========================== */
 #define RV_VOICE_API_VERSION_MAJOR 2u
-#define RV_VOICE_API_VERSION_MINOR 1u
+#define RV_VOICE_API_VERSION_MINOR 7u
 #define RV_VOICE_API_VERSION \
     ((RV_VOICE_API_VERSION_MAJOR << 16) | RV_VOICE_API_VERSION_MINOR)
 
@@ -46,6 +46,15 @@ extern "C" {
 #define RV_VOICE_FLAG_CH_MASK  (0x0Fu << RV_VOICE_FLAG_CH_SHIFT)
 #define RV_VOICE_FLAG_PTT      0x20u
 
+/* ===========================
+   Relay mix (API 2.7+)
+   =========================== */
+// A relay in mixing mode (residual_relay --mix) sends each client one
+// stream: everyone in the session but that client. Its SPEAKING and
+// PCM_FRAME events carry this speaker_id; it has no routing flags, so
+// play it as is, without radio or proximity effects.
+#define RV_VOICE_MIX_SPEAKER_ID 0u
+
 typedef struct rv_voice rv_voice_t;
 
 /* ===========================
@@ -124,6 +133,19 @@ typedef enum rv_voice_capture_mode {
     RV_VOICE_CAPTURE_ALWAYS_ON = 1
 } rv_voice_capture_mode_t;
 
+/*
+ * Voice activity detection for outgoing audio.
+ *
+ * AUTO enables it in ALWAYS_ON capture mode only (PTT is already a manual
+ * gate). While the detector reports silence nothing is encoded or sent;
+ * Opus DTX additionally suppresses near-silent frames inside the hangover.
+ */
+typedef enum rv_voice_vad_mode {
+    RV_VOICE_VAD_AUTO = 0,
+    RV_VOICE_VAD_OFF = 1,
+    RV_VOICE_VAD_ON = 2
+} rv_voice_vad_mode_t;
+
 typedef struct rv_voice_event_pcm {
     uint16_t speaker_id;
     uint32_t sample_rate;
@@ -190,7 +212,8 @@ typedef struct rv_voice_config {
     uint32_t jitter_target_ms;
     uint32_t jitter_max_ms;
     rv_voice_capture_mode_t capture_mode;
-    uint32_t reserved_u32[8]; // ABI padding
+    uint32_t vad_mode;        // rv_voice_vad_mode_t (API 2.2+)
+    uint32_t reserved_u32[7]; // ABI padding
 } rv_voice_config_t;
 
 typedef struct rv_voice_connect_info {
@@ -216,6 +239,113 @@ typedef struct rv_voice_player_state {
 } rv_voice_player_state_t;
 
 
+/* ===========================
+   Encoder control (API 2.3+)
+   =========================== */
+typedef enum rv_voice_signal_type {
+    RV_VOICE_SIGNAL_AUTO = 0,
+    RV_VOICE_SIGNAL_VOICE = 1,
+    RV_VOICE_SIGNAL_MUSIC = 2
+} rv_voice_signal_type_t;
+
+/*
+ * With adaptive = 0 the values are applied as-is.
+ *
+ * With adaptive = 1 a closed-loop controller owns the live values:
+ *   bitrate_bps       ceiling; backed off under remote loss, probed up when clean
+ *   complexity        ceiling; dropped when encode time eats into the frame budget
+ *   use_fec           permission; in-band FEC is toggled with measured loss
+ *   expected_loss_pct floor for the measured loss handed to Opus
+ *   red_depth         ceiling; redundancy grows with measured loss
+ *
+ * red_depth > 0 makes every voice packet also carry low-bitrate copies of
+ * the previous 1-2 frames, so receivers can fill burst losses that in-band
+ * FEC (one frame) cannot. All receivers must run API 2.3+ to decode it.
+ *
+ * frames_per_packet 2-3 joins that many 20 ms frames into one Opus packet:
+ * up to 3x fewer datagrams and header bytes, for up to (n-1) frames of
+ * added send latency. Same receiver requirement as red_depth.
+ */
+typedef struct rv_voice_encoder_params {
+    uint32_t bitrate_bps;        // 6000..510000
+    uint32_t complexity;         // 0..10
+    uint8_t  use_fec;            // Opus in-band FEC (LBRR)
+    uint8_t  expected_loss_pct;  // 0..100
+    uint8_t  signal_type;        // rv_voice_signal_type_t
+    uint8_t  adaptive;           // 0/1
+    uint8_t  red_depth;          // 0..2 redundant frames per packet
+    uint8_t  frames_per_packet;  // 1..3 (0 = 1)
+    uint8_t  reserved_u8[2];     // ABI padding
+    uint32_t reserved_u32[3];    // ABI padding
+} rv_voice_encoder_params_t;
+
+/* ===========================
+   Statistics (API 2.4+)
+   =========================== */
+
+/*
+ * Receivers send a REPORT to every active sender about once a second, so
+ * both directions of each peer pair are covered:
+ *   rx_*  what we measured on this speaker's stream
+ *   tx_*  what this speaker last reported about our stream
+ * Loss counts frames that never arrived, even if RED/FEC concealed them.
+ * Jitter and RTT need the sender timestamp, which is only sent once the
+ * session has negotiated the v2 wire header; until then they read 0.
+ */
+typedef struct rv_voice_peer_stats {
+    uint16_t speaker_id;
+    uint8_t  rx_loss_pct;        // last report interval, 0..100
+    uint8_t  tx_loss_pct;        // last report interval, 0..100
+
+    uint32_t rx_frames;          // frames received
+    uint32_t rx_lost;            // cumulative frames lost
+    uint32_t rx_jitter_us;       // interarrival jitter
+
+    uint32_t tx_lost;            // cumulative, as reported
+    uint32_t tx_jitter_us;
+    uint32_t rtt_us;             // smoothed, 0 = unknown
+
+    uint32_t reserved_u32[4];    // ABI padding
+} rv_voice_peer_stats_t;
+
+typedef struct rv_voice_stats {
+    uint32_t tx_packets;
+    uint32_t tx_bytes;
+    uint32_t rx_packets;         // voice packets accepted
+    uint32_t rx_bytes;
+
+    uint32_t remote_loss_pct;    // worst recent tx_loss_pct over all peers
+    uint32_t rtt_us;             // worst smoothed RTT over all peers
+
+    uint32_t rx_auth_failures;   // sealed voice dropped: bad tag or replay
+
+    uint32_t reserved_u32[5];    // ABI padding
+} rv_voice_stats_t;
+
+/* ===========================
+   Relay interest (API 2.6+)
+   =========================== */
+
+/*
+ * What this client wants to hear, registered with the relay so it can skip
+ * forwards nobody would play:
+ *   radio voice  only on channels set in radio_channel_mask (bit = channel)
+ *   proximity    only from speakers within hearing_range of position, or
+ *                everywhere when has_position is 0
+ * Positions travel as whole units in -32767..32767 and the relay buckets
+ * them on a coarse grid, so the filter is conservative: the client still
+ * does the exact distance falloff.
+ */
+typedef struct rv_voice_interest {
+    uint16_t  radio_channel_mask;
+    uint8_t   has_position;
+    uint8_t   reserved;
+    rv_vec3_t position;
+    float     hearing_range;     // same units as position, 0 = unlimited
+
+    uint32_t reserved_u32[4];    // ABI padding
+} rv_voice_interest_t;
+
 /*
  * Managed-friendly event polling.
  *
@@ -284,6 +414,74 @@ RV_VOICE_API rv_voice_result_t
 rv_voice_set_local_state(rv_voice_t* v,
                          const rv_voice_player_state_t* st);
 
+/* ===========================
+   Encoder control
+   =========================== */
+RV_VOICE_API rv_voice_result_t
+rv_voice_set_encoder_params(rv_voice_t* v,
+                            const rv_voice_encoder_params_t* params);
+
+/*
+ * Returns the values currently applied to the encoder. With the adaptive
+ * controller on these are its live decisions, not the configured ceilings.
+ */
+RV_VOICE_API rv_voice_result_t
+rv_voice_get_encoder_params(rv_voice_t* v,
+                            rv_voice_encoder_params_t* out_params);
+
+/*
+ * Feed a receiver-side loss measurement (percent of our packets lost on
+ * the way to listeners) into the adaptive controller. Ignored unless
+ * adaptive mode is on. REPORT packets from peers feed it automatically;
+ * this is for hosts with telemetry of their own.
+ */
+RV_VOICE_API rv_voice_result_t
+rv_voice_report_remote_loss(rv_voice_t* v, uint32_t loss_pct);
+
+/* ===========================
+   Encryption
+   =========================== */
+#define RV_VOICE_SESSION_KEY_BYTES 32u
+
+/*
+ * Seal voice payloads with ChaCha20-Poly1305 under a 32-byte key shared
+ * by every member of the session (the relay never sees it). Once set,
+ * unsealed voice is dropped; NULL turns encryption off again.
+ *
+ * Nonces are derived from the sequence number, so use a fresh key for
+ * every session join: a client that restarts and rejoins under an old
+ * key would repeat nonces.
+ */
+RV_VOICE_API rv_voice_result_t
+rv_voice_set_session_key(rv_voice_t* v,
+                         const uint8_t* key,
+                         uint32_t key_len);
+
+/* ===========================
+   Relay interest
+   =========================== */
+
+/*
+ * Sent to the relay right away once connected, again whenever it changes
+ * (at most every 100 ms) and every couple of seconds as a refresh. Until
+ * the first call the relay forwards everything, as older clients expect.
+ */
+RV_VOICE_API rv_voice_result_t
+rv_voice_set_interest(rv_voice_t* v,
+                      const rv_voice_interest_t* interest);
+
+/* ===========================
+   Statistics
+   =========================== */
+RV_VOICE_API rv_voice_result_t
+rv_voice_get_stats(rv_voice_t* v, rv_voice_stats_t* out_stats);
+
+// speaker_id 1..max_players
+RV_VOICE_API rv_voice_result_t
+rv_voice_get_peer_stats(rv_voice_t* v,
+                        uint16_t speaker_id,
+                        rv_voice_peer_stats_t* out_stats);
+
 /* ===========================
    Transport-agnostic networking
    =========================== */
@@ -351,6 +549,18 @@ static inline void rv_voice_config_init(rv_voice_config_t* cfg) {
     cfg->frame_ms = 20;
     cfg->max_players = 16;
     cfg->capture_mode = RV_VOICE_CAPTURE_PTT_ONLY;
+    cfg->vad_mode = RV_VOICE_VAD_AUTO;
+}
+
+static inline void rv_voice_encoder_params_init(rv_voice_encoder_params_t* p) {
+    memset(p, 0, sizeof(*p));
+    p->bitrate_bps = 20000;
+    p->complexity = 9;
+    p->use_fec = 1;
+    p->expected_loss_pct = 5;
+    p->signal_type = RV_VOICE_SIGNAL_AUTO;
+    p->adaptive = 0;
+    p->frames_per_packet = 1;
 }
 
 static inline void rv_voice_player_state_init(rv_voice_player_state_t* st) {
@@ -359,6 +569,12 @@ static inline void rv_voice_player_state_init(rv_voice_player_state_t* st) {
     st->radio_channel = 0;
 }
 
+static inline void rv_voice_interest_init(rv_voice_interest_t* in) {
+    memset(in, 0, sizeof(*in));
+    in->radio_channel_mask = 0xFFFFu;
+    in->has_position = 0;
+}
+
 static inline void rv_voice_connect_info_init(rv_voice_connect_info_t* ci) {
     memset(ci, 0, sizeof(*ci));
     ci->relay_host = "127.0.0.1";
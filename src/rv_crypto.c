@@ -0,0 +1,478 @@
+#include "rv_crypto.h"
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RV_CRYPTO_SSE2 1
+#else
+#define RV_CRYPTO_SSE2 0
+#endif
+
+static inline uint32_t rv_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void rv_store_le32(uint8_t* p, uint32_t x) {
+    p[0] = (uint8_t)x;
+    p[1] = (uint8_t)(x >> 8);
+    p[2] = (uint8_t)(x >> 16);
+    p[3] = (uint8_t)(x >> 24);
+}
+
+static inline void rv_store_le64(uint8_t* p, uint64_t x) {
+    rv_store_le32(p, (uint32_t)x);
+    rv_store_le32(p + 4, (uint32_t)(x >> 32));
+}
+
+/* ============================================================
+   ChaCha20: four consecutive blocks per call
+   ============================================================ */
+
+#define RV_CHACHA_BLOCK   64
+#define RV_CHACHA_BATCH   (4 * RV_CHACHA_BLOCK)
+
+static void rv_chacha_state(uint32_t s[16], const rv_aead_key_t* key, const uint8_t nonce[12], uint32_t counter) {
+    s[0] = 0x61707865u;
+    s[1] = 0x3320646eu;
+    s[2] = 0x79622d32u;
+    s[3] = 0x6b206574u;
+    for (int i = 0; i < 8; ++i) s[4 + i] = key->k[i];
+    s[12] = counter;
+    s[13] = rv_le32(nonce);
+    s[14] = rv_le32(nonce + 4);
+    s[15] = rv_le32(nonce + 8);
+}
+
+#if RV_CRYPTO_SSE2
+
+#define RV_ROTL4(x, n) _mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32 - (n)))
+
+#define RV_QR4(a, b, c, d)                                                  \
+    do {                                                                    \
+        a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = RV_ROTL4(d, 16); \
+        c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = RV_ROTL4(b, 12); \
+        a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = RV_ROTL4(d, 8);  \
+        c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = RV_ROTL4(b, 7);  \
+    } while (0)
+
+/*
+ * Lane n of x[i] is word i of block counter + n. After the rounds each
+ * group of four words is transposed back into per-block order.
+ */
+static void rv_chacha20_x4(const rv_aead_key_t* key, const uint8_t nonce[12], uint32_t counter,
+                           uint8_t out[RV_CHACHA_BATCH])
+{
+    uint32_t s[16];
+    rv_chacha_state(s, key, nonce, counter);
+
+    __m128i x[16], in[16];
+    for (int i = 0; i < 16; ++i) in[i] = _mm_set1_epi32((int)s[i]);
+    in[12] = _mm_add_epi32(in[12], _mm_set_epi32(3, 2, 1, 0));
+    for (int i = 0; i < 16; ++i) x[i] = in[i];
+
+    for (int r = 0; r < 10; ++r) {
+        RV_QR4(x[0], x[4], x[8],  x[12]);
+        RV_QR4(x[1], x[5], x[9],  x[13]);
+        RV_QR4(x[2], x[6], x[10], x[14]);
+        RV_QR4(x[3], x[7], x[11], x[15]);
+        RV_QR4(x[0], x[5], x[10], x[15]);
+        RV_QR4(x[1], x[6], x[11], x[12]);
+        RV_QR4(x[2], x[7], x[8],  x[13]);
+        RV_QR4(x[3], x[4], x[9],  x[14]);
+    }
+
+    for (int g = 0; g < 4; ++g) {
+        const __m128i a = _mm_add_epi32(x[4 * g + 0], in[4 * g + 0]);
+        const __m128i b = _mm_add_epi32(x[4 * g + 1], in[4 * g + 1]);
+        const __m128i c = _mm_add_epi32(x[4 * g + 2], in[4 * g + 2]);
+        const __m128i d = _mm_add_epi32(x[4 * g + 3], in[4 * g + 3]);
+
+        const __m128i ab_lo = _mm_unpacklo_epi32(a, b);
+        const __m128i cd_lo = _mm_unpacklo_epi32(c, d);
+        const __m128i ab_hi = _mm_unpackhi_epi32(a, b);
+        const __m128i cd_hi = _mm_unpackhi_epi32(c, d);
+
+        uint8_t* o = out + 16 * g;
+        _mm_storeu_si128((__m128i*)(void*)(o + 0 * RV_CHACHA_BLOCK), _mm_unpacklo_epi64(ab_lo, cd_lo));
+        _mm_storeu_si128((__m128i*)(void*)(o + 1 * RV_CHACHA_BLOCK), _mm_unpackhi_epi64(ab_lo, cd_lo));
+        _mm_storeu_si128((__m128i*)(void*)(o + 2 * RV_CHACHA_BLOCK), _mm_unpacklo_epi64(ab_hi, cd_hi));
+        _mm_storeu_si128((__m128i*)(void*)(o + 3 * RV_CHACHA_BLOCK), _mm_unpackhi_epi64(ab_hi, cd_hi));
+    }
+}
+
+#else
+
+#define RV_ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define RV_QR(a, b, c, d)                                     \
+    do {                                                      \
+        a += b; d ^= a; d = RV_ROTL32(d, 16);                 \
+        c += d; b ^= c; b = RV_ROTL32(b, 12);                 \
+        a += b; d ^= a; d = RV_ROTL32(d, 8);                  \
+        c += d; b ^= c; b = RV_ROTL32(b, 7);                  \
+    } while (0)
+
+static void rv_chacha20_x4(const rv_aead_key_t* key, const uint8_t nonce[12], uint32_t counter,
+                           uint8_t out[RV_CHACHA_BATCH])
+{
+    uint32_t s[16];
+    rv_chacha_state(s, key, nonce, counter);
+
+    for (int blk = 0; blk < 4; ++blk) {
+        uint32_t x[16];
+        memcpy(x, s, sizeof(x));
+        x[12] = s[12] + (uint32_t)blk;
+
+        for (int r = 0; r < 10; ++r) {
+            RV_QR(x[0], x[4], x[8],  x[12]);
+            RV_QR(x[1], x[5], x[9],  x[13]);
+            RV_QR(x[2], x[6], x[10], x[14]);
+            RV_QR(x[3], x[7], x[11], x[15]);
+            RV_QR(x[0], x[5], x[10], x[15]);
+            RV_QR(x[1], x[6], x[11], x[12]);
+            RV_QR(x[2], x[7], x[8],  x[13]);
+            RV_QR(x[3], x[4], x[9],  x[14]);
+        }
+
+        uint8_t* o = out + blk * RV_CHACHA_BLOCK;
+        for (int i = 0; i < 16; ++i) {
+            const uint32_t base = i == 12 ? s[12] + (uint32_t)blk : s[i];
+            rv_store_le32(o + 4 * i, x[i] + base);
+        }
+    }
+}
+
+#endif
+
+const char* rv_crypto_impl(void) {
+    return RV_CRYPTO_SSE2 ? "sse2" : "scalar";
+}
+
+static void rv_xor_bytes(uint8_t* out, const uint8_t* in, const uint8_t* ks, size_t n) {
+    size_t i = 0;
+    for (; i + 8u <= n; i += 8u) {
+        uint64_t a, b;
+        memcpy(&a, in + i, 8);
+        memcpy(&b, ks + i, 8);
+        a ^= b;
+        memcpy(out + i, &a, 8);
+    }
+    for (; i < n; ++i) out[i] = (uint8_t)(in[i] ^ ks[i]);
+}
+
+/*
+ * ks holds blocks 0..3 of the nonce. Block 0 is the Poly1305 key, so the
+ * payload starts at block 1 and the batch continues from counter 4.
+ */
+static void rv_chacha20_xor(const rv_aead_key_t* key, const uint8_t nonce[12],
+                            uint8_t ks[RV_CHACHA_BATCH],
+                            const uint8_t* in, uint8_t* out, size_t len)
+{
+    size_t n = len < RV_CHACHA_BATCH - RV_CHACHA_BLOCK ? len : RV_CHACHA_BATCH - RV_CHACHA_BLOCK;
+    rv_xor_bytes(out, in, ks + RV_CHACHA_BLOCK, n);
+
+    uint32_t counter = 4;
+    for (size_t off = n; off < len; off += RV_CHACHA_BATCH, counter += 4u) {
+        rv_chacha20_x4(key, nonce, counter, ks);
+        n = len - off < RV_CHACHA_BATCH ? len - off : RV_CHACHA_BATCH;
+        rv_xor_bytes(out + off, in + off, ks, n);
+    }
+}
+
+/* ============================================================
+   Poly1305
+   ============================================================ */
+
+static inline uint64_t rv_le64(const uint8_t* p) {
+    return (uint64_t)rv_le32(p) | ((uint64_t)rv_le32(p + 4) << 32);
+}
+
+#if defined(__SIZEOF_INT128__)
+
+// 44/44/42-bit limbs: 3x3 multiplies per block instead of 5x5
+__extension__ typedef unsigned __int128 rv_u128;
+
+#define RV_M44 0xfffffffffffull
+#define RV_M42 0x3ffffffffffull
+
+typedef struct rv_poly1305 {
+    uint64_t r[3];
+    uint64_t h[3];
+    uint64_t pad[2];
+} rv_poly1305_t;
+
+static void rv_poly1305_init(rv_poly1305_t* st, const uint8_t key[32]) {
+    const uint64_t t0 = rv_le64(key);
+    const uint64_t t1 = rv_le64(key + 8);
+
+    // clamp r
+    st->r[0] = t0 & 0xffc0fffffffull;
+    st->r[1] = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffffull;
+    st->r[2] = (t1 >> 24) & 0x00ffffffc0full;
+
+    memset(st->h, 0, sizeof(st->h));
+    st->pad[0] = rv_le64(key + 16);
+    st->pad[1] = rv_le64(key + 24);
+}
+
+// Full 16-byte blocks; the AEAD pads everything it authenticates.
+static void rv_poly1305_blocks(rv_poly1305_t* st, const uint8_t* m, size_t nblocks) {
+    const uint64_t r0 = st->r[0], r1 = st->r[1], r2 = st->r[2];
+    const uint64_t s1 = r1 * (5u << 2), s2 = r2 * (5u << 2);
+    uint64_t h0 = st->h[0], h1 = st->h[1], h2 = st->h[2];
+
+    for (; nblocks; --nblocks, m += 16) {
+        const uint64_t t0 = rv_le64(m);
+        const uint64_t t1 = rv_le64(m + 8);
+        h0 += t0 & RV_M44;
+        h1 += ((t0 >> 44) | (t1 << 20)) & RV_M44;
+        h2 += ((t1 >> 24) & RV_M42) | (1ull << 40);
+
+        const rv_u128 d0 = (rv_u128)h0 * r0 + (rv_u128)h1 * s2 + (rv_u128)h2 * s1;
+        rv_u128 d1 = (rv_u128)h0 * r1 + (rv_u128)h1 * r0 + (rv_u128)h2 * s2;
+        rv_u128 d2 = (rv_u128)h0 * r2 + (rv_u128)h1 * r1 + (rv_u128)h2 * r0;
+
+        uint64_t c = (uint64_t)(d0 >> 44); h0 = (uint64_t)d0 & RV_M44;
+        d1 += c; c = (uint64_t)(d1 >> 44); h1 = (uint64_t)d1 & RV_M44;
+        d2 += c; c = (uint64_t)(d2 >> 42); h2 = (uint64_t)d2 & RV_M42;
+        h0 += c * 5u; c = h0 >> 44; h0 &= RV_M44;
+        h1 += c;
+    }
+
+    st->h[0] = h0; st->h[1] = h1; st->h[2] = h2;
+}
+
+static void rv_poly1305_finish(rv_poly1305_t* st, uint8_t tag[16]) {
+    uint64_t h0 = st->h[0], h1 = st->h[1], h2 = st->h[2];
+
+    uint64_t c = h1 >> 44; h1 &= RV_M44;
+    h2 += c; c = h2 >> 42; h2 &= RV_M42;
+    h0 += c * 5u; c = h0 >> 44; h0 &= RV_M44;
+    h1 += c; c = h1 >> 44; h1 &= RV_M44;
+    h2 += c; c = h2 >> 42; h2 &= RV_M42;
+    h0 += c * 5u; c = h0 >> 44; h0 &= RV_M44;
+    h1 += c;
+
+    // g = h - p; keep h if that went negative
+    uint64_t g0 = h0 + 5u; c = g0 >> 44; g0 &= RV_M44;
+    uint64_t g1 = h1 + c;  c = g1 >> 44; g1 &= RV_M44;
+    uint64_t g2 = h2 + c - (1ull << 42);
+
+    const uint64_t mask = (g2 >> 63) - 1u;
+    h0 = (h0 & ~mask) | (g0 & mask);
+    h1 = (h1 & ~mask) | (g1 & mask);
+    h2 = (h2 & ~mask) | (g2 & mask);
+
+    const uint64_t t0 = st->pad[0], t1 = st->pad[1];
+    h0 += t0 & RV_M44; c = h0 >> 44; h0 &= RV_M44;
+    h1 += (((t0 >> 44) | (t1 << 20)) & RV_M44) + c; c = h1 >> 44; h1 &= RV_M44;
+    h2 += ((t1 >> 24) & RV_M42) + c;
+
+    const uint64_t w0 = h0 | (h1 << 44);
+    const uint64_t w1 = (h1 >> 20) | (h2 << 24);
+    rv_store_le64(tag, w0);
+    rv_store_le64(tag + 8, w1);
+}
+
+#else
+
+// 26-bit limbs: no 128-bit multiply needed
+typedef struct rv_poly1305 {
+    uint32_t r[5];
+    uint32_t h[5];
+    uint32_t pad[4];
+} rv_poly1305_t;
+
+static void rv_poly1305_init(rv_poly1305_t* st, const uint8_t key[32]) {
+    const uint32_t t0 = rv_le32(key + 0);
+    const uint32_t t1 = rv_le32(key + 4);
+    const uint32_t t2 = rv_le32(key + 8);
+    const uint32_t t3 = rv_le32(key + 12);
+
+    // clamp r
+    st->r[0] = t0 & 0x3ffffffu;
+    st->r[1] = ((t0 >> 26) | (t1 << 6)) & 0x3ffff03u;
+    st->r[2] = ((t1 >> 20) | (t2 << 12)) & 0x3ffc0ffu;
+    st->r[3] = ((t2 >> 14) | (t3 << 18)) & 0x3f03fffu;
+    st->r[4] = (t3 >> 8) & 0x00fffffu;
+
+    memset(st->h, 0, sizeof(st->h));
+    for (int i = 0; i < 4; ++i) st->pad[i] = rv_le32(key + 16 + 4 * i);
+}
+
+// Full 16-byte blocks; the AEAD pads everything it authenticates.
+static void rv_poly1305_blocks(rv_poly1305_t* st, const uint8_t* m, size_t nblocks) {
+    const uint32_t r0 = st->r[0], r1 = st->r[1], r2 = st->r[2], r3 = st->r[3], r4 = st->r[4];
+    const uint32_t s1 = r1 * 5u, s2 = r2 * 5u, s3 = r3 * 5u, s4 = r4 * 5u;
+    uint32_t h0 = st->h[0], h1 = st->h[1], h2 = st->h[2], h3 = st->h[3], h4 = st->h[4];
+
+    for (; nblocks; --nblocks, m += 16) {
+        h0 += rv_le32(m + 0) & 0x3ffffffu;
+        h1 += (rv_le32(m + 3) >> 2) & 0x3ffffffu;
+        h2 += (rv_le32(m + 6) >> 4) & 0x3ffffffu;
+        h3 += (rv_le32(m + 9) >> 6) & 0x3ffffffu;
+        h4 += (rv_le32(m + 12) >> 8) | (1u << 24);
+
+        const uint64_t d0 = (uint64_t)h0 * r0 + (uint64_t)h1 * s4 + (uint64_t)h2 * s3 + (uint64_t)h3 * s2 + (uint64_t)h4 * s1;
+        uint64_t d1 = (uint64_t)h0 * r1 + (uint64_t)h1 * r0 + (uint64_t)h2 * s4 + (uint64_t)h3 * s3 + (uint64_t)h4 * s2;
+        uint64_t d2 = (uint64_t)h0 * r2 + (uint64_t)h1 * r1 + (uint64_t)h2 * r0 + (uint64_t)h3 * s4 + (uint64_t)h4 * s3;
+        uint64_t d3 = (uint64_t)h0 * r3 + (uint64_t)h1 * r2 + (uint64_t)h2 * r1 + (uint64_t)h3 * r0 + (uint64_t)h4 * s4;
+        uint64_t d4 = (uint64_t)h0 * r4 + (uint64_t)h1 * r3 + (uint64_t)h2 * r2 + (uint64_t)h3 * r1 + (uint64_t)h4 * r0;
+
+        uint32_t c = (uint32_t)(d0 >> 26); h0 = (uint32_t)d0 & 0x3ffffffu;
+        d1 += c; c = (uint32_t)(d1 >> 26); h1 = (uint32_t)d1 & 0x3ffffffu;
+        d2 += c; c = (uint32_t)(d2 >> 26); h2 = (uint32_t)d2 & 0x3ffffffu;
+        d3 += c; c = (uint32_t)(d3 >> 26); h3 = (uint32_t)d3 & 0x3ffffffu;
+        d4 += c; c = (uint32_t)(d4 >> 26); h4 = (uint32_t)d4 & 0x3ffffffu;
+        h0 += c * 5u; c = h0 >> 26; h0 &= 0x3ffffffu;
+        h1 += c;
+    }
+
+    st->h[0] = h0; st->h[1] = h1; st->h[2] = h2; st->h[3] = h3; st->h[4] = h4;
+}
+
+static void rv_poly1305_finish(rv_poly1305_t* st, uint8_t tag[16]) {
+    uint32_t h0 = st->h[0], h1 = st->h[1], h2 = st->h[2], h3 = st->h[3], h4 = st->h[4];
+
+    uint32_t c = h1 >> 26; h1 &= 0x3ffffffu;
+    h2 += c; c = h2 >> 26; h2 &= 0x3ffffffu;
+    h3 += c; c = h3 >> 26; h3 &= 0x3ffffffu;
+    h4 += c; c = h4 >> 26; h4 &= 0x3ffffffu;
+    h0 += c * 5u; c = h0 >> 26; h0 &= 0x3ffffffu;
+    h1 += c;
+
+    // g = h - p; keep h if that went negative
+    uint32_t g0 = h0 + 5u; c = g0 >> 26; g0 &= 0x3ffffffu;
+    uint32_t g1 = h1 + c;  c = g1 >> 26; g1 &= 0x3ffffffu;
+    uint32_t g2 = h2 + c;  c = g2 >> 26; g2 &= 0x3ffffffu;
+    uint32_t g3 = h3 + c;  c = g3 >> 26; g3 &= 0x3ffffffu;
+    uint32_t g4 = h4 + c - (1u << 26);
+
+    uint32_t mask = (g4 >> 31) - 1u;
+    h0 = (h0 & ~mask) | (g0 & mask);
+    h1 = (h1 & ~mask) | (g1 & mask);
+    h2 = (h2 & ~mask) | (g2 & mask);
+    h3 = (h3 & ~mask) | (g3 & mask);
+    h4 = (h4 & ~mask) | (g4 & mask);
+
+    const uint32_t w0 = h0 | (h1 << 26);
+    const uint32_t w1 = (h1 >> 6) | (h2 << 20);
+    const uint32_t w2 = (h2 >> 12) | (h3 << 14);
+    const uint32_t w3 = (h3 >> 18) | (h4 << 8);
+
+    uint64_t f = (uint64_t)w0 + st->pad[0];             rv_store_le32(tag + 0, (uint32_t)f);
+    f = (uint64_t)w1 + st->pad[1] + (f >> 32);          rv_store_le32(tag + 4, (uint32_t)f);
+    f = (uint64_t)w2 + st->pad[2] + (f >> 32);          rv_store_le32(tag + 8, (uint32_t)f);
+    f = (uint64_t)w3 + st->pad[3] + (f >> 32);          rv_store_le32(tag + 12, (uint32_t)f);
+}
+
+#endif
+
+static void rv_poly1305_padded(rv_poly1305_t* st, const uint8_t* m, size_t len) {
+    rv_poly1305_blocks(st, m, len / 16u);
+    const size_t tail = len % 16u;
+    if (tail) {
+        uint8_t block[16] = {0};
+        memcpy(block, m + len - tail, tail);
+        rv_poly1305_blocks(st, block, 1);
+    }
+}
+
+static void rv_aead_mac(const uint8_t poly_key[32],
+                        const uint8_t* aad, size_t aad_len,
+                        const uint8_t* ct, size_t len,
+                        uint8_t tag[16])
+{
+    rv_poly1305_t st;
+    rv_poly1305_init(&st, poly_key);
+    rv_poly1305_padded(&st, aad, aad_len);
+    rv_poly1305_padded(&st, ct, len);
+
+    uint8_t lens[16];
+    rv_store_le64(lens, (uint64_t)aad_len);
+    rv_store_le64(lens + 8, (uint64_t)len);
+    rv_poly1305_blocks(&st, lens, 1);
+    rv_poly1305_finish(&st, tag);
+}
+
+/* ============================================================
+   AEAD
+   ============================================================ */
+
+void rv_aead_key_init(rv_aead_key_t* key, const uint8_t raw[RV_AEAD_KEY_LEN]) {
+    if (!key || !raw) return;
+    for (int i = 0; i < 8; ++i) key->k[i] = rv_le32(raw + 4 * i);
+}
+
+void rv_aead_key_wipe(rv_aead_key_t* key) {
+    if (!key) return;
+    volatile uint32_t* p = key->k;
+    for (int i = 0; i < 8; ++i) p[i] = 0;
+}
+
+void rv_aead_seal(const rv_aead_key_t* key, const uint8_t nonce[RV_AEAD_NONCE_LEN],
+                  const uint8_t* aad, size_t aad_len,
+                  const uint8_t* in, uint8_t* out, size_t len,
+                  uint8_t tag[RV_AEAD_TAG_LEN])
+{
+    uint8_t ks[RV_CHACHA_BATCH];
+    rv_chacha20_x4(key, nonce, 0, ks);
+
+    uint8_t poly_key[32];
+    memcpy(poly_key, ks, sizeof(poly_key));
+
+    rv_chacha20_xor(key, nonce, ks, in, out, len);
+    rv_aead_mac(poly_key, aad, aad_len, out, len, tag);
+}
+
+int rv_aead_open(const rv_aead_key_t* key, const uint8_t nonce[RV_AEAD_NONCE_LEN],
+                 const uint8_t* aad, size_t aad_len,
+                 const uint8_t* in, uint8_t* out, size_t len,
+                 const uint8_t tag[RV_AEAD_TAG_LEN])
+{
+    uint8_t ks[RV_CHACHA_BATCH];
+    rv_chacha20_x4(key, nonce, 0, ks);
+
+    uint8_t expect[RV_AEAD_TAG_LEN];
+    rv_aead_mac(ks, aad, aad_len, in, len, expect);
+
+    uint8_t diff = 0;
+    for (int i = 0; i < RV_AEAD_TAG_LEN; ++i) diff |= (uint8_t)(expect[i] ^ tag[i]);
+    if (diff) return -1;
+
+    rv_chacha20_xor(key, nonce, ks, in, out, len);
+    return 0;
+}
+
+void rv_aead_voice_nonce(uint8_t nonce[RV_AEAD_NONCE_LEN], uint16_t speaker_id, uint64_t index) {
+    nonce[0] = 0;
+    nonce[1] = 0;
+    nonce[2] = (uint8_t)(speaker_id >> 8);
+    nonce[3] = (uint8_t)speaker_id;
+    for (int i = 0; i < 8; ++i) nonce[4 + i] = (uint8_t)(index >> (56 - 8 * i));
+}
+
+/* ============================================================
+   Replay window
+   ============================================================ */
+
+int rv_replay_check(const rv_replay_t* r, uint64_t index) {
+    if (!r->started || index > r->top) return 1;
+    const uint64_t behind = r->top - index;
+    if (behind >= RV_REPLAY_WINDOW) return 0;
+    return ((r->mask >> behind) & 1u) ? 0 : 1;
+}
+
+void rv_replay_accept(rv_replay_t* r, uint64_t index) {
+    if (!r->started) {
+        r->started = 1;
+        r->top = index;
+        r->mask = 1;
+    } else if (index > r->top) {
+        const uint64_t ahead = index - r->top;
+        r->mask = ahead >= RV_REPLAY_WINDOW ? 1u : (r->mask << ahead) | 1u;
+        r->top = index;
+    } else {
+        r->mask |= (uint64_t)1u << (r->top - index);
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * ChaCha20-Poly1305 AEAD (RFC 8439) for voice payloads.
+ *
+ * The ChaCha20 core produces four blocks per call: block 0 keys Poly1305,
+ * blocks 1..3 cover the first 192 bytes of payload, so a typical voice
+ * packet needs a single call. With SSE2 the four blocks run in parallel
+ * lanes.
+ */
+
+#define RV_AEAD_KEY_LEN   32
+#define RV_AEAD_NONCE_LEN 12
+#define RV_AEAD_TAG_LEN   16
+
+typedef struct rv_aead_key {
+    uint32_t k[8];             // key words, little-endian decoded
+} rv_aead_key_t;
+
+void rv_aead_key_init(rv_aead_key_t* key, const uint8_t raw[RV_AEAD_KEY_LEN]);
+void rv_aead_key_wipe(rv_aead_key_t* key);
+
+// Encrypt len bytes from in to out (may alias) and write the tag.
+void rv_aead_seal(const rv_aead_key_t* key, const uint8_t nonce[RV_AEAD_NONCE_LEN],
+                  const uint8_t* aad, size_t aad_len,
+                  const uint8_t* in, uint8_t* out, size_t len,
+                  uint8_t tag[RV_AEAD_TAG_LEN]);
+
+// Check the tag, then decrypt. Returns 0, or -1 with out untouched.
+int rv_aead_open(const rv_aead_key_t* key, const uint8_t nonce[RV_AEAD_NONCE_LEN],
+                 const uint8_t* aad, size_t aad_len,
+                 const uint8_t* in, uint8_t* out, size_t len,
+                 const uint8_t tag[RV_AEAD_TAG_LEN]);
+
+// Voice nonce: u32 speaker id, u64 packet index (roc << 16 | seq), big-endian.
+// Unique per key as long as a key is never reused across joins.
+void rv_aead_voice_nonce(uint8_t nonce[RV_AEAD_NONCE_LEN], uint16_t speaker_id, uint64_t index);
+
+// "sse2" or "scalar"
+const char* rv_crypto_impl(void);
+
+// ---- Replay protection (sliding window over packet indices) ----
+#define RV_REPLAY_WINDOW 64
+
+typedef struct rv_replay {
+    uint64_t top;              // highest accepted index
+    uint64_t mask;             // bit n set: top - n was accepted
+    uint8_t  started;
+} rv_replay_t;
+
+// 1 if index has not been seen and is inside the window
+int rv_replay_check(const rv_replay_t* r, uint64_t index);
+
+// Record an index that passed authentication
+void rv_replay_accept(rv_replay_t* r, uint64_t index);
@@ -0,0 +1,157 @@
+#include "rv_enc_ctl.h"
+#include <string.h>
+
+// Average encode time above this share of the frame budget means the
+// thread is starved; a single frame above the panic share means the next
+// one is likely to miss its deadline.
+#define RV_ENC_CTL_CPU_HIGH_PCT   25u
+#define RV_ENC_CTL_CPU_PANIC_PCT  60u
+#define RV_ENC_CTL_CPU_LOW_PCT    8u
+
+#define RV_ENC_CTL_CPU_COOLDOWN   25u   // frames between complexity drops
+#define RV_ENC_CTL_CPU_RAISE      250u  // quiet frames before stepping back up
+
+#define RV_ENC_CTL_LOSS_HIGH      0.10f // back off bitrate
+#define RV_ENC_CTL_LOSS_LOW       0.02f // probe bitrate up
+#define RV_ENC_CTL_FEC_ON         0.02f
+#define RV_ENC_CTL_FEC_OFF        0.005f
+
+// Bursts long enough to beat FEC show up as sustained loss
+#define RV_ENC_CTL_RED2_ON        0.15f
+#define RV_ENC_CTL_RED2_OFF       0.10f
+#define RV_ENC_CTL_RED1_ON        0.05f
+#define RV_ENC_CTL_RED1_OFF       0.02f
+
+void rv_enc_ctl_init(rv_enc_ctl_t* c, uint32_t frame_ms, const rv_opus_config_t* limits, int max_red_depth)
+{
+    if (!c || !limits) return;
+    memset(c, 0, sizeof(*c));
+
+    c->max_bitrate_bps = limits->bitrate_bps;
+    c->max_complexity = limits->complexity;
+    c->allow_fec = limits->use_fec;
+    c->min_loss_pct = limits->expected_loss_pct;
+    c->max_red_depth = max_red_depth;
+    c->red_depth = 0;
+    c->frame_us = (frame_ms ? frame_ms : 20u) * 1000u;
+}
+
+void rv_enc_ctl_on_loss_report(rv_enc_ctl_t* c, float loss_fraction)
+{
+    if (!c) return;
+    if (loss_fraction < 0.0f) loss_fraction = 0.0f;
+    if (loss_fraction > 1.0f) loss_fraction = 1.0f;
+
+    if (!c->has_loss) {
+        c->loss = loss_fraction;
+        c->has_loss = 1;
+    } else {
+        c->loss = c->loss * 0.7f + loss_fraction * 0.3f;
+    }
+    c->loss_pending = 1;
+}
+
+void rv_enc_ctl_on_encode_time(rv_enc_ctl_t* c, uint32_t encode_us)
+{
+    if (!c) return;
+
+    c->encode_us_last = encode_us;
+    if (c->encode_us_avg == 0) c->encode_us_avg = encode_us;
+    else c->encode_us_avg = (c->encode_us_avg * 7u + encode_us) / 8u;
+
+    c->frames_since_cpu_change++;
+    c->cpu_pending = 1;
+}
+
+static int update_cpu(rv_enc_ctl_t* c, rv_opus_config_t* cfg)
+{
+    const uint32_t high = c->frame_us * RV_ENC_CTL_CPU_HIGH_PCT / 100u;
+    const uint32_t panic = c->frame_us * RV_ENC_CTL_CPU_PANIC_PCT / 100u;
+    const uint32_t low = c->frame_us * RV_ENC_CTL_CPU_LOW_PCT / 100u;
+
+    int want = cfg->complexity;
+
+    if (c->encode_us_last > panic && want > 0) {
+        want -= 2;
+    } else if (c->encode_us_avg > high && want > 0 &&
+               c->frames_since_cpu_change >= RV_ENC_CTL_CPU_COOLDOWN) {
+        want -= 1;
+    } else if (c->encode_us_avg < low && want < c->max_complexity &&
+               c->frames_since_cpu_change >= RV_ENC_CTL_CPU_RAISE) {
+        want += 1;
+    }
+
+    if (want < 0) want = 0;
+    if (want > c->max_complexity) want = c->max_complexity;
+    if (want == cfg->complexity) return 0;
+
+    cfg->complexity = want;
+    c->frames_since_cpu_change = 0;
+    // the old average describes the old complexity
+    c->encode_us_avg = 0;
+    return 1;
+}
+
+static int update_loss(rv_enc_ctl_t* c, rv_opus_config_t* cfg)
+{
+    int changed = 0;
+
+    int loss_pct = (int)(c->loss * 100.0f + 0.5f);
+    if (loss_pct < c->min_loss_pct) loss_pct = c->min_loss_pct;
+    if (loss_pct > 100) loss_pct = 100;
+    if (loss_pct != cfg->expected_loss_pct) {
+        cfg->expected_loss_pct = loss_pct;
+        changed = 1;
+    }
+
+    int fec = cfg->use_fec;
+    if (!c->allow_fec) fec = 0;
+    else if (c->loss >= RV_ENC_CTL_FEC_ON) fec = 1;
+    else if (c->loss < RV_ENC_CTL_FEC_OFF) fec = 0;
+    if (fec != cfg->use_fec) {
+        cfg->use_fec = fec;
+        changed = 1;
+    }
+
+    int bitrate = cfg->bitrate_bps;
+    if (c->loss > RV_ENC_CTL_LOSS_HIGH) {
+        bitrate = (bitrate * 85) / 100;
+    } else if (c->loss < RV_ENC_CTL_LOSS_LOW) {
+        bitrate += c->max_bitrate_bps / 20;
+    }
+    if (bitrate < RV_ENC_CTL_MIN_BITRATE) bitrate = RV_ENC_CTL_MIN_BITRATE;
+    if (bitrate > c->max_bitrate_bps) bitrate = c->max_bitrate_bps;
+    if (bitrate != cfg->bitrate_bps) {
+        cfg->bitrate_bps = bitrate;
+        changed = 1;
+    }
+
+    int red = c->red_depth;
+    if (c->loss >= RV_ENC_CTL_RED2_ON) red = 2;
+    else if (c->loss < RV_ENC_CTL_RED1_OFF) red = 0;
+    else if (red == 2 && c->loss < RV_ENC_CTL_RED2_OFF) red = 1;
+    else if (red == 0 && c->loss >= RV_ENC_CTL_RED1_ON) red = 1;
+    if (red > c->max_red_depth) red = c->max_red_depth;
+    c->red_depth = red;
+
+    return changed;
+}
+
+int rv_enc_ctl_update(rv_enc_ctl_t* c, rv_opus_config_t* cfg)
+{
+    if (!c || !cfg) return 0;
+
+    int changed = 0;
+
+    if (c->cpu_pending) {
+        c->cpu_pending = 0;
+        changed |= update_cpu(c, cfg);
+    }
+
+    if (c->loss_pending) {
+        c->loss_pending = 0;
+        changed |= update_loss(c, cfg);
+    }
+
+    return changed;
+}
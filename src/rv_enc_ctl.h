@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include "rv_opus.h"
+
+/*
+ * Closed-loop encoder controller.
+ *
+ * Inputs: remote loss reports (fraction 0..1) and per-frame encode time.
+ * Outputs: bitrate / complexity / FEC / expected loss, applied through
+ * rv_opus_enc_apply(), plus the RED depth. The host's settings act as
+ * ceilings (bitrate, complexity, RED depth), a permission (FEC) and a
+ * floor (expected loss).
+ */
+
+#ifndef RV_ENC_CTL_MIN_BITRATE
+#define RV_ENC_CTL_MIN_BITRATE 8000
+#endif
+
+typedef struct rv_enc_ctl {
+    // Host limits
+    int max_bitrate_bps;
+    int max_complexity;
+    int allow_fec;
+    int min_loss_pct;
+    int max_red_depth;
+
+    // Decisions that live outside the Opus encoder
+    int red_depth;
+
+    // Smoothed inputs
+    float    loss;            // remote loss fraction
+    uint32_t encode_us_avg;   // EWMA of encode time
+    uint32_t encode_us_last;
+    uint32_t frame_us;        // real-time budget per frame
+
+    uint32_t frames_since_cpu_change;
+    uint8_t  has_loss;
+    uint8_t  loss_pending;    // a report arrived since the last update
+    uint8_t  cpu_pending;     // an encode time arrived since the last update
+} rv_enc_ctl_t;
+
+void rv_enc_ctl_init(rv_enc_ctl_t* c, uint32_t frame_ms, const rv_opus_config_t* limits, int max_red_depth);
+
+void rv_enc_ctl_on_loss_report(rv_enc_ctl_t* c, float loss_fraction);
+void rv_enc_ctl_on_encode_time(rv_enc_ctl_t* c, uint32_t encode_us);
+
+// Fold pending inputs into *cfg (and c->red_depth). Returns 1 if *cfg changed.
+int rv_enc_ctl_update(rv_enc_ctl_t* c, rv_opus_config_t* cfg);
@@ -1,37 +1,246 @@
 #include "rv_netproto.h"
 #include <string.h>
 
-static void rv_hdr_init(rv_pkt_hdr_t* h, uint8_t type, uint16_t speaker_id, uint16_t seq, uint16_t payload_len, uint8_t flags) {
+static void rv_hdr_init(rv_pkt_hdr_t* h, uint8_t type, uint16_t speaker_id, uint16_t seq, uint16_t payload_len, uint8_t flags, uint8_t ext) {
     memset(h, 0, sizeof(*h));
     h->magic = rv_htonl32(RV_MAGIC);
     h->version = RV_PROTO_VER;
     h->type = type;
     h->flags = flags;
+    h->ext = ext;
     h->speaker_id = rv_htons16(speaker_id);
     h->seq = rv_htons16(seq);
     h->payload_len = rv_htons16(payload_len);
 }
 
-int rv_build_join_packet(uint8_t* out, int out_cap, uint64_t session_id, uint16_t player_id) {
+// v2 compact header; returns bytes written or <0 when out_cap is too small
+static int rv_hdr2_write(uint8_t* out, int out_cap, uint8_t type, uint16_t speaker_id, uint16_t seq,
+                         uint8_t flags, uint8_t ext, uint8_t level) {
+    uint8_t h[RV_V2_MAX_HDR];
+    int n = 0;
+
+    h[n++] = (uint8_t)(RV_V2_MARK | (ext ? RV_V2_EXT : 0u) | (type & RV_V2_TYPE_MASK));
+    h[n++] = flags;
+
+    uint32_t id = speaker_id;
+    while (id >= 0x80u) {
+        h[n++] = (uint8_t)(id | 0x80u);
+        id >>= 7;
+    }
+    h[n++] = (uint8_t)id;
+
+    h[n++] = (uint8_t)(seq >> 8);
+    h[n++] = (uint8_t)seq;
+    if (ext) h[n++] = ext;
+    if (ext & RV_EXT_LEVEL) h[n++] = level;
+
+    if (out_cap < n) return -3;
+    memcpy(out, h, (size_t)n);
+    return n;
+}
+
+int rv_pkt_view_parse(const uint8_t* buf, int len, rv_pkt_view_t* out) {
+    if (!buf || len < 1 || !out) return -1;
+
+    int n = 0;
+
+    if ((buf[0] & RV_V2_MARK_MASK) == RV_V2_MARK) {
+        if (len < 5) return -1;
+
+        const uint8_t b0 = buf[n++];
+        out->version = RV_PROTO_VER2;
+        out->type = (uint8_t)(b0 & RV_V2_TYPE_MASK);
+        out->flags = buf[n++];
+
+        uint32_t id = 0;
+        for (int shift = 0;; shift += 7) {
+            if (shift > 14 || n >= len) return -5;
+            const uint8_t b = buf[n++];
+            id |= (uint32_t)(b & 0x7Fu) << shift;
+            if (!(b & 0x80u)) break;
+        }
+        if (id > 0xFFFFu) return -5;
+        out->speaker_id = (uint16_t)id;
+
+        if (n + 2 > len) return -5;
+        out->seq = rv_load_be16(buf + n);
+        n += 2;
+
+        out->ext = 0;
+        out->level = RV_LEVEL_SILENT;
+        if (b0 & RV_V2_EXT) {
+            if (n >= len) return -5;
+            out->ext = buf[n++];
+        }
+        if (out->ext & RV_EXT_LEVEL) {
+            if (n >= len) return -5;
+            out->level = buf[n++];
+        }
+
+        if (len - n <= 0 || len - n > 0xFFFF) return -4;
+        out->payload_len = (uint16_t)(len - n);
+    } else {
+        if (len < (int)sizeof(rv_pkt_hdr_t)) return -1;
+        if (rv_load_be32(buf) != RV_MAGIC) return -2;
+        if (buf[4] != RV_PROTO_VER) return -3;
+
+        out->version = RV_PROTO_VER;
+        out->type = buf[5];
+        out->flags = buf[6];
+        out->ext = buf[7];
+        out->level = RV_LEVEL_SILENT;
+        out->speaker_id = rv_load_be16(buf + 8);
+        out->seq = rv_load_be16(buf + 10);
+        out->payload_len = rv_load_be16(buf + 12);
+        n = (int)sizeof(rv_pkt_hdr_t);
+
+        if (out->payload_len == 0 || len < n + (int)out->payload_len) return -4;
+    }
+
+    out->hdr_len = (uint16_t)n;
+    out->payload = buf + n;
+    return 0;
+}
+
+static int rv_build_join(uint8_t* out, int out_cap, uint64_t session_id, uint16_t player_id, uint16_t caps,
+                         uint16_t seq) {
     if (!out) return -1;
     const uint16_t payload_len = (uint16_t)sizeof(rv_join_payload_t);
     const int need = (int)sizeof(rv_pkt_hdr_t) + (int)payload_len;
     if (out_cap < need) return -2;
 
     rv_pkt_hdr_t h;
-    rv_hdr_init(&h, RV_PKT_JOIN, 0, 0, payload_len, 0);
+    rv_hdr_init(&h, RV_PKT_JOIN, 0, seq, payload_len, 0, 0);
 
     rv_join_payload_t p;
     memset(&p, 0, sizeof(p));
     p.session_id = rv_htonll64(session_id);
     p.player_id = rv_htons16(player_id);
-    p.reserved = 0;
+    p.caps = rv_htons16(caps);
+
+    memcpy(out, &h, sizeof(h));
+    memcpy(out + sizeof(h), &p, sizeof(p));
+    return need;
+}
+
+int rv_build_join_packet(uint8_t* out, int out_cap, uint64_t session_id, uint16_t player_id, uint16_t caps) {
+    return rv_build_join(out, out_cap, session_id, player_id, caps, 0);
+}
+
+int rv_build_keepalive_packet(uint8_t* out, int out_cap, uint64_t session_id, uint16_t player_id,
+                              uint16_t caps, uint16_t count) {
+    if (count == 0) return -1;
+    return rv_build_join(out, out_cap, session_id, player_id, caps, count);
+}
+
+int rv_build_join_ack_packet(uint8_t* out, int out_cap, uint8_t wire_version) {
+    if (!out) return -1;
+    const uint16_t payload_len = (uint16_t)sizeof(rv_join_ack_payload_t);
+    const int need = (int)sizeof(rv_pkt_hdr_t) + (int)payload_len;
+    if (out_cap < need) return -2;
+
+    rv_pkt_hdr_t h;
+    rv_hdr_init(&h, RV_PKT_JOIN_ACK, 0, 0, payload_len, 0, 0);
+
+    rv_join_ack_payload_t p;
+    memset(&p, 0, sizeof(p));
+    p.wire_version = wire_version;
 
     memcpy(out, &h, sizeof(h));
     memcpy(out + sizeof(h), &p, sizeof(p));
     return need;
 }
 
+int rv_build_report_packet(uint8_t* out, int out_cap, uint8_t wire_version,
+                           uint16_t reporter_id, const rv_report_t* report) {
+    if (!out || !report) return -1;
+
+    int hdr_len = 0;
+    if (wire_version == RV_PROTO_VER2) {
+        hdr_len = rv_hdr2_write(out, out_cap, RV_PKT_REPORT, reporter_id, 0, 0, 0, 0);
+        if (hdr_len < 0) return hdr_len;
+    } else {
+        if (out_cap < (int)sizeof(rv_pkt_hdr_t)) return -2;
+        rv_pkt_hdr_t h;
+        rv_hdr_init(&h, RV_PKT_REPORT, reporter_id, 0, RV_REPORT_PAYLOAD_LEN, 0, 0);
+        memcpy(out, &h, sizeof(h));
+        hdr_len = (int)sizeof(h);
+    }
+
+    const int need = hdr_len + RV_REPORT_PAYLOAD_LEN;
+    if (out_cap < need) return -2;
+
+    uint8_t* p = out + hdr_len;
+    rv_store_be16(p, report->target_id);
+    p[2] = report->fraction_lost;
+    p[3] = 0;
+    rv_store_be32(p + 4, report->cumulative_lost);
+    rv_store_be32(p + 8, report->highest_seq);
+    rv_store_be32(p + 12, report->jitter_us);
+    rv_store_be32(p + 16, report->lsr_us);
+    rv_store_be32(p + 20, report->dlsr_us);
+    return need;
+}
+
+int rv_build_interest_packet(uint8_t* out, int out_cap, uint8_t wire_version,
+                             uint16_t player_id, const rv_interest_t* interest) {
+    if (!out || !interest) return -1;
+
+    int hdr_len = 0;
+    if (wire_version == RV_PROTO_VER2) {
+        hdr_len = rv_hdr2_write(out, out_cap, RV_PKT_INTEREST, player_id, 0, 0, 0, 0);
+        if (hdr_len < 0) return hdr_len;
+    } else {
+        if (out_cap < (int)sizeof(rv_pkt_hdr_t)) return -2;
+        rv_pkt_hdr_t h;
+        rv_hdr_init(&h, RV_PKT_INTEREST, player_id, 0, RV_INTEREST_PAYLOAD_LEN, 0, 0);
+        memcpy(out, &h, sizeof(h));
+        hdr_len = (int)sizeof(h);
+    }
+
+    const int need = hdr_len + RV_INTEREST_PAYLOAD_LEN;
+    if (out_cap < need) return -2;
+
+    uint8_t* p = out + hdr_len;
+    rv_store_be16(p, interest->channels);
+    p[2] = interest->flags;
+    p[3] = 0;
+    rv_store_be16(p + 4, (uint16_t)interest->pos[0]);
+    rv_store_be16(p + 6, (uint16_t)interest->pos[1]);
+    rv_store_be16(p + 8, (uint16_t)interest->pos[2]);
+    rv_store_be16(p + 10, interest->range);
+    return need;
+}
+
+int rv_build_bundle_header(uint8_t* out, int out_cap) {
+    if (!out) return -1;
+    return rv_hdr2_write(out, out_cap, RV_PKT_BUNDLE, 0, 0, 0, 0, 0);
+}
+
+int rv_bundle_append(uint8_t* out, int len, int out_cap, const uint8_t* pkt, int pkt_len) {
+    if (!out || !pkt || len <= 0) return -1;
+    if (pkt_len <= 0 || pkt_len > 0xFFFF) return -2;
+    if (out_cap - len < RV_BUNDLE_ITEM_HDR + pkt_len) return -3;
+
+    rv_store_be16(out + len, (uint16_t)pkt_len);
+    memcpy(out + len + RV_BUNDLE_ITEM_HDR, pkt, (size_t)pkt_len);
+    return len + RV_BUNDLE_ITEM_HDR + pkt_len;
+}
+
+int rv_build_peer_packet(uint8_t* out, int out_cap, uint64_t session_id, uint16_t hops,
+                         const uint8_t* pkt, int pkt_len) {
+    if (!out || !pkt || pkt_len <= 0) return -1;
+    const int hdr_len = rv_hdr2_write(out, out_cap, RV_PKT_PEER, 0, hops, 0, 0, 0);
+    if (hdr_len < 0) return hdr_len;
+
+    const int need = hdr_len + RV_PEER_SESSION_LEN + pkt_len;
+    if (out_cap < need) return -2;
+    const uint64_t id = rv_htonll64(session_id);
+    memcpy(out + hdr_len, &id, sizeof(id));
+    memcpy(out + hdr_len + RV_PEER_SESSION_LEN, pkt, (size_t)pkt_len);
+    return need;
+}
+
 int rv_build_voice_packet_ex(uint8_t* out, int out_cap,
                              uint16_t speaker_id, uint16_t seq,
                              uint8_t flags,
@@ -43,50 +252,288 @@ int rv_build_voice_packet_ex(uint8_t* out, int out_cap,
     if (out_cap < need) return -3;
 
     rv_pkt_hdr_t h;
-    rv_hdr_init(&h, RV_PKT_VOICE, speaker_id, seq, payload_len, flags);
+    rv_hdr_init(&h, RV_PKT_VOICE, speaker_id, seq, payload_len, flags, 0);
 
     memcpy(out, &h, sizeof(h));
     memcpy(out + sizeof(h), payload, payload_len);
     return need;
 }
 
-int rv_parse_packet_header(const uint8_t* buf, int len, rv_pkt_hdr_t* out_hdr_host) {
-    if (!buf || len < (int)sizeof(rv_pkt_hdr_t) || !out_hdr_host) return -1;
+int rv_build_voice_packet_red(uint8_t* out, int out_cap,
+                              uint8_t wire_version,
+                              uint16_t speaker_id, uint16_t seq,
+                              uint8_t flags,
+                              const uint32_t* ts_us,
+                              const uint8_t* level,
+                              const rv_red_block_t* red, int red_count,
+                              const uint8_t* primary, uint16_t primary_len) {
+    if (red_count <= 0 && !ts_us && !level && wire_version == RV_PROTO_VER)
+        return rv_build_voice_packet_ex(out, out_cap, speaker_id, seq, flags, primary, primary_len);
 
-    rv_pkt_hdr_t h;
-    memcpy(&h, buf, sizeof(h));
+    if (!out || !primary || (red_count > 0 && !red)) return -1;
+    if (primary_len == 0 || red_count > RV_RED_MAX_DEPTH) return -2;
+    if (level && (wire_version != RV_PROTO_VER2 || *level > RV_LEVEL_SILENT)) return -2;
+    if (red_count < 0) red_count = 0;
+
+    int payload_len = (int)primary_len;
+    if (ts_us) payload_len += 4;
+    if (red_count > 0) payload_len += 1 + 2 * red_count;
+    for (int i = 0; i < red_count; ++i) {
+        if (!red[i].data || red[i].len == 0 || red[i].seq_offset == 0) return -2;
+        payload_len += red[i].len;
+    }
+    if (payload_len > 0xFFFF) return -3;
+
+    const uint8_t ext = (uint8_t)((red_count > 0 ? RV_EXT_RED : 0u) | (ts_us ? RV_EXT_TS : 0u) |
+                                  (level ? RV_EXT_LEVEL : 0u));
+    int hdr_len = 0;
+    if (wire_version == RV_PROTO_VER2) {
+        hdr_len = rv_hdr2_write(out, out_cap, RV_PKT_VOICE, speaker_id, seq, flags, ext, level ? *level : 0);
+        if (hdr_len < 0) return hdr_len;
+    } else {
+        if (out_cap < (int)sizeof(rv_pkt_hdr_t)) return -3;
+        rv_pkt_hdr_t h;
+        rv_hdr_init(&h, RV_PKT_VOICE, speaker_id, seq, (uint16_t)payload_len, flags, ext);
+        memcpy(out, &h, sizeof(h));
+        hdr_len = (int)sizeof(h);
+    }
+
+    const int need = hdr_len + payload_len;
+    if (out_cap < need) return -3;
+
+    uint8_t* p = out + hdr_len;
+    if (ts_us) {
+        rv_store_be32(p, *ts_us);
+        p += 4;
+    }
+    if (red_count == 0) {
+        memcpy(p, primary, primary_len);
+        return need;
+    }
+
+    *p++ = (uint8_t)red_count;
+    for (int i = 0; i < red_count; ++i) {
+        *p++ = red[i].seq_offset;
+        *p++ = red[i].len;
+    }
+    for (int i = 0; i < red_count; ++i) {
+        memcpy(p, red[i].data, red[i].len);
+        p += red[i].len;
+    }
+    memcpy(p, primary, primary_len);
+    return need;
+}
+
+int rv_parse_packet_header(const uint8_t* buf, int len, rv_pkt_hdr_t* out_hdr_host) {
+    if (!out_hdr_host) return -1;
 
-    if (rv_ntohl32(h.magic) != RV_MAGIC) return -2;
-    if (h.version != RV_PROTO_VER) return -3;
+    rv_pkt_view_t v;
+    int r = rv_pkt_view_parse(buf, len, &v);
+    if (r != 0) return r;
 
-    // Convert to host order in the output
     out_hdr_host->magic = RV_MAGIC;
-    out_hdr_host->version = h.version;
-    out_hdr_host->type = h.type;
-    out_hdr_host->flags = h.flags;
-    out_hdr_host->reserved0 = 0;
-    out_hdr_host->speaker_id = rv_ntohs16(h.speaker_id);
-    out_hdr_host->seq = rv_ntohs16(h.seq);
-    out_hdr_host->payload_len = rv_ntohs16(h.payload_len);
+    out_hdr_host->version = v.version;
+    out_hdr_host->type = v.type;
+    out_hdr_host->flags = v.flags;
+    out_hdr_host->ext = v.ext;
+    out_hdr_host->speaker_id = v.speaker_id;
+    out_hdr_host->seq = v.seq;
+    out_hdr_host->payload_len = v.payload_len;
+    return 0;
+}
 
-    const int need = (int)sizeof(rv_pkt_hdr_t) + (int)out_hdr_host->payload_len;
-    if (out_hdr_host->payload_len == 0 || len < need) return -4;
+int rv_pkt_view_join(const rv_pkt_view_t* v, uint64_t* out_session_id, uint16_t* out_player_id,
+                     uint16_t* out_caps) {
+    if (!v) return -1;
+    if (v->type != RV_PKT_JOIN) return -10;
+    if (v->payload_len != sizeof(rv_join_payload_t)) return -11;
 
+    if (out_session_id) *out_session_id = rv_load_be64(v->payload);
+    if (out_player_id) *out_player_id = rv_load_be16(v->payload + 8);
+    if (out_caps) *out_caps = rv_load_be16(v->payload + 10);
     return 0;
 }
 
-int rv_parse_join_payload(const uint8_t* buf, int len, uint64_t* out_session_id, uint16_t* out_player_id) {
-    rv_pkt_hdr_t h;
-    int r = rv_parse_packet_header(buf, len, &h);
+int rv_pkt_view_join_ack(const rv_pkt_view_t* v, uint8_t* out_wire_version) {
+    if (!v) return -1;
+    if (v->type != RV_PKT_JOIN_ACK) return -12;
+    if (v->payload_len < sizeof(rv_join_ack_payload_t)) return -11;
+
+    if (out_wire_version) *out_wire_version = v->payload[0];
+    return 0;
+}
+
+int rv_pkt_view_report(const rv_pkt_view_t* v, rv_report_t* out) {
+    if (!v || !out) return -1;
+    if (v->type != RV_PKT_REPORT) return -13;
+    if (v->payload_len < RV_REPORT_PAYLOAD_LEN) return -11;
+
+    const uint8_t* p = v->payload;
+    out->target_id = rv_load_be16(p);
+    out->fraction_lost = p[2];
+    out->cumulative_lost = rv_load_be32(p + 4);
+    out->highest_seq = rv_load_be32(p + 8);
+    out->jitter_us = rv_load_be32(p + 12);
+    out->lsr_us = rv_load_be32(p + 16);
+    out->dlsr_us = rv_load_be32(p + 20);
+    return 0;
+}
+
+int rv_pkt_view_interest(const rv_pkt_view_t* v, rv_interest_t* out) {
+    if (!v || !out) return -1;
+    if (v->type != RV_PKT_INTEREST) return -14;
+    if (v->payload_len < RV_INTEREST_PAYLOAD_LEN) return -11;
+
+    const uint8_t* p = v->payload;
+    out->channels = rv_load_be16(p);
+    out->flags = p[2];
+    out->pos[0] = (int16_t)rv_load_be16(p + 4);
+    out->pos[1] = (int16_t)rv_load_be16(p + 6);
+    out->pos[2] = (int16_t)rv_load_be16(p + 8);
+    out->range = rv_load_be16(p + 10);
+    return 0;
+}
+
+int rv_pkt_view_bundle_next(const rv_pkt_view_t* v, uint32_t* pos,
+                            const uint8_t** out_pkt, uint16_t* out_len) {
+    if (!v || !pos || !out_pkt || !out_len) return -1;
+    if (v->type != RV_PKT_BUNDLE) return -50;
+    if (*pos >= v->payload_len) return 0;
+    if (v->payload_len - *pos < RV_BUNDLE_ITEM_HDR) return -51;
+
+    const uint16_t len = rv_load_be16(v->payload + *pos);
+    if (len == 0 || len > v->payload_len - *pos - RV_BUNDLE_ITEM_HDR) return -51;
+
+    *out_pkt = v->payload + *pos + RV_BUNDLE_ITEM_HDR;
+    *out_len = len;
+    *pos += RV_BUNDLE_ITEM_HDR + (uint32_t)len;
+    return 1;
+}
+
+int rv_pkt_view_peer(const rv_pkt_view_t* v, uint64_t* out_session_id,
+                     const uint8_t** out_pkt, uint16_t* out_len) {
+    if (!v || !out_pkt || !out_len) return -1;
+    if (v->type != RV_PKT_PEER) return -60;
+    if (v->payload_len <= RV_PEER_SESSION_LEN) return -61;
+
+    if (out_session_id) *out_session_id = rv_load_be64(v->payload);
+    *out_pkt = v->payload + RV_PEER_SESSION_LEN;
+    *out_len = (uint16_t)(v->payload_len - RV_PEER_SESSION_LEN);
+    return 0;
+}
+
+int rv_pkt_view_take_ts(rv_pkt_view_t* v, uint32_t* out_ts_us) {
+    if (!v) return -1;
+    if (!(v->ext & RV_EXT_TS)) return 0;
+    if (v->payload_len <= 4) return -35;
+
+    if (out_ts_us) *out_ts_us = rv_load_be32(v->payload);
+    v->payload += 4;
+    v->payload_len = (uint16_t)(v->payload_len - 4u);
+    v->ext = (uint8_t)(v->ext & ~RV_EXT_TS);
+    return 1;
+}
+
+int rv_pkt_view_enc(const rv_pkt_view_t* v, uint16_t* out_roc,
+                    const uint8_t** out_aad, uint16_t* out_aad_len,
+                    const uint8_t** out_ct, uint16_t* out_ct_len,
+                    const uint8_t** out_tag) {
+    if (!v) return -1;
+    if (v->type != RV_PKT_VOICE || !(v->ext & RV_EXT_ENC)) return -40;
+    if (v->payload_len <= RV_ENC_ROC_LEN + RV_ENC_TAG_LEN) return -41;
+
+    const uint16_t ct_len = (uint16_t)(v->payload_len - RV_ENC_ROC_LEN - RV_ENC_TAG_LEN);
+    if (out_roc) *out_roc = rv_load_be16(v->payload);
+    if (out_aad) *out_aad = v->payload - v->hdr_len;
+    if (out_aad_len) *out_aad_len = (uint16_t)(v->hdr_len + RV_ENC_ROC_LEN);
+    if (out_ct) *out_ct = v->payload + RV_ENC_ROC_LEN;
+    if (out_ct_len) *out_ct_len = ct_len;
+    if (out_tag) *out_tag = v->payload + RV_ENC_ROC_LEN + ct_len;
+    return 0;
+}
+
+int rv_pkt_enc_prepare(uint8_t* pkt, int len, int cap, uint16_t roc, int* out_aad_len) {
+    if (!pkt || !out_aad_len) return -1;
+
+    rv_pkt_view_t v;
+    int r = rv_pkt_view_parse(pkt, len, &v);
     if (r != 0) return r;
-    if (h.type != RV_PKT_JOIN) return -10;
-    if (h.payload_len != sizeof(rv_join_payload_t)) return -11;
+    if (v.type != RV_PKT_VOICE || (v.ext & RV_EXT_ENC)) return -40;
 
-    rv_join_payload_t p;
-    memcpy(&p, buf + sizeof(rv_pkt_hdr_t), sizeof(p));
+    // A v2 header without an ext byte grows by one
+    const int grow = (v.version == RV_PROTO_VER2 && v.ext == 0) ? 1 : 0;
+    int hdr_len = (int)v.hdr_len;
+    const int payload_len = (int)v.payload_len;
+    const int sealed_len = RV_ENC_ROC_LEN + payload_len + RV_ENC_TAG_LEN;
+    if (sealed_len > 0xFFFF) return -3;
+    if (cap < hdr_len + grow + sealed_len) return -3;
+
+    memmove(pkt + hdr_len + grow + RV_ENC_ROC_LEN, pkt + hdr_len, (size_t)payload_len);
+
+    if (v.version == RV_PROTO_VER2) {
+        if (grow) {
+            pkt[0] |= RV_V2_EXT;
+            hdr_len++;
+        }
+        // the ext byte comes before the level byte, if any
+        pkt[hdr_len - 1 - ((v.ext & RV_EXT_LEVEL) ? 1 : 0)] = (uint8_t)(v.ext | RV_EXT_ENC);
+    } else {
+        pkt[7] = (uint8_t)(v.ext | RV_EXT_ENC);
+        rv_store_be16(pkt + 12, (uint16_t)sealed_len);
+    }
 
-    if (out_session_id) *out_session_id = rv_ntohll64(p.session_id);
-    if (out_player_id) *out_player_id = rv_ntohs16(p.player_id);
+    rv_store_be16(pkt + hdr_len, roc);
+    *out_aad_len = hdr_len + RV_ENC_ROC_LEN;
+    return hdr_len + sealed_len;
+}
+
+int rv_parse_join_payload(const uint8_t* buf, int len, uint64_t* out_session_id, uint16_t* out_player_id,
+                          uint16_t* out_caps) {
+    rv_pkt_view_t v;
+    int r = rv_pkt_view_parse(buf, len, &v);
+    if (r != 0) return r;
+    return rv_pkt_view_join(&v, out_session_id, out_player_id, out_caps);
+}
+
+int rv_parse_join_ack(const uint8_t* buf, int len, uint8_t* out_wire_version) {
+    rv_pkt_view_t v;
+    int r = rv_pkt_view_parse(buf, len, &v);
+    if (r != 0) return r;
+    return rv_pkt_view_join_ack(&v, out_wire_version);
+}
+
+int rv_parse_red_payload(const uint8_t* payload, uint16_t payload_len,
+                         rv_red_block_t* out_blocks, int max_blocks, int* out_count,
+                         const uint8_t** out_primary, uint16_t* out_primary_len) {
+    if (!payload || !out_count || !out_primary || !out_primary_len) return -1;
+    if (payload_len < 1) return -30;
+
+    const int count = payload[0];
+    if (count == 0 || count > RV_RED_MAX_DEPTH) return -31;
+
+    int off = 1 + 2 * count;
+    if (off > (int)payload_len) return -32;
+
+    const uint8_t* desc = payload + 1;
+    for (int i = 0; i < count; ++i) {
+        const uint8_t seq_offset = desc[2 * i];
+        const uint8_t len = desc[2 * i + 1];
+        if (seq_offset == 0 || len == 0) return -33;
+        if (off + len > (int)payload_len) return -32;
+
+        if (out_blocks && i < max_blocks) {
+            out_blocks[i].seq_offset = seq_offset;
+            out_blocks[i].len = len;
+            out_blocks[i].data = payload + off;
+        }
+        off += len;
+    }
+
+    if (off >= (int)payload_len) return -34; // no primary frame
+
+    *out_count = (count < max_blocks) ? count : max_blocks;
+    *out_primary = payload + off;
+    *out_primary_len = (uint16_t)(payload_len - off);
     return 0;
 }
 
@@ -94,16 +541,16 @@ int rv_parse_voice_packet(const uint8_t* buf, int len,
                           uint16_t* out_speaker_id, uint16_t* out_seq,
                           uint8_t* out_flags,
                           const uint8_t** out_payload, uint16_t* out_payload_len) {
-    rv_pkt_hdr_t h;
-    int r = rv_parse_packet_header(buf, len, &h);
+    rv_pkt_view_t v;
+    int r = rv_pkt_view_parse(buf, len, &v);
     if (r != 0) return r;
-    if (h.type != RV_PKT_VOICE) return -20;
+    if (v.type != RV_PKT_VOICE) return -20;
 
-    if (out_speaker_id) *out_speaker_id = h.speaker_id;
-    if (out_seq) *out_seq = h.seq;
-    if (out_flags) *out_flags = h.flags;
-    if (out_payload_len) *out_payload_len = h.payload_len;
-    if (out_payload) *out_payload = buf + sizeof(rv_pkt_hdr_t);
+    if (out_speaker_id) *out_speaker_id = v.speaker_id;
+    if (out_seq) *out_seq = v.seq;
+    if (out_flags) *out_flags = v.flags;
+    if (out_payload_len) *out_payload_len = v.payload_len;
+    if (out_payload) *out_payload = v.payload;
 
     return 0;
 }
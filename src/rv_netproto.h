@@ -1,23 +1,60 @@
 #pragma once
 #include <stdint.h>
+#include <string.h>
 
 #define RV_MAGIC 0x43565652u /* 'RVVC' little-endian */
-#define RV_PROTO_VER 1
+#define RV_PROTO_VER  1
+#define RV_PROTO_VER2 2       /* compact header, negotiated via JOIN / JOIN_ACK */
 
 typedef enum rv_pkt_type {
-    RV_PKT_JOIN  = 1,
-    RV_PKT_VOICE = 2,
+    RV_PKT_JOIN     = 1,
+    RV_PKT_VOICE    = 2,
+    RV_PKT_JOIN_ACK = 3,      // relay -> client: negotiated session wire version
+    RV_PKT_REPORT   = 4,      // receiver -> sender (via relay): loss / jitter / RTT
+    RV_PKT_INTEREST = 5,      // client -> relay: radio channels and position it hears
+    RV_PKT_BUNDLE   = 6,      // relay -> client: several datagrams in one
+    RV_PKT_PEER     = 7,      // relay <-> relay: a client datagram and its session
 } rv_pkt_type_t;
 
+// ---- JOIN capabilities (rv_join_payload.caps) ----
+#define RV_CAP_V2             0x0001u   // sends and parses the v2 header
+#define RV_CAP_BUNDLE         0x0002u   // parses RV_PKT_BUNDLE
+#define RV_CAP_MIX            0x0004u   // plays voice from RV_MIX_SPEAKER
+#define RV_CAP_PEER           0x0008u   // a relay cascading the session (player_id 0)
+
+// speaker_id of the stream a mixing relay sends each client
+#define RV_MIX_SPEAKER        0u
+// Every packet of that stream holds one frame of this length
+#define RV_MIX_FRAME_MS       20
+
+// ---- v2 compact header ----
+//   u8  10 e ttttt     top bits = version 2, e = ext byte present, type
+//   u8  flags
+//   varint speaker_id  LEB128, 1-3 bytes (1 byte below 128)
+//   u16 seq            network order
+//   [u8 ext]           only when e = 1
+//   [u8 level]         only when ext has RV_EXT_LEVEL
+//   payload            rest of the datagram (no length field)
+// A v1 datagram starts with the magic byte 0x43, which never has the top
+// bits 10, so both versions can share one socket.
+// JOIN and JOIN_ACK are always sent as v1.
+#define RV_V2_MARK            0x80u
+#define RV_V2_MARK_MASK       0xC0u
+#define RV_V2_EXT             0x20u
+#define RV_V2_TYPE_MASK       0x1Fu
+#define RV_V2_MAX_HDR         9
+
 // ---- Flags for rv_pkt_hdr.flags ----
 // bit0: RADIO (1=radio, 0=proximity/default)
 // bits1-4: RADIO_CHANNEL (0..15)
 // bit5: PTT (informational)
-// bits6-7: reserved
+// bit6: TALKSPURT (first frame after a transmit gap: VAD/DTX silence or PTT up)
+// bit7: reserved
 #define RV_FLAG_RADIO         0x01u
 #define RV_FLAG_CH_SHIFT      1u
 #define RV_FLAG_CH_MASK       (0x0Fu << RV_FLAG_CH_SHIFT)
 #define RV_FLAG_PTT           0x20u
+#define RV_FLAG_TALKSPURT     0x40u
 
 static inline uint8_t rv_flags_make(uint8_t is_radio, uint8_t channel, uint8_t ptt) {
     uint8_t f = 0;
@@ -31,25 +68,128 @@ static inline uint8_t rv_flags_is_radio(uint8_t f) { return (f & RV_FLAG_RADIO)
 static inline uint8_t rv_flags_channel(uint8_t f)  { return (uint8_t)((f & RV_FLAG_CH_MASK) >> RV_FLAG_CH_SHIFT); }
 static inline uint8_t rv_flags_ptt(uint8_t f)      { return (f & RV_FLAG_PTT) ? 1 : 0; }
 
+// ---- Payload extensions for rv_pkt_hdr.ext (VOICE only) ----
+// bit0: RED (payload starts with redundant copies of earlier frames)
+// bit1: TS  (payload starts with a u32 sender timestamp, before any RED data)
+// bit2: ENC (payload is sealed with the session key, see below)
+// bit3: LEVEL (v2 only: the header ends with the audio level byte)
+// bits4-7: reserved, must be 0
+#define RV_EXT_RED            0x01u
+#define RV_EXT_TS             0x02u
+#define RV_EXT_ENC            0x04u
+#define RV_EXT_LEVEL          0x08u
+
+// ---- Audio level (LEVEL) ----
+// Frame RMS in -dBov, 0 = full scale .. 127 = silence (as in RFC 6464).
+// It is part of the header, so the relay can rank speakers by it even
+// when the payload is sealed; ENC authenticates it with the header.
+#define RV_LEVEL_SILENT       127u
+
+// ---- Encrypted (ENC) payload layout ----
+//   u16 roc                        sender's seq rollover count, cleartext
+//   ciphertext                     the payload the other ext bits describe
+//   u8[16] tag                     ChaCha20-Poly1305
+// Header and roc are the associated data. The nonce is speaker_id plus the
+// packet index roc << 16 | seq, so nothing else goes on the wire.
+#define RV_ENC_ROC_LEN        2
+#define RV_ENC_TAG_LEN        16
+
+// ---- Redundancy (RED) payload layout ----
+//   u8  count                      1..RV_RED_MAX_DEPTH
+//   count x { u8 seq_offset, u8 len }   block seq = hdr.seq - seq_offset
+//   count x block data             low-bitrate Opus frames, same order
+//   primary Opus frame             rest of the payload
+#define RV_RED_MAX_DEPTH      2
+#define RV_RED_MAX_BLOCK      255
+
 #pragma pack(push, 1)
 typedef struct rv_pkt_hdr {
     uint32_t magic;       // RV_MAGIC (network order)
     uint8_t  version;     // RV_PROTO_VER
     uint8_t  type;        // rv_pkt_type_t
     uint8_t  flags;       // see RV_FLAG_* above
-    uint8_t  reserved0;
+    uint8_t  ext;         // see RV_EXT_* above (was reserved, sent as 0)
     uint16_t speaker_id;  // network order (VOICE); for JOIN may be 0
-    uint16_t seq;         // network order (VOICE); for JOIN 0
+    uint16_t seq;         // network order (VOICE); for JOIN 0, then 1.. on keepalives
     uint16_t payload_len; // network order
 } rv_pkt_hdr_t;
 
 typedef struct rv_join_payload {
     uint64_t session_id;  // network order (u64 big-endian)
     uint16_t player_id;   // network order (1..16)
-    uint16_t reserved;    // 0
+    uint16_t caps;        // RV_CAP_* (network order), 0 from pre-v2 clients
 } rv_join_payload_t;
+
+// REPORT: header speaker_id is the reporter; payload (network order)
+//   u16 target_id        sender the report is about
+//   u8  fraction_lost    /256, since the previous report
+//   u8  reserved
+//   u32 cumulative_lost  frames
+//   u32 highest_seq      extended (wraps counted)
+//   u32 jitter_us
+//   u32 lsr_us           newest TS received from target (0 = none)
+//   u32 dlsr_us          time between receiving it and sending this report
+#define RV_REPORT_PAYLOAD_LEN 24
+
+typedef struct rv_report {
+    uint16_t target_id;
+    uint8_t  fraction_lost;
+    uint32_t cumulative_lost;
+    uint32_t highest_seq;
+    uint32_t jitter_us;
+    uint32_t lsr_us;
+    uint32_t dlsr_us;
+} rv_report_t;
+
+typedef struct rv_join_ack_payload {
+    uint8_t  wire_version; // RV_PROTO_VER or RV_PROTO_VER2 for this session
+    uint8_t  reserved[3];  // 0
+} rv_join_ack_payload_t;
 #pragma pack(pop)
 
+// INTEREST: header speaker_id is the sender; payload (network order)
+//   u16 channels         radio channels heard, bit n = channel n
+//   u8  flags            RV_INTEREST_POS: position below is valid
+//   u8  reserved
+//   i16 x, y, z          coarse position, whole world units (meters)
+//   u16 range            proximity hearing radius in the same units, 0 = unlimited
+// A client that never sent one hears everything.
+#define RV_INTEREST_PAYLOAD_LEN 12
+#define RV_INTEREST_POS         0x01u
+
+typedef struct rv_interest {
+    uint16_t channels;
+    uint8_t  flags;
+    int16_t  pos[3];
+    uint16_t range;
+} rv_interest_t;
+
+// BUNDLE: always a v2 header, speaker_id 0, seq 0; the payload is a run of
+//   u16 len              network order, > 0
+//   u8[len]              one datagram exactly as it would be sent alone
+// Only sent to clients that set RV_CAP_BUNDLE, never nested, and never
+// larger than RV_BUNDLE_MAX_BYTES so host receive buffers still fit it.
+#define RV_BUNDLE_MAX_BYTES   1400
+#define RV_BUNDLE_HDR_LEN     5         // what rv_build_bundle_header writes
+#define RV_BUNDLE_ITEM_HDR    2
+
+// PEER: always a v2 header, speaker_id 0, seq = relay hops so far; the
+// payload is
+//   u64 session_id       network order
+//   u8[...]              one VOICE or REPORT datagram as its client sent it
+// Exchanged only between relays that cascade a session (RV_CAP_PEER).
+#define RV_PEER_SESSION_LEN   8
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <stdlib.h>
+static inline uint16_t rv_bswap16(uint16_t x) { return _byteswap_ushort(x); }
+static inline uint32_t rv_bswap32(uint32_t x) { return _byteswap_ulong(x); }
+static inline uint64_t rv_bswap64(uint64_t x) { return _byteswap_uint64(x); }
+#elif defined(__GNUC__) || defined(__clang__)
+static inline uint16_t rv_bswap16(uint16_t x) { return __builtin_bswap16(x); }
+static inline uint32_t rv_bswap32(uint32_t x) { return __builtin_bswap32(x); }
+static inline uint64_t rv_bswap64(uint64_t x) { return __builtin_bswap64(x); }
+#else
 static inline uint16_t rv_bswap16(uint16_t x) { return (uint16_t)((x << 8) | (x >> 8)); }
 static inline uint32_t rv_bswap32(uint32_t x) {
     return ((x & 0x000000FFu) << 24) |
@@ -58,24 +198,106 @@ static inline uint32_t rv_bswap32(uint32_t x) {
            ((x & 0xFF000000u) >> 24);
 }
 static inline uint64_t rv_bswap64(uint64_t x) {
-    return ((x & 0x00000000000000FFull) << 56) |
-           ((x & 0x000000000000FF00ull) << 40) |
-           ((x & 0x0000000000FF0000ull) << 24) |
-           ((x & 0x00000000FF000000ull) << 8)  |
-           ((x & 0x000000FF00000000ull) >> 8)  |
-           ((x & 0x0000FF0000000000ull) >> 24) |
-           ((x & 0x00FF000000000000ull) >> 40) |
-           ((x & 0xFF00000000000000ull) >> 56);
+    return ((uint64_t)rv_bswap32((uint32_t)x) << 32) | rv_bswap32((uint32_t)(x >> 32));
 }
+#endif
 
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+static inline uint16_t rv_htons16(uint16_t x) { return x; }
+static inline uint16_t rv_ntohs16(uint16_t x) { return x; }
+static inline uint32_t rv_htonl32(uint32_t x) { return x; }
+static inline uint32_t rv_ntohl32(uint32_t x) { return x; }
+static inline uint64_t rv_htonll64(uint64_t x) { return x; }
+static inline uint64_t rv_ntohll64(uint64_t x) { return x; }
+#else
 static inline uint16_t rv_htons16(uint16_t x) { return rv_bswap16(x); }
 static inline uint16_t rv_ntohs16(uint16_t x) { return rv_bswap16(x); }
 static inline uint32_t rv_htonl32(uint32_t x) { return rv_bswap32(x); }
 static inline uint32_t rv_ntohl32(uint32_t x) { return rv_bswap32(x); }
 static inline uint64_t rv_htonll64(uint64_t x) { return rv_bswap64(x); }
 static inline uint64_t rv_ntohll64(uint64_t x) { return rv_bswap64(x); }
+#endif
+
+// Unaligned network-order loads straight from a datagram
+static inline uint16_t rv_load_be16(const uint8_t* p) { uint16_t x; memcpy(&x, p, 2); return rv_ntohs16(x); }
+static inline uint32_t rv_load_be32(const uint8_t* p) { uint32_t x; memcpy(&x, p, 4); return rv_ntohl32(x); }
+static inline uint64_t rv_load_be64(const uint8_t* p) { uint64_t x; memcpy(&x, p, 8); return rv_ntohll64(x); }
+static inline void rv_store_be16(uint8_t* p, uint16_t x) { x = rv_htons16(x); memcpy(p, &x, 2); }
+static inline void rv_store_be32(uint8_t* p, uint32_t x) { x = rv_htonl32(x); memcpy(p, &x, 4); }
+
+// One datagram, validated once. Fields are host order; payload points into
+// the datagram, nothing is copied. ext bits are reported, not interpreted.
+typedef struct rv_pkt_view {
+    uint8_t  version;     // RV_PROTO_VER or RV_PROTO_VER2
+    uint8_t  type;        // rv_pkt_type_t
+    uint8_t  flags;
+    uint8_t  ext;
+    uint8_t  level;       // RV_EXT_LEVEL, RV_LEVEL_SILENT when absent
+    uint16_t speaker_id;
+    uint16_t seq;
+    uint16_t hdr_len;     // bytes before payload
+    uint16_t payload_len; // > 0
+    const uint8_t* payload;
+} rv_pkt_view_t;
 
-int rv_build_join_packet(uint8_t* out, int out_cap, uint64_t session_id, uint16_t player_id);
+// Parse either header version. Returns 0 or <0 on a malformed datagram.
+int rv_pkt_view_parse(const uint8_t* buf, int len, rv_pkt_view_t* out);
+
+// Typed payload accessors for a parsed view (out pointers may be NULL)
+int rv_pkt_view_join(const rv_pkt_view_t* v, uint64_t* out_session_id, uint16_t* out_player_id,
+                     uint16_t* out_caps);
+int rv_pkt_view_join_ack(const rv_pkt_view_t* v, uint8_t* out_wire_version);
+int rv_pkt_view_report(const rv_pkt_view_t* v, rv_report_t* out);
+int rv_pkt_view_interest(const rv_pkt_view_t* v, rv_interest_t* out);
+
+// BUNDLE: step through the datagrams it carries. *pos starts at 0.
+// Returns 1 with the next one, 0 after the last, <0 if malformed.
+int rv_pkt_view_bundle_next(const rv_pkt_view_t* v, uint32_t* pos,
+                            const uint8_t** out_pkt, uint16_t* out_len);
+
+// PEER: the session and the datagram it carries; the hops are v->seq
+int rv_pkt_view_peer(const rv_pkt_view_t* v, uint64_t* out_session_id,
+                     const uint8_t** out_pkt, uint16_t* out_len);
+
+// VOICE with RV_EXT_TS: read the sender timestamp and advance the view's
+// payload past it. Returns 1 if present, 0 if not, <0 if malformed.
+int rv_pkt_view_take_ts(rv_pkt_view_t* v, uint32_t* out_ts_us);
+
+// VOICE with RV_EXT_ENC: locate the associated data (header + roc), the
+// ciphertext and the tag. Returns 0 or <0 if not sealed / malformed.
+int rv_pkt_view_enc(const rv_pkt_view_t* v, uint16_t* out_roc,
+                    const uint8_t** out_aad, uint16_t* out_aad_len,
+                    const uint8_t** out_ct, uint16_t* out_ct_len,
+                    const uint8_t** out_tag);
+
+// Turn a built VOICE packet into the ENC layout in place: set RV_EXT_ENC,
+// insert roc in front of the payload and count RV_ENC_TAG_LEN trailing
+// bytes. Returns the new length including the (unwritten) tag; the
+// plaintext starts at *out_aad_len.
+int rv_pkt_enc_prepare(uint8_t* pkt, int len, int cap, uint16_t roc, int* out_aad_len);
+
+int rv_build_join_packet(uint8_t* out, int out_cap, uint64_t session_id, uint16_t player_id, uint16_t caps);
+// The same JOIN resent to stay in the session; count (never 0) goes in
+// the header seq, so the relay can tell it from a reconnect
+int rv_build_keepalive_packet(uint8_t* out, int out_cap, uint64_t session_id, uint16_t player_id,
+                              uint16_t caps, uint16_t count);
+
+int rv_build_join_ack_packet(uint8_t* out, int out_cap, uint8_t wire_version);
+
+int rv_build_report_packet(uint8_t* out, int out_cap, uint8_t wire_version,
+                           uint16_t reporter_id, const rv_report_t* report);
+
+int rv_build_interest_packet(uint8_t* out, int out_cap, uint8_t wire_version,
+                             uint16_t player_id, const rv_interest_t* interest);
+
+// BUNDLE: write the header, then append datagrams. Append returns the new
+// length, or <0 (out untouched) when the datagram does not fit in out_cap.
+int rv_build_bundle_header(uint8_t* out, int out_cap);
+int rv_bundle_append(uint8_t* out, int len, int out_cap, const uint8_t* pkt, int pkt_len);
+
+// PEER around one client datagram
+int rv_build_peer_packet(uint8_t* out, int out_cap, uint64_t session_id, uint16_t hops,
+                         const uint8_t* pkt, int pkt_len);
 
 // New: voice packet builder with flags.
 int rv_build_voice_packet_ex(uint8_t* out, int out_cap,
@@ -83,6 +305,26 @@ int rv_build_voice_packet_ex(uint8_t* out, int out_cap,
                              uint8_t flags,
                              const uint8_t* payload, uint16_t payload_len);
 
+typedef struct rv_red_block {
+    uint8_t seq_offset;   // 1..255 frames before the packet's seq
+    uint8_t len;
+    const uint8_t* data;
+} rv_red_block_t;
+
+// Voice packet with an optional sender timestamp (ts_us NULL = none),
+// audio level (level NULL = none, needs RV_PROTO_VER2) and RED blocks in
+// front of the primary frame, in header version wire_version. Without
+// any of them and with RV_PROTO_VER this is identical to
+// rv_build_voice_packet_ex.
+int rv_build_voice_packet_red(uint8_t* out, int out_cap,
+                              uint8_t wire_version,
+                              uint16_t speaker_id, uint16_t seq,
+                              uint8_t flags,
+                              const uint32_t* ts_us,
+                              const uint8_t* level,
+                              const rv_red_block_t* red, int red_count,
+                              const uint8_t* primary, uint16_t primary_len);
+
 // Back-compat wrapper (flags=0)
 static inline int rv_build_voice_packet(uint8_t* out, int out_cap,
                                         uint16_t speaker_id, uint16_t seq,
@@ -90,10 +332,22 @@ static inline int rv_build_voice_packet(uint8_t* out, int out_cap,
     return rv_build_voice_packet_ex(out, out_cap, speaker_id, seq, 0, payload, payload_len);
 }
 
+// Accepts v1 and v2 headers. For v2, magic is filled in as RV_MAGIC and
+// payload_len is derived from the datagram length.
 int rv_parse_packet_header(const uint8_t* buf, int len, rv_pkt_hdr_t* out_hdr_host);
 
-// JOIN parser
-int rv_parse_join_payload(const uint8_t* buf, int len, uint64_t* out_session_id, uint16_t* out_player_id);
+// JOIN parser (out_caps may be NULL)
+int rv_parse_join_payload(const uint8_t* buf, int len, uint64_t* out_session_id, uint16_t* out_player_id,
+                          uint16_t* out_caps);
+
+// JOIN_ACK parser
+int rv_parse_join_ack(const uint8_t* buf, int len, uint8_t* out_wire_version);
+
+// Split a RED payload (hdr.ext & RV_EXT_RED) into its blocks and the
+// primary frame. Block data points into payload.
+int rv_parse_red_payload(const uint8_t* payload, uint16_t payload_len,
+                         rv_red_block_t* out_blocks, int max_blocks, int* out_count,
+                         const uint8_t** out_primary, uint16_t* out_primary_len);
 
 // VOICE parser
 int rv_parse_voice_packet(const uint8_t* buf, int len,
@@ -5,6 +5,7 @@
 
 struct rv_opus_enc {
     OpusEncoder* enc;
+    OpusRepacketizer* rp;        // created on first rv_opus_enc_pack
     rv_opus_config_t cfg;
     int frame_samples;
 };
@@ -19,6 +20,12 @@ static int frame_samples(int sample_rate, int frame_ms) {
     return (sample_rate / 1000) * frame_ms;
 }
 
+static int opus_signal(int signal) {
+    if (signal == RV_OPUS_SIGNAL_VOICE) return OPUS_SIGNAL_VOICE;
+    if (signal == RV_OPUS_SIGNAL_MUSIC) return OPUS_SIGNAL_MUSIC;
+    return OPUS_AUTO;
+}
+
 rv_opus_enc_t* rv_opus_enc_create(const rv_opus_config_t* cfg) {
     if (!cfg) return NULL;
     int err = 0;
@@ -35,14 +42,62 @@ rv_opus_enc_t* rv_opus_enc_create(const rv_opus_config_t* cfg) {
 
     opus_encoder_ctl(e->enc, OPUS_SET_BITRATE(cfg->bitrate_bps));
     opus_encoder_ctl(e->enc, OPUS_SET_INBAND_FEC(cfg->use_fec ? 1 : 0));
-    opus_encoder_ctl(e->enc, OPUS_SET_PACKET_LOSS_PERC(5));
+    opus_encoder_ctl(e->enc, OPUS_SET_PACKET_LOSS_PERC(cfg->expected_loss_pct));
+    opus_encoder_ctl(e->enc, OPUS_SET_DTX(cfg->use_dtx ? 1 : 0));
+    opus_encoder_ctl(e->enc, OPUS_SET_COMPLEXITY(cfg->complexity));
+    opus_encoder_ctl(e->enc, OPUS_SET_SIGNAL(opus_signal(cfg->signal)));
 
     return e;
 }
 
+int rv_opus_enc_apply(rv_opus_enc_t* e, const rv_opus_config_t* cfg) {
+    if (!e || !cfg) return -1;
+
+    rv_opus_config_t* cur = &e->cfg;
+    int r = 0;
+
+    if (cfg->bitrate_bps != cur->bitrate_bps) {
+        if (opus_encoder_ctl(e->enc, OPUS_SET_BITRATE(cfg->bitrate_bps)) == OPUS_OK)
+            cur->bitrate_bps = cfg->bitrate_bps;
+        else r = -2;
+    }
+    if ((cfg->use_fec != 0) != (cur->use_fec != 0)) {
+        if (opus_encoder_ctl(e->enc, OPUS_SET_INBAND_FEC(cfg->use_fec ? 1 : 0)) == OPUS_OK)
+            cur->use_fec = cfg->use_fec;
+        else r = -2;
+    }
+    if (cfg->expected_loss_pct != cur->expected_loss_pct) {
+        if (opus_encoder_ctl(e->enc, OPUS_SET_PACKET_LOSS_PERC(cfg->expected_loss_pct)) == OPUS_OK)
+            cur->expected_loss_pct = cfg->expected_loss_pct;
+        else r = -2;
+    }
+    if ((cfg->use_dtx != 0) != (cur->use_dtx != 0)) {
+        if (opus_encoder_ctl(e->enc, OPUS_SET_DTX(cfg->use_dtx ? 1 : 0)) == OPUS_OK)
+            cur->use_dtx = cfg->use_dtx;
+        else r = -2;
+    }
+    if (cfg->complexity != cur->complexity) {
+        if (opus_encoder_ctl(e->enc, OPUS_SET_COMPLEXITY(cfg->complexity)) == OPUS_OK)
+            cur->complexity = cfg->complexity;
+        else r = -2;
+    }
+    if (cfg->signal != cur->signal) {
+        if (opus_encoder_ctl(e->enc, OPUS_SET_SIGNAL(opus_signal(cfg->signal))) == OPUS_OK)
+            cur->signal = cfg->signal;
+        else r = -2;
+    }
+
+    return r;
+}
+
+const rv_opus_config_t* rv_opus_enc_config(const rv_opus_enc_t* e) {
+    return e ? &e->cfg : NULL;
+}
+
 void rv_opus_enc_destroy(rv_opus_enc_t* e) {
     if (!e) return;
     if (e->enc) opus_encoder_destroy(e->enc);
+    if (e->rp) opus_repacketizer_destroy(e->rp);
     free(e);
 }
 
@@ -79,6 +134,69 @@ int rv_opus_encode(rv_opus_enc_t* e,
     return opus_encode(e->enc, pcm, pcm_samples_per_ch, out, out_cap);
 }
 
+int rv_opus_enc_pack(rv_opus_enc_t* e,
+                     const uint8_t* const* frames,
+                     const uint16_t* frame_lens,
+                     int frame_count,
+                     int* out_consumed,
+                     uint8_t* out,
+                     int out_cap) {
+    if (!e || !frames || !frame_lens || frame_count <= 0 || !out_consumed || !out) return -1;
+    *out_consumed = 0;
+
+    if (frame_count == 1) {
+        if (frame_lens[0] > out_cap) return -2;
+        memcpy(out, frames[0], frame_lens[0]);
+        *out_consumed = 1;
+        return frame_lens[0];
+    }
+
+    if (!e->rp) {
+        e->rp = opus_repacketizer_create();
+        if (!e->rp) return -1;
+    }
+    opus_repacketizer_init(e->rp);
+
+    int n = 0;
+    while (n < frame_count) {
+        if (opus_repacketizer_cat(e->rp, frames[n], frame_lens[n]) != OPUS_OK) break;
+        ++n;
+    }
+    if (n == 0) return -2;
+
+    int len = opus_repacketizer_out(e->rp, out, out_cap);
+    if (len <= 0) return -2;
+
+    *out_consumed = n;
+    return len;
+}
+
+int rv_opus_packet_split(const uint8_t* packet,
+                         int packet_len,
+                         uint8_t* out,
+                         int out_cap,
+                         uint16_t* out_lens,
+                         int max_frames) {
+    if (!packet || packet_len <= 0 || !out || !out_lens || max_frames <= 0) return -1;
+
+    unsigned char toc = 0;
+    const unsigned char* frames[48];
+    opus_int16 sizes[48];
+    int n = opus_packet_parse(packet, packet_len, &toc, frames, sizes, NULL);
+    if (n <= 0 || n > max_frames) return -2;
+
+    // Code 0 packet per frame: same configuration, one frame
+    int off = 0;
+    for (int i = 0; i < n; ++i) {
+        if (off + 1 + sizes[i] > out_cap) return -2;
+        out[off] = (uint8_t)(toc & 0xFCu);
+        memcpy(out + off + 1, frames[i], (size_t)sizes[i]);
+        out_lens[i] = (uint16_t)(1 + sizes[i]);
+        off += 1 + sizes[i];
+    }
+    return n;
+}
+
 int rv_opus_decode(rv_opus_dec_t* d,
                    const uint8_t* packet,
                    int packet_len,
@@ -96,3 +214,20 @@ int rv_opus_decode(rv_opus_dec_t* d,
                        d->frame_samples,
                        fec);
 }
+
+int rv_opus_decode_fec(rv_opus_dec_t* d,
+                       const uint8_t* next_packet,
+                       int next_packet_len,
+                       int16_t* out_pcm,
+                       int out_samples_per_ch) {
+    if (!d || !next_packet || next_packet_len <= 0 || !out_pcm) return -1;
+    if (out_samples_per_ch < d->frame_samples) return -2;
+
+    // frame_size must be exactly the duration of the lost frame
+    return opus_decode(d->dec,
+                       next_packet,
+                       next_packet_len,
+                       out_pcm,
+                       d->frame_samples,
+                       1);
+}
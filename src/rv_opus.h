@@ -10,11 +10,27 @@ typedef struct rv_opus_config {
     int frame_ms;      // 20
     int bitrate_bps;   // 20000 typical start
     int use_fec;       // 0/1
+    int use_dtx;       // 0/1, silent frames shrink to TOC-only packets
+    int complexity;    // 0..10
+    int expected_loss_pct; // 0..100, tunes FEC strength
+    int signal;        // RV_OPUS_SIGNAL_*
 } rv_opus_config_t;
 
+#define RV_OPUS_SIGNAL_AUTO  0
+#define RV_OPUS_SIGNAL_VOICE 1
+#define RV_OPUS_SIGNAL_MUSIC 2
+
 rv_opus_enc_t* rv_opus_enc_create(const rv_opus_config_t* cfg);
 void rv_opus_enc_destroy(rv_opus_enc_t* e);
 
+// Re-apply bitrate / complexity / FEC / loss / signal / DTX at runtime.
+// Only settings that differ from the current ones are pushed to the codec.
+// sample_rate, channels and frame_ms cannot change and are ignored.
+int rv_opus_enc_apply(rv_opus_enc_t* e, const rv_opus_config_t* cfg);
+
+// Settings currently applied to the encoder.
+const rv_opus_config_t* rv_opus_enc_config(const rv_opus_enc_t* e);
+
 rv_opus_dec_t* rv_opus_dec_create(const rv_opus_config_t* cfg);
 void rv_opus_dec_destroy(rv_opus_dec_t* d);
 
@@ -29,3 +45,33 @@ int rv_opus_decode(rv_opus_dec_t* d,
                    int packet_len,
                    int16_t* out_pcm,
                    int out_samples_per_ch);
+
+// Join consecutive single-frame packets from this encoder into one
+// multi-frame Opus packet. Packs as many leading frames as share one TOC
+// configuration (mode / bandwidth can change between frames) and reports
+// how many were consumed. Returns the packet length or <0 on error.
+int rv_opus_enc_pack(rv_opus_enc_t* e,
+                     const uint8_t* const* frames,
+                     const uint16_t* frame_lens,
+                     int frame_count,
+                     int* out_consumed,
+                     uint8_t* out,
+                     int out_cap);
+
+// Split a (possibly multi-frame) Opus packet into self-contained
+// single-frame packets laid out back to back in out; out_lens[i] is the
+// length of frame i. Returns the frame count or <0 on error.
+int rv_opus_packet_split(const uint8_t* packet,
+                         int packet_len,
+                         uint8_t* out,
+                         int out_cap,
+                         uint16_t* out_lens,
+                         int max_frames);
+
+// Recover the frame *before* next_packet from its in-band FEC (LBRR).
+// Falls back to PLC inside Opus when next_packet carries no LBRR data.
+int rv_opus_decode_fec(rv_opus_dec_t* d,
+                       const uint8_t* next_packet,
+                       int next_packet_len,
+                       int16_t* out_pcm,
+                       int out_samples_per_ch);
@@ -56,6 +56,12 @@ void rv_opus_jitter_push(rv_opus_jitter_t* jb, uint16_t seq, const uint8_t* data
     if (!jb || !data) return;
     if (len == 0 || len > RV_OPUS_MAX_PACKET) return;
 
+    /*
+     * Too late to play: drop it rather than parking it in a slot it would
+     * never leave, which would also make the buffer look non-empty.
+     */
+    if (jb->started && (int16_t)(uint16_t)(seq - jb->next_play_seq) < 0) return;
+
     uint32_t slot = slot_for_seq(seq);
 
     jb->packets[slot].seq = seq;
@@ -74,11 +80,37 @@ void rv_opus_jitter_push(rv_opus_jitter_t* jb, uint16_t seq, const uint8_t* data
     }
 }
 
-int rv_opus_jitter_pop(rv_opus_jitter_t* jb, const uint8_t** out_data, uint16_t* out_len)
+void rv_opus_jitter_push_redundant(rv_opus_jitter_t* jb, uint16_t seq, const uint8_t* data, uint16_t len)
+{
+    if (!jb || !data || !jb->started) return;
+    if (len == 0 || len > RV_OPUS_MAX_PACKET) return;
+    if ((int16_t)(uint16_t)(seq - jb->next_play_seq) < 0) return;
+
+    uint32_t slot = slot_for_seq(seq);
+    if (jb->packets[slot].valid && jb->packets[slot].seq == seq) return;
+
+    rv_opus_jitter_push(jb, seq, data, len);
+}
+
+void rv_opus_jitter_resync(rv_opus_jitter_t* jb, uint16_t seq)
+{
+    if (!jb || !jb->started) return;
+
+    for (uint32_t i = 0; i < RV_OPUS_JITTER_CAP; ++i)
+    {
+        if (jb->packets[i].valid) return;
+    }
+
+    jb->next_play_seq = seq;
+}
+
+int rv_opus_jitter_pop(rv_opus_jitter_t* jb, const uint8_t** out_data, uint16_t* out_len, uint8_t* out_fec)
 {
     if (!jb || !out_data || !out_len) return 0;
     if (!jb->started) return 0;
 
+    if (out_fec) *out_fec = 0;
+
     uint16_t want = jb->next_play_seq;
     uint32_t slot = slot_for_seq(want);
 
@@ -93,6 +125,24 @@ int rv_opus_jitter_pop(rv_opus_jitter_t* jb, const uint8_t** out_data, uint16_t*
         return 1;
     }
 
+    uint16_t next = (uint16_t)(want + 1u);
+    uint32_t next_slot = slot_for_seq(next);
+
+    if (out_fec && jb->packets[next_slot].valid && jb->packets[next_slot].seq == next)
+    {
+        /*
+         * Single-packet gap with the successor already here: its in-band
+         * FEC (LBRR) carries a low-rate copy of the frame we are missing.
+         */
+        *out_data = jb->packets[next_slot].data;
+        *out_len = jb->packets[next_slot].len;
+        *out_fec = 1;
+
+        jb->next_play_seq++;
+
+        return 1;
+    }
+
     if (has_future_packet(jb, want))
     {
         /*
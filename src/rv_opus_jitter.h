@@ -25,5 +25,18 @@ typedef struct rv_opus_jitter {
 void rv_opus_jitter_init(rv_opus_jitter_t* jb);
 void rv_opus_jitter_push(rv_opus_jitter_t* jb, uint16_t seq, const uint8_t* data, uint16_t len);
 
-// out_data NULL + out_len 0 indicates PLC
-int rv_opus_jitter_pop(rv_opus_jitter_t* jb, const uint8_t** out_data, uint16_t* out_len);
+// Fill a hole from a redundant (RED) copy. Never replaces a primary packet
+// that is already buffered and never starts the stream by itself.
+void rv_opus_jitter_push_redundant(rv_opus_jitter_t* jb, uint16_t seq, const uint8_t* data, uint16_t len);
+
+// Re-anchor playback on the first packet of a new talkspurt. Only takes
+// effect when nothing is buffered, so a stream resuming after DTX silence
+// starts immediately instead of producing PLC for the skipped frames.
+void rv_opus_jitter_resync(rv_opus_jitter_t* jb, uint16_t seq);
+
+// out_data NULL + out_len 0 indicates PLC.
+// If out_fec is non-NULL and the missing frame's successor is buffered,
+// *out_fec is set to 1 and out_data/out_len point at that successor: decode
+// it with FEC to recover the lost frame. The successor stays buffered and
+// is returned normally by the next pop.
+int rv_opus_jitter_pop(rv_opus_jitter_t* jb, const uint8_t** out_data, uint16_t* out_len, uint8_t* out_fec);
@@ -1,84 +1,1224 @@
 #include "rv_relay.h"
+#include "rv_netproto.h"
+#include "rv_relay_bundle.h"
+#include "rv_relay_metrics.h"
+#include "rv_relay_mix.h"
+#include "rv_relay_wheel.h"
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-static int addr_equal(const rv_sockaddr_t* a, const rv_sockaddr_t* b) {
-    if (a->ver != b->ver) return 0;
-    if (a->port != b->port) return 0;
-    if (a->ver == RV_IPV4) return memcmp(a->ip.v4, b->ip.v4, 4) == 0;
-    return memcmp(a->ip.v6, b->ip.v6, 16) == 0;
+#define RV_RELAY_MIN_SLOTS    64   // hash table size before the first growth
+#define RV_RELAY_MIN_SESSIONS 16
+#define RV_RELAY_MIN_CLIENTS  4
+
+static const uint8_t k_v4_mapped_prefix[12] = { 0,0,0,0, 0,0,0,0, 0,0,0xFF,0xFF };
+
+// ---- Hashing ----
+// Session ids and addresses come off the wire, so the hash is seeded per
+// process to keep crafted keys from piling into one probe run.
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint32_t hash_session(const rv_relay_state_t* st, uint64_t session_id) {
+    return (uint32_t)mix64(session_id ^ st->hash_seed);
+}
+
+static rv_relay_ep_key_t ep_key(const rv_sockaddr_t* a) {
+    rv_relay_ep_key_t k;
+    memset(&k, 0, sizeof(k));
+    if (a->ver == RV_IPV4) {
+        memcpy(k.ip, k_v4_mapped_prefix, 12);
+        memcpy(k.ip + 12, a->ip.v4, 4);
+    } else {
+        memcpy(k.ip, a->ip.v6, 16);
+    }
+    k.port = a->port;
+    k.ver = (uint16_t)a->ver;
+    return k;
+}
+
+static uint32_t hash_key(uint64_t seed, const rv_relay_ep_key_t* k) {
+    uint64_t a, b;
+    uint32_t c;
+    memcpy(&a, k->ip, 8);
+    memcpy(&b, k->ip + 8, 8);
+    memcpy(&c, &k->port, 4);
+    return (uint32_t)mix64(a ^ mix64(b ^ mix64((uint64_t)c ^ seed)));
+}
+
+static uint32_t hash_ep(const rv_relay_state_t* st, const rv_relay_ep_key_t* k) {
+    return hash_key(st->hash_seed, k);
+}
+
+static int ep_key_equal(const rv_relay_ep_key_t* a, const rv_relay_ep_key_t* b) {
+    return memcmp(a, b, sizeof(*a)) == 0;
+}
+
+// j lies cyclically in (i, home]: the entry at j may not move back to i
+static int probe_keeps(uint32_t i, uint32_t j, uint32_t home) {
+    return i <= j ? (home > i && home <= j) : (home > i || home <= j);
+}
+
+// ---- Session index: session_id -> slab index ----
+
+static uint32_t* session_slot(const rv_relay_state_t* st, uint64_t session_id) {
+    const uint32_t mask = st->session_index_cap - 1;
+    uint32_t i = hash_session(st, session_id) & mask;
+    for (;;) {
+        const uint32_t v = st->session_index[i];
+        if (v == 0 || st->sessions[v - 1].session_id == session_id) return &st->session_index[i];
+        i = (i + 1) & mask;
+    }
+}
+
+static int session_index_reserve(rv_relay_state_t* st) {
+    if ((st->session_count + 1) * 2 <= st->session_index_cap) return 0;
+
+    const uint32_t cap = st->session_index_cap ? st->session_index_cap * 2 : RV_RELAY_MIN_SLOTS;
+    uint32_t* idx = (uint32_t*)calloc(cap, sizeof(uint32_t));
+    if (!idx) return -1;
+
+    free(st->session_index);
+    st->session_index = idx;
+    st->session_index_cap = cap;
+    for (uint32_t s = 0; s < st->sessions_cap; ++s) {
+        if (st->sessions[s].in_use) *session_slot(st, st->sessions[s].session_id) = s + 1;
+    }
+    return 0;
+}
+
+static void session_index_remove(rv_relay_state_t* st, uint32_t* slot) {
+    const uint32_t mask = st->session_index_cap - 1;
+    uint32_t i = (uint32_t)(slot - st->session_index);
+    uint32_t j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        const uint32_t v = st->session_index[j];
+        if (v == 0) break;
+        const uint32_t home = hash_session(st, st->sessions[v - 1].session_id) & mask;
+        if (probe_keeps(i, j, home)) continue;
+        st->session_index[i] = v;
+        i = j;
+    }
+    st->session_index[i] = 0;
+}
+
+// ---- Endpoint index: address -> (session, member) ----
+
+static rv_relay_ep_t* ep_slot(const rv_relay_state_t* st, const rv_relay_ep_key_t* k) {
+    const uint32_t mask = st->endpoints_cap - 1;
+    uint32_t i = hash_ep(st, k) & mask;
+    for (;;) {
+        rv_relay_ep_t* e = &st->endpoints[i];
+        if (e->session == 0 || ep_key_equal(&e->key, k)) return e;
+        i = (i + 1) & mask;
+    }
+}
+
+static rv_relay_ep_t* ep_find(const rv_relay_state_t* st, const rv_relay_ep_key_t* k) {
+    if (st->endpoints_cap == 0) return NULL;
+    rv_relay_ep_t* e = ep_slot(st, k);
+    return e->session ? e : NULL;
+}
+
+static int ep_reserve(rv_relay_state_t* st) {
+    if ((st->client_count + 1) * 2 <= st->endpoints_cap) return 0;
+
+    const uint32_t old_cap = st->endpoints_cap;
+    rv_relay_ep_t* old = st->endpoints;
+    const uint32_t cap = old_cap ? old_cap * 2 : RV_RELAY_MIN_SLOTS;
+    rv_relay_ep_t* eps = (rv_relay_ep_t*)calloc(cap, sizeof(rv_relay_ep_t));
+    if (!eps) return -1;
+
+    st->endpoints = eps;
+    st->endpoints_cap = cap;
+    for (uint32_t i = 0; i < old_cap; ++i) {
+        if (old[i].session) *ep_slot(st, &old[i].key) = old[i];
+    }
+    free(old);
+    return 0;
+}
+
+static void ep_remove(rv_relay_state_t* st, rv_relay_ep_t* e) {
+    const uint32_t mask = st->endpoints_cap - 1;
+    uint32_t i = (uint32_t)(e - st->endpoints);
+    uint32_t j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        const rv_relay_ep_t* n = &st->endpoints[j];
+        if (n->session == 0) break;
+        if (probe_keeps(i, j, hash_ep(st, &n->key) & mask)) continue;
+        st->endpoints[i] = *n;
+        i = j;
+    }
+    memset(&st->endpoints[i], 0, sizeof(st->endpoints[i]));
+}
+
+// ---- Sessions ----
+
+void rv_relay_init(rv_relay_state_t* st) {
+    memset(st, 0, sizeof(*st));
+    st->hash_seed = mix64((uint64_t)(uintptr_t)st ^ (uint64_t)time(NULL));
+}
+
+void rv_relay_free(rv_relay_state_t* st) {
+    if (!st) return;
+    for (uint32_t s = 0; s < st->sessions_cap; ++s) {
+        if (!st->sessions[s].in_use) continue;
+        free(st->sessions[s].clients);
+        free(st->sessions[s].grid_start);
+        free(st->sessions[s].grid_items);
+        free(st->sessions[s].remotes);
+    }
+    free(st->sessions);
+    free(st->session_index);
+    free(st->endpoints);
+    memset(st, 0, sizeof(*st));
+}
+
+static rv_relay_session_t* find_session(const rv_relay_state_t* st, uint64_t session_id) {
+    if (st->session_index_cap == 0) return NULL;
+    const uint32_t v = *session_slot(st, session_id);
+    return v ? &st->sessions[v - 1] : NULL;
+}
+
+// Returns the slab index + 1, or 0 when out of memory
+static uint32_t find_or_create_session(rv_relay_state_t* st, uint64_t session_id) {
+    const rv_relay_session_t* found = find_session(st, session_id);
+    if (found) return (uint32_t)(found - st->sessions) + 1;
+
+    if (session_index_reserve(st) != 0) return 0;
+
+    if (st->free_session == 0) {
+        const uint32_t cap = st->sessions_cap ? st->sessions_cap * 2 : RV_RELAY_MIN_SESSIONS;
+        rv_relay_session_t* grown = (rv_relay_session_t*)realloc(st->sessions, cap * sizeof(*grown));
+        if (!grown) return 0;
+        memset(grown + st->sessions_cap, 0, (cap - st->sessions_cap) * sizeof(*grown));
+        for (uint32_t i = cap; i-- > st->sessions_cap;) {
+            grown[i].next_free = st->free_session;
+            st->free_session = i + 1;
+        }
+        st->sessions = grown;
+        st->sessions_cap = cap;
+    }
+
+    const uint32_t v = st->free_session;
+    rv_relay_session_t* s = &st->sessions[v - 1];
+    st->free_session = s->next_free;
+    memset(s, 0, sizeof(*s));
+    s->in_use = 1;
+    s->session_id = session_id;
+    s->wire_ver = RV_PROTO_VER2;
+    *session_slot(st, session_id) = v;
+    st->session_count++;
+    return v;
+}
+
+static void remove_session(rv_relay_state_t* st, uint32_t v) {
+    rv_relay_session_t* s = &st->sessions[v - 1];
+    session_index_remove(st, session_slot(st, s->session_id));
+    if (s->mix) rv_relay_mix_close(st->mixer, s->mix);
+    free(s->clients);
+    free(s->grid_start);
+    free(s->grid_items);
+    free(s->remotes);
+    memset(s, 0, sizeof(*s));
+    s->next_free = st->free_session;
+    st->free_session = v;
+    st->session_count--;
+}
+
+static uint8_t session_wire_ver(const rv_relay_session_t* s) {
+    uint8_t ver = RV_PROTO_VER2;
+    for (uint32_t i = 0; i < s->count; i++) {
+        if (!s->clients[i].peer && s->clients[i].wire_ver < ver) ver = s->clients[i].wire_ver;
+    }
+    return ver;
+}
+
+// JOIN_ACK with the session's wire version to member m, or to every client
+// when m < 0
+static void send_acks(const rv_relay_session_t* s, int m, void* send_ctx, rv_relay_send_fn send_fn) {
+    if (!send_fn) return;
+    uint8_t ack[32];
+    const int ack_len = rv_build_join_ack_packet(ack, (int)sizeof(ack), s->wire_ver);
+    if (ack_len <= 0) return;
+
+    for (uint32_t i = 0; i < s->count; i++) {
+        if ((m >= 0 && (int)i != m) || s->clients[i].peer) continue;
+        (void)send_fn(send_ctx, &s->clients[i].addr, ack, ack_len);
+    }
 }
 
-static rv_relay_session_t* find_or_create_session(rv_relay_state_t* st, uint64_t session_id) {
-    for (int i = 0; i < RV_RELAY_MAX_SESSIONS; i++) {
-        if (st->sessions[i].in_use && st->sessions[i].session_id == session_id) {
-            return &st->sessions[i];
+// ---- Mixing ----
+// A session mixes from the mixer's min_members on and stops below half of
+// that, so it does not switch back and forth with every join and leave.
+
+static void mix_update(rv_relay_state_t* st, rv_relay_session_t* s) {
+    if (!st->mixer) return;
+    const uint32_t min = st->mixer->min_members;
+    const uint32_t clients = s->count - s->peers;   // peer relays mix for themselves
+    if (!s->mix && clients >= min) {
+        s->mix = rv_relay_mix_open(st->mixer, (uint32_t)(s - st->sessions));
+    } else if (s->mix && clients < (min + 1) / 2) {
+        rv_relay_mix_close(st->mixer, s->mix);
+        s->mix = NULL;
+    }
+
+    // The mix is one sum for the whole session, so members filtering by
+    // channel or range keep getting the forwards they picked
+    s->unmixed = 0;
+    for (uint32_t i = 0; i < s->count; i++) {
+        rv_relay_client_t* c = &s->clients[i];
+        c->mixed = (uint8_t)(s->mix && c->mix && !c->has_interest);
+        if (!c->mixed) s->unmixed++;
+    }
+}
+
+// ---- Members ----
+
+// A timer for a new endpoint, due idle_us from now: its generation, or 0
+// without idle eviction or memory. A timer left behind by a failed join
+// finds no member with its generation and is dropped.
+static uint32_t idle_arm(rv_relay_state_t* st, const rv_relay_ep_key_t* key) {
+    if (!st->idle) return 0;
+    const uint32_t gen = rv_relay_wheel_gen(st->idle);
+    return rv_relay_wheel_add(st->idle, key, gen, st->now_us + st->idle_us) == 0 ? gen : 0;
+}
+
+// Room for one more member
+static int reserve_member(rv_relay_session_t* s) {
+    if (s->count == RV_RELAY_MAX_CLIENTS_PER_SESSION) return -1;
+    if (s->count < s->cap) return 0;
+
+    uint32_t cap = s->cap ? s->cap * 2 : RV_RELAY_MIN_CLIENTS;
+    if (cap > RV_RELAY_MAX_CLIENTS_PER_SESSION) cap = RV_RELAY_MAX_CLIENTS_PER_SESSION;
+    rv_relay_client_t* grown = (rv_relay_client_t*)realloc(s->clients, cap * sizeof(*grown));
+    if (!grown) return -1;
+    s->clients = grown;
+    s->cap = cap;
+    return 0;
+}
+
+static int add_member(rv_relay_state_t* st, uint32_t v, uint16_t player_id,
+                      const rv_sockaddr_t* from, const rv_relay_ep_key_t* key) {
+    rv_relay_session_t* s = &st->sessions[v - 1];
+    if (reserve_member(s) != 0) return -1;
+    if (ep_reserve(st) != 0) return -1;
+
+    const uint32_t gen = idle_arm(st, key);
+    if (st->idle && !gen) return -1;
+
+    const uint32_t m = s->count++;
+    memset(&s->clients[m], 0, sizeof(s->clients[m]));
+    s->clients[m].player_id = player_id;
+    s->clients[m].addr = *from;
+    s->clients[m].idle_gen = gen;
+
+    rv_relay_ep_t* e = ep_slot(st, key);
+    e->key = *key;
+    e->session = v;
+    e->member = m;
+    st->client_count++;
+    s->grid_dirty = 1;
+    return (int)m;
+}
+
+// Remote speakers follow their peer's member index, and leave with it
+static void peer_removed(rv_relay_session_t* s, uint32_t m, uint32_t last) {
+    for (uint32_t i = s->remote_count; i-- > 0;) {
+        rv_relay_remote_t* r = &s->remotes[i];
+        if (r->peer == m) *r = s->remotes[--s->remote_count];
+        else if (r->peer == last) r->peer = (uint16_t)m;
+    }
+}
+
+// Swap-remove keeps clients[] dense; the moved member's index entry follows.
+// Drops the session with its last client, unless it still links two relays.
+static void remove_member(rv_relay_state_t* st, uint32_t v, uint32_t m,
+                          void* send_ctx, rv_relay_send_fn send_fn) {
+    rv_relay_session_t* s = &st->sessions[v - 1];
+
+    if (s->clients[m].peer) {
+        s->peers--;
+    } else {
+        const rv_relay_ep_key_t key = ep_key(&s->clients[m].addr);
+        rv_relay_ep_t* e = ep_find(st, &key);
+        if (e) ep_remove(st, e);
+    }
+    st->client_count--;
+    if (s->clients[m].selected) s->selected--;
+
+    const uint32_t last = --s->count;
+    if (s->remote_count) peer_removed(s, m, last);
+    if (m != last) {
+        s->clients[m] = s->clients[last];
+        if (!s->clients[m].peer) {
+            const rv_relay_ep_key_t moved = ep_key(&s->clients[m].addr);
+            rv_relay_ep_t* e = ep_find(st, &moved);
+            if (e) e->member = m;
         }
     }
-    for (int i = 0; i < RV_RELAY_MAX_SESSIONS; i++) {
-        if (!st->sessions[i].in_use) {
-            st->sessions[i].in_use = 1;
-            st->sessions[i].session_id = session_id;
-            memset(st->sessions[i].clients, 0, sizeof(st->sessions[i].clients));
-            return &st->sessions[i];
+
+    // A lone peer has nobody to carry voice to or from
+    if (s->count == s->peers && s->peers <= 1) {
+        st->client_count -= s->count;
+        remove_session(st, v);
+        return;
+    }
+    // The last older client gone: tell the others they may send v2
+    const uint8_t prev = s->wire_ver;
+    s->wire_ver = session_wire_ver(s);
+    if (s->wire_ver != prev) send_acks(s, -1, send_ctx, send_fn);
+    s->grid_dirty = 1;
+    mix_update(st, s);
+}
+
+static int find_player(const rv_relay_session_t* s, uint16_t player_id) {
+    for (uint32_t i = 0; i < s->count; i++) {
+        if (s->clients[i].player_id == player_id && !s->clients[i].peer) return (int)i;
+    }
+    return -1;
+}
+
+// A JOIN starts a new connection: it hears everything until it sends
+// INTEREST, a bundle opened for the old address is left behind and the
+// mix starts a new talkspurt
+static void restart_client(rv_relay_session_t* s, uint32_t m) {
+    s->clients[m].has_interest = 0;
+    s->clients[m].mix_live = 0;
+    memset(&s->clients[m].bundle_ref, 0, sizeof(s->clients[m].bundle_ref));
+    s->grid_dirty = 1;
+}
+
+static int join_client(rv_relay_state_t* st, uint32_t v, uint16_t player_id, const rv_sockaddr_t* from,
+                       void* send_ctx, rv_relay_send_fn send_fn) {
+    const rv_relay_ep_key_t key = ep_key(from);
+    rv_relay_ep_t* e = ep_find(st, &key);
+
+    // One session per endpoint: leaving the old one may free it
+    if (e && e->session != v) {
+        remove_member(st, e->session, e->member, send_ctx, send_fn);
+        e = NULL;
+    }
+
+    rv_relay_session_t* s = &st->sessions[v - 1];
+    const int same_player = find_player(s, player_id);
+
+    if (e) {
+        // Known endpoint (client restarted): drop a stale entry for the player
+        if (same_player >= 0 && (uint32_t)same_player != e->member) {
+            remove_member(st, v, (uint32_t)same_player, send_ctx, send_fn);
+            e = ep_find(st, &key);
         }
+        s->clients[e->member].player_id = player_id;
+        restart_client(s, e->member);
+        return (int)e->member;
+    }
+
+    if (same_player >= 0) {
+        // Known player from a new address
+        if (ep_reserve(st) != 0) return -1;
+        const uint32_t gen = idle_arm(st, &key);
+        if (st->idle && !gen) return -1;
+        s->clients[same_player].idle_gen = gen;
+        const rv_relay_ep_key_t old = ep_key(&s->clients[same_player].addr);
+        rv_relay_ep_t* oe = ep_find(st, &old);
+        if (oe) ep_remove(st, oe);
+        s->clients[same_player].addr = *from;
+        e = ep_slot(st, &key);
+        e->key = key;
+        e->session = v;
+        e->member = (uint32_t)same_player;
+        restart_client(s, (uint32_t)same_player);
+        return same_player;
+    }
+
+    return add_member(st, v, player_id, from, &key);
+}
+
+// ---- Peers ----
+// Relays that cascade a session are members with peer set. They are not
+// in the endpoint index and have no idle timer: a peer is found by address
+// among the session's members, and voice reaches it wrapped in RV_PKT_PEER,
+// built once per packet in st->peer_pkt. Every remote speaker is bound to
+// the peer its voice comes through.
+
+static int find_peer(const rv_relay_session_t* s, const rv_sockaddr_t* addr) {
+    if (!s->peers) return -1;
+    const rv_relay_ep_key_t key = ep_key(addr);
+    for (uint32_t i = 0; i < s->count; i++) {
+        if (!s->clients[i].peer) continue;
+        const rv_relay_ep_key_t k = ep_key(&s->clients[i].addr);
+        if (ep_key_equal(&k, &key)) return (int)i;
+    }
+    return -1;
+}
+
+static int add_peer(rv_relay_state_t* st, uint32_t v, const rv_sockaddr_t* addr, uint8_t kind) {
+    rv_relay_session_t* s = &st->sessions[v - 1];
+    if (reserve_member(s) != 0) return -1;
+
+    const uint32_t m = s->count++;
+    memset(&s->clients[m], 0, sizeof(s->clients[m]));
+    s->clients[m].addr = *addr;
+    s->clients[m].peer = kind;
+    s->clients[m].wire_ver = RV_PROTO_VER2;
+    s->clients[m].seen_us = st->now_us;
+    s->peers++;
+    st->client_count++;
+    s->grid_dirty = 1;
+    mix_update(st, s);
+    return (int)m;
+}
+
+static rv_relay_remote_t* find_remote(const rv_relay_session_t* s, uint16_t speaker_id) {
+    for (uint32_t i = 0; i < s->remote_count; i++) {
+        if (s->remotes[i].speaker_id == speaker_id) return &s->remotes[i];
     }
     return NULL;
 }
 
-void rv_relay_init(rv_relay_state_t* st) {
-    memset(st, 0, sizeof(*st));
+// Voice peer m carries for a remote speaker. A local player's id coming
+// back is a loop. The speaker sticks to the first peer it arrives through,
+// so the same voice over a second path is dropped until the first has
+// not carried it for RV_RELAY_PEER_REBIND_MS.
+static int remote_admit(rv_relay_state_t* st, rv_relay_session_t* s, uint32_t m, uint16_t speaker_id) {
+    if (speaker_id == RV_MIX_SPEAKER || find_player(s, speaker_id) >= 0) return 0;
+
+    const uint64_t now = st->now_us;
+    rv_relay_remote_t* r = find_remote(s, speaker_id);
+    if (r) {
+        if (r->peer != m && now - r->seen_us < (uint64_t)RV_RELAY_PEER_REBIND_MS * 1000u) return 0;
+        r->peer = (uint16_t)m;
+        r->seen_us = now;
+        return 1;
+    }
+
+    if (s->remote_count == s->remote_cap) {
+        const uint32_t cap = s->remote_cap ? s->remote_cap * 2 : RV_RELAY_MIN_CLIENTS;
+        rv_relay_remote_t* grown = (rv_relay_remote_t*)realloc(s->remotes, cap * sizeof(*grown));
+        if (!grown) return 0;
+        s->remotes = grown;
+        s->remote_cap = cap;
+    }
+    r = &s->remotes[s->remote_count++];
+    r->speaker_id = speaker_id;
+    r->peer = (uint16_t)m;
+    r->seen_us = now;
+    return 1;
+}
+
+// The packet as peers get it, unless no peer but the sender would
+static void wrap_for_peers(rv_relay_state_t* st, const rv_relay_session_t* s, int from_peer, uint16_t hops,
+                           const uint8_t* pkt, int pkt_len) {
+    st->peer_len = 0;
+    if (s->peers <= (from_peer ? 1u : 0u)) return;
+    const int n = rv_build_peer_packet(st->peer_pkt, (int)sizeof(st->peer_pkt), s->session_id, hops,
+                                       pkt, pkt_len);
+    if (n > 0) st->peer_len = n;
 }
 
-void rv_relay_join(rv_relay_state_t* st, uint64_t session_id, uint16_t player_id, const rv_sockaddr_t* from) {
-    rv_relay_session_t* s = find_or_create_session(st, session_id);
-    if (!s) return;
+// A datagram for a remote player, through the peer its voice comes from
+// (not back to from_peer, the member it came through; -1 for a client)
+static void send_remote(const rv_relay_session_t* s, int from_peer, uint16_t player_id, uint16_t hops,
+                        const uint8_t* pkt, int pkt_len, void* send_ctx, rv_relay_send_fn send_fn) {
+    const rv_relay_remote_t* r = find_remote(s, player_id);
+    if (!r || (int)r->peer == from_peer) return;
+
+    uint8_t out[RV_RELAY_PEER_PKT];
+    const int n = rv_build_peer_packet(out, (int)sizeof(out), s->session_id, hops, pkt, pkt_len);
+    if (n > 0) (void)send_fn(send_ctx, &s->clients[r->peer].addr, out, n);
+}
+
+// A session new to this relay is joined at the upstream as well
+static void link_upstream(rv_relay_state_t* st, uint32_t v, void* send_ctx, rv_relay_send_fn send_fn) {
+    if (!st->has_upstream) return;
+    rv_relay_session_t* s = &st->sessions[v - 1];
+    int m = find_peer(s, &st->upstream);
+    if (m < 0) m = add_peer(st, v, &st->upstream, RV_RELAY_PEER_UP);
+    if (m < 0) return;
+    s->clients[m].peer = RV_RELAY_PEER_UP;   // also when it joined us first
+
+    if (!send_fn) return;
+    uint8_t join[32];
+    const int n = rv_build_join_packet(join, (int)sizeof(join), s->session_id, 0, RV_CAP_PEER | RV_CAP_V2);
+    if (n > 0) (void)send_fn(send_ctx, &st->upstream, join, n);
+}
+
+// ---- Interest ----
+// Radio voice is filtered by channel bit. Proximity voice goes through a
+// uniform grid of the members that have a position and a hearing range:
+// a packet visits the cells within the largest range around its sender,
+// unless that is more cells than the grid has buckets, then every member
+// in the grid. Buckets hold member indices, so only membership changes and
+// moves to another cell or a larger range force a rebuild.
+
+static int32_t grid_cell(int32_t v) {
+    const int32_t c = RV_RELAY_GRID_CELL;
+    return v >= 0 ? v / c : -((-v + c - 1) / c);
+}
+
+static uint32_t grid_hash(int32_t x, int32_t y, int32_t z) {
+    return ((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u) ^ ((uint32_t)z * 83492791u);
+}
+
+static int in_grid(const rv_relay_client_t* c) {
+    return c->has_interest && (c->interest.flags & RV_INTEREST_POS) && c->interest.range > 0;
+}
 
-    // Update existing by player_id
-    for (int i = 0; i < RV_RELAY_MAX_CLIENTS_PER_SESSION; i++) {
-        if (s->clients[i].in_use && s->clients[i].player_id == player_id) {
-            s->clients[i].addr = *from;
-            return;
+static uint32_t client_bucket(const rv_relay_client_t* c, uint32_t mask) {
+    const int16_t* p = c->interest.pos;
+    return grid_hash(grid_cell(p[0]), grid_cell(p[1]), grid_cell(p[2])) & mask;
+}
+
+static int same_cell(const rv_relay_client_t* a, const rv_interest_t* b) {
+    for (int d = 0; d < 3; ++d) {
+        if (grid_cell(a->interest.pos[d]) != grid_cell(b->pos[d])) return 0;
+    }
+    return 1;
+}
+
+static int hears_at(const rv_relay_client_t* c, const int16_t* p) {
+    int64_t d2 = 0;
+    for (int d = 0; d < 3; ++d) {
+        const int64_t k = (int64_t)c->interest.pos[d] - p[d];
+        d2 += k * k;
+    }
+    return d2 <= (int64_t)c->interest.range * c->interest.range;
+}
+
+// Voice to one listener, through its bundle when it takes them. With
+// unmixed_only set the packet went into the session mix, which reaches
+// the mixed members already.
+static void send_voice(rv_relay_state_t* st, rv_relay_client_t* c, int unmixed_only,
+                       const uint8_t* pkt, int pkt_len, void* send_ctx, rv_relay_send_fn send_fn) {
+    if (unmixed_only && c->mixed) return;
+    if (c->peer) {
+        // Wrapped once per packet by the caller
+        if (st->peer_len == 0) return;
+        if (st->metrics) st->metrics->forwards++;
+        (void)send_fn(send_ctx, &c->addr, st->peer_pkt, st->peer_len);
+        return;
+    }
+    if (st->metrics) st->metrics->forwards++;
+    if (c->bundle && st->bundler)
+        (void)rv_relay_bundler_add(st->bundler, &c->bundle_ref, &c->addr, pkt, pkt_len, st->now_us,
+                                   send_ctx, send_fn);
+    else
+        (void)send_fn(send_ctx, &c->addr, pkt, pkt_len);
+}
+
+static int grid_rebuild(rv_relay_session_t* s) {
+    uint32_t buckets = 8;
+    while (buckets < s->count) buckets *= 2;
+    if (s->grid_buckets != buckets) {
+        uint32_t* start = (uint32_t*)realloc(s->grid_start, (buckets + 1) * sizeof(uint32_t));
+        if (!start) return -1;
+        s->grid_start = start;
+        s->grid_buckets = buckets;
+    }
+    if (s->grid_cap < s->count) {
+        uint32_t* items = (uint32_t*)realloc(s->grid_items, s->cap * sizeof(uint32_t));
+        if (!items) return -1;
+        s->grid_items = items;
+        s->grid_cap = s->cap;
+    }
+
+    // Counting sort by bucket; start[] ends up as bucket begins
+    const uint32_t mask = buckets - 1;
+    uint32_t* start = s->grid_start;
+    memset(start, 0, (buckets + 1) * sizeof(uint32_t));
+    uint16_t range = 0;
+    for (uint32_t i = 0; i < s->count; i++) {
+        const rv_relay_client_t* c = &s->clients[i];
+        if (!in_grid(c)) continue;
+        start[client_bucket(c, mask)]++;
+        if (c->interest.range > range) range = c->interest.range;
+    }
+    uint32_t sum = 0;
+    for (uint32_t b = 0; b < buckets; b++) {
+        const uint32_t n = start[b];
+        start[b] = sum;
+        sum += n;
+    }
+    uint32_t n = sum;
+    for (uint32_t i = 0; i < s->count; i++) {
+        const rv_relay_client_t* c = &s->clients[i];
+        if (in_grid(c)) s->grid_items[start[client_bucket(c, mask)]++] = i;
+        else s->grid_items[n++] = i;
+    }
+    memmove(start + 1, start, buckets * sizeof(uint32_t));
+    start[0] = 0;
+
+    s->grid_count = n;
+    s->grid_range = range;
+    s->grid_dirty = 0;
+    return 0;
+}
+
+void rv_relay_set_interest(rv_relay_state_t* st, const rv_sockaddr_t* from,
+                           const rv_interest_t* interest) {
+    const rv_relay_ep_key_t key = ep_key(from);
+    const rv_relay_ep_t* e = ep_find(st, &key);
+    if (!interest) return;
+    if (!e) {
+        if (st->metrics) st->metrics->drops[RV_RELAY_DROP_UNJOINED]++;
+        return;
+    }
+
+    rv_relay_session_t* s = &st->sessions[e->session - 1];
+    rv_relay_client_t* c = &s->clients[e->member];
+
+    rv_relay_client_t next = *c;
+    next.seen_us = st->now_us;
+    next.has_interest = 1;
+    next.interest = *interest;
+    if (in_grid(c) != in_grid(&next) ||
+        (in_grid(&next) && (!same_cell(c, interest) || interest->range > s->grid_range)))
+        s->grid_dirty = 1;
+    const int first = !c->has_interest;
+    *c = next;
+    if (first) mix_update(st, s);
+}
+
+static void forward_proximity(rv_relay_state_t* st, rv_relay_session_t* s, uint32_t m, int unmixed_only,
+                              const uint8_t* pkt, int pkt_len,
+                              void* send_ctx, rv_relay_send_fn send_fn) {
+    if (s->grid_dirty && grid_rebuild(s) != 0) {
+        for (uint32_t i = 0; i < s->count; i++) {
+            if (i != m) send_voice(st, &s->clients[i], unmixed_only, pkt, pkt_len, send_ctx, send_fn);
         }
+        return;
+    }
+
+    const uint32_t* items = s->grid_items;
+    const uint32_t gridded = s->grid_start[s->grid_buckets];
+    for (uint32_t k = gridded; k < s->grid_count; k++) {
+        if (items[k] != m) send_voice(st, &s->clients[items[k]], unmixed_only, pkt, pkt_len, send_ctx, send_fn);
     }
 
-    // Or update existing by addr (client restarted)
-    for (int i = 0; i < RV_RELAY_MAX_CLIENTS_PER_SESSION; i++) {
-        if (s->clients[i].in_use && addr_equal(&s->clients[i].addr, from)) {
-            s->clients[i].player_id = player_id;
-            return;
+    const rv_relay_client_t* from = &s->clients[m];
+    const int located = from->has_interest && (from->interest.flags & RV_INTEREST_POS);
+    const int16_t* p = from->interest.pos;
+
+    int32_t lo[3], hi[3];
+    uint64_t cells = 1;
+    for (int d = 0; d < 3; ++d) {
+        lo[d] = grid_cell((int32_t)p[d] - s->grid_range);
+        hi[d] = grid_cell((int32_t)p[d] + s->grid_range);
+        cells *= (uint64_t)(hi[d] - lo[d] + 1);
+    }
+
+    // Unknown sender position, or a range wider than the grid: test everyone
+    if (!located || cells >= s->grid_buckets) {
+        for (uint32_t k = 0; k < gridded; k++) {
+            const uint32_t i = items[k];
+            if (i == m || (located && !hears_at(&s->clients[i], p))) continue;
+            send_voice(st, &s->clients[i], unmixed_only, pkt, pkt_len, send_ctx, send_fn);
         }
+        return;
     }
 
-    // Insert new
-    for (int i = 0; i < RV_RELAY_MAX_CLIENTS_PER_SESSION; i++) {
-        if (!s->clients[i].in_use) {
-            s->clients[i].in_use = 1;
-            s->clients[i].player_id = player_id;
-            s->clients[i].addr = *from;
-            return;
+    const uint32_t mask = s->grid_buckets - 1;
+    for (int32_t x = lo[0]; x <= hi[0]; ++x) {
+        for (int32_t y = lo[1]; y <= hi[1]; ++y) {
+            for (int32_t z = lo[2]; z <= hi[2]; ++z) {
+                const uint32_t b = grid_hash(x, y, z) & mask;
+                for (uint32_t k = s->grid_start[b]; k < s->grid_start[b + 1]; k++) {
+                    const uint32_t i = items[k];
+                    rv_relay_client_t* c = &s->clients[i];
+                    // Buckets are shared by hash: count each member in its own cell only
+                    if (i == m || grid_cell(c->interest.pos[0]) != x ||
+                        grid_cell(c->interest.pos[1]) != y || grid_cell(c->interest.pos[2]) != z)
+                        continue;
+                    if (hears_at(c, p)) send_voice(st, c, unmixed_only, pkt, pkt_len, send_ctx, send_fn);
+                }
+            }
         }
     }
 }
 
+// ---- Last-N ----
+// With last_n set, a session forwards voice from at most that many
+// speakers. A speaker keeps its slot while it talks. A newcomer takes a
+// free slot, the slot of a speaker silent for RV_RELAY_LAST_N_HOLD_MS, or
+// that of the quietest speaker if it is RV_RELAY_LAST_N_MARGIN_DB louder,
+// so a single loud packet does not make slots flap. Senders without the
+// LEVEL extension rank as silent: they only get free or stale slots.
+
+static int last_n_admit(const rv_relay_state_t* st, rv_relay_session_t* s, uint32_t m, uint8_t level) {
+    const uint64_t now = st->now_us;
+    const uint64_t hold = (uint64_t)RV_RELAY_LAST_N_HOLD_MS * 1000u;
+    rv_relay_client_t* c = &s->clients[m];
+
+    // Smoothed over about four packets; a new talkspurt starts fresh
+    const int32_t x = (int32_t)(RV_LEVEL_SILENT - (level > RV_LEVEL_SILENT ? RV_LEVEL_SILENT : level)) << 4;
+    if (c->spoke_us == 0 || now - c->spoke_us > hold) c->loudness = (uint16_t)x;
+    else c->loudness = (uint16_t)((int32_t)c->loudness + (x - (int32_t)c->loudness) / 4);
+    c->spoke_us = now;
+    if (c->selected) return 1;
+
+    uint32_t victim = UINT32_MAX;
+    if (s->selected >= st->last_n) {
+        for (uint32_t i = 0; i < s->count; i++) {
+            const rv_relay_client_t* o = &s->clients[i];
+            if (!o->selected) continue;
+            if (now - o->spoke_us > hold) {
+                victim = i;
+                break;
+            }
+            if (victim == UINT32_MAX || o->loudness < s->clients[victim].loudness) victim = i;
+        }
+        const rv_relay_client_t* v = &s->clients[victim];
+        if (now - v->spoke_us <= hold && c->loudness < v->loudness + (RV_RELAY_LAST_N_MARGIN_DB << 4))
+            return 0;
+        s->clients[victim].selected = 0;
+        s->selected--;
+    }
+    c->selected = 1;
+    s->selected++;
+    return 1;
+}
+
+void rv_relay_leave(rv_relay_state_t* st, const rv_sockaddr_t* from,
+                    void* send_ctx, rv_relay_send_fn send_fn) {
+    const rv_relay_ep_key_t key = ep_key(from);
+    const rv_relay_ep_t* e = ep_find(st, &key);
+    if (e) remove_member(st, e->session, e->member, send_ctx, send_fn);
+}
+
+// ---- Rate limits ----
+
+int rv_relay_bucket_take(rv_relay_bucket_t* b, const rv_relay_rate_t* rate, int len, uint64_t now_us) {
+    const uint64_t burst_us = (uint64_t)RV_RELAY_RATE_BURST_MS * 1000u;
+    uint64_t elapsed = b->at_us ? (now_us > b->at_us ? now_us - b->at_us : 0) : burst_us;
+    if (elapsed > burst_us) elapsed = burst_us;
+    b->at_us = now_us;
+
+    // A packet costs 10^6 and a byte 10^6; a microsecond refills the rate
+    const uint64_t pkts_cap = (uint64_t)rate->pps * burst_us;
+    const uint64_t bytes_cap = (uint64_t)rate->bytes * burst_us;
+    b->pkts += elapsed * rate->pps;
+    b->bytes += elapsed * rate->bytes;
+    if (b->pkts > pkts_cap) b->pkts = pkts_cap;
+    if (b->bytes > bytes_cap) b->bytes = bytes_cap;
+
+    const uint64_t pkt_cost = rate->pps ? 1000000u : 0;
+    const uint64_t byte_cost = rate->bytes ? (uint64_t)len * 1000000u : 0;
+    if (b->pkts < pkt_cost || b->bytes < byte_cost) return 0;
+    b->pkts -= pkt_cost;
+    b->bytes -= byte_cost;
+    return 1;
+}
+
+// ---- Idle eviction ----
+// Packets only stamp seen_us; the timer of a member that was heard from
+// since it was armed is armed again for the rest of the window. Without
+// memory for that the member goes, and its next keepalive JOIN brings it
+// back.
+
+typedef struct rv_relay_expiry {
+    rv_relay_state_t* st;
+    void* send_ctx;
+    rv_relay_send_fn send_fn;
+} rv_relay_expiry_t;
+
+static void member_idle(void* ctx, const rv_relay_timer_t* t, uint64_t now_us) {
+    const rv_relay_expiry_t* x = (const rv_relay_expiry_t*)ctx;
+    rv_relay_state_t* st = x->st;
+    const rv_relay_ep_t* e = ep_find(st, &t->key);
+    if (!e) return;
+
+    const rv_relay_client_t* c = &st->sessions[e->session - 1].clients[e->member];
+    if (c->idle_gen != t->gen) return;   // left and joined again: a newer timer has it
+    if (c->seen_us + st->idle_us > now_us &&
+        rv_relay_wheel_add(st->idle, &t->key, t->gen, c->seen_us + st->idle_us) == 0)
+        return;
+    remove_member(st, e->session, e->member, x->send_ctx, x->send_fn);
+}
+
+void rv_relay_expire(rv_relay_state_t* st, uint64_t now_us, void* send_ctx, rv_relay_send_fn send_fn) {
+    if (!st->idle) return;
+    rv_relay_expiry_t x = { st, send_ctx, send_fn };
+    rv_relay_wheel_advance(st->idle, now_us, member_idle, &x);
+}
+
+int rv_relay_refresh(rv_relay_state_t* st, uint64_t session_id, uint16_t player_id,
+                     const rv_sockaddr_t* from) {
+    const rv_relay_ep_key_t key = ep_key(from);
+    const rv_relay_ep_t* e = ep_find(st, &key);
+    if (!e) return -1;
+
+    rv_relay_session_t* s = &st->sessions[e->session - 1];
+    rv_relay_client_t* c = &s->clients[e->member];
+    if (s->session_id != session_id || c->player_id != player_id) return -1;
+    c->seen_us = st->now_us;
+    return 0;
+}
+
+int rv_relay_joined(const rv_relay_state_t* st, const rv_sockaddr_t* from) {
+    const rv_relay_ep_key_t key = ep_key(from);
+    return ep_find(st, &key) != NULL;
+}
+
+void rv_relay_join(rv_relay_state_t* st, uint64_t session_id, uint16_t player_id, uint16_t caps,
+                   const rv_sockaddr_t* from,
+                   void* send_ctx,
+                   rv_relay_send_fn send_fn) {
+    const int created = find_session(st, session_id) == NULL;
+    const uint32_t v = find_or_create_session(st, session_id);
+    if (!v) return;
+
+    const int m = join_client(st, v, player_id, from, send_ctx, send_fn);
+    rv_relay_session_t* s = &st->sessions[v - 1];
+    if (m < 0) {
+        if (s->count == 0) remove_session(st, v);
+        return;
+    }
+    if (st->metrics) st->metrics->joins++;
+
+    // Voice is forwarded untouched, so the session speaks the version its
+    // oldest member understands.
+    s->clients[m].seen_us = st->now_us;
+    s->clients[m].wire_ver = (caps & RV_CAP_V2) ? RV_PROTO_VER2 : RV_PROTO_VER;
+    s->clients[m].bundle = (caps & RV_CAP_BUNDLE) ? 1 : 0;
+    s->clients[m].mix = (caps & RV_CAP_MIX) ? 1 : 0;
+    const uint8_t prev = s->wire_ver;
+    s->wire_ver = session_wire_ver(s);
+    mix_update(st, s);
+    if (created) link_upstream(st, v, send_ctx, send_fn);
+
+    send_acks(s, s->wire_ver == prev ? m : -1, send_ctx, send_fn);
+}
+
+static void route_voice(rv_relay_state_t* st, rv_relay_session_t* s, uint32_t m,
+                        const rv_pkt_view_t* pv, const uint8_t* pkt, int pkt_len,
+                        void* send_ctx, rv_relay_send_fn send_fn) {
+    // A mixing session decodes the voice instead; the relay cannot open
+    // sealed voice, so that is still forwarded to everyone
+    int unmixed_only = 0;
+    const rv_relay_client_t* sender = &s->clients[m];
+    if (s->mix && rv_relay_mix_push(s->mix, pv->speaker_id, pv) == 0) {
+        if (st->metrics) st->metrics->mixed++;
+        if (s->unmixed - (sender->mixed ? 0u : 1u) == 0) return;
+        unmixed_only = 1;
+    }
+
+    const uint8_t flags = pv->flags;
+    if (!rv_flags_is_radio(flags)) {
+        forward_proximity(st, s, m, unmixed_only, pkt, pkt_len, send_ctx, send_fn);
+        return;
+    }
+
+    const uint16_t bit = (uint16_t)(1u << rv_flags_channel(flags));
+    for (uint32_t i = 0; i < s->count; i++) {
+        rv_relay_client_t* c = &s->clients[i];
+        if (i == m) continue; // don't echo back
+        if (c->has_interest && !(c->interest.channels & bit)) continue;
+        send_voice(st, c, unmixed_only, pkt, pkt_len, send_ctx, send_fn);
+    }
+}
+
 void rv_relay_forward_voice(rv_relay_state_t* st,
-                            uint64_t session_id,
                             const rv_sockaddr_t* from,
+                            const rv_pkt_view_t* pv,
                             const uint8_t* pkt,
                             int pkt_len,
                             void* send_ctx,
-                            int (*send_fn)(void* ctx, const rv_sockaddr_t* to, const uint8_t* data, int len)) {
-    rv_relay_session_t* s = NULL;
-    for (int i = 0; i < RV_RELAY_MAX_SESSIONS; i++) {
-        if (st->sessions[i].in_use && st->sessions[i].session_id == session_id) {
-            s = &st->sessions[i];
-            break;
+                            rv_relay_send_fn send_fn) {
+    rv_relay_metrics_t* mt = st->metrics;
+    const rv_relay_ep_key_t key = ep_key(from);
+    const rv_relay_ep_t* e = ep_find(st, &key);
+    if (!e) {
+        if (mt) mt->drops[RV_RELAY_DROP_UNJOINED]++;
+        return;
+    }
+
+    rv_relay_session_t* s = &st->sessions[e->session - 1];
+    rv_relay_client_t* c = &s->clients[e->member];
+    c->seen_us = st->now_us;
+    if (pv->speaker_id != c->player_id) {
+        if (mt) mt->drops[RV_RELAY_DROP_SPOOFED]++;
+        return;
+    }
+    if ((st->rate.pps || st->rate.bytes) && !rv_relay_bucket_take(&c->bucket, &st->rate, pkt_len, st->now_us)) {
+        if (mt) mt->drops[RV_RELAY_DROP_RATE]++;
+        return;
+    }
+    // Below N clients every speaker fits, so there is nothing to rank;
+    // peer relays only carry voice
+    if (st->last_n && s->count - s->peers > st->last_n && !last_n_admit(st, s, e->member, pv->level)) {
+        if (mt) mt->drops[RV_RELAY_DROP_LAST_N]++;
+        return;
+    }
+
+    wrap_for_peers(st, s, 0, 1, pkt, pkt_len);
+    const uint64_t forwards = mt ? mt->forwards : 0;
+    route_voice(st, s, e->member, pv, pkt, pkt_len, send_ctx, send_fn);
+    if (mt) {
+        mt->voice++;
+        rv_relay_metrics_fanout(mt, mt->forwards - forwards);
+    }
+}
+
+void rv_relay_forward_to_player(rv_relay_state_t* st,
+                                const rv_sockaddr_t* from,
+                                uint16_t reporter_id,
+                                uint16_t target_player_id,
+                                const uint8_t* pkt,
+                                int pkt_len,
+                                void* send_ctx,
+                                rv_relay_send_fn send_fn) {
+    const rv_relay_ep_key_t key = ep_key(from);
+    const rv_relay_ep_t* e = ep_find(st, &key);
+    if (!e) {
+        if (st->metrics) st->metrics->drops[RV_RELAY_DROP_UNJOINED]++;
+        return;
+    }
+
+    rv_relay_session_t* s = &st->sessions[e->session - 1];
+    rv_relay_client_t* c = &s->clients[e->member];
+    c->seen_us = st->now_us;
+    if (reporter_id != c->player_id) {
+        if (st->metrics) st->metrics->drops[RV_RELAY_DROP_SPOOFED]++;
+        return;
+    }
+    const int m = find_player(s, target_player_id);
+    if (m >= 0) (void)send_fn(send_ctx, &s->clients[m].addr, pkt, pkt_len);
+    else send_remote(s, -1, target_player_id, 1, pkt, pkt_len, send_ctx, send_fn);
+}
+
+// ---- Cascading ----
+
+void rv_relay_set_upstream(rv_relay_state_t* st, const rv_sockaddr_t* upstream) {
+    st->has_upstream = upstream != NULL;
+    if (upstream) st->upstream = *upstream;
+}
+
+int rv_relay_allow_peer(rv_relay_state_t* st, const rv_sockaddr_t* addr) {
+    if (st->peer_allow_count == RV_RELAY_MAX_PEER_ADDRS) return -1;
+    st->peer_allow[st->peer_allow_count++] = ep_key(addr);
+    return 0;
+}
+
+static int peer_allowed(const rv_relay_state_t* st, const rv_sockaddr_t* addr) {
+    const rv_relay_ep_key_t key = ep_key(addr);
+    for (uint32_t i = 0; i < st->peer_allow_count; i++) {
+        if (memcmp(st->peer_allow[i].ip, key.ip, sizeof(key.ip)) == 0) return 1;
+    }
+    return 0;
+}
+
+void rv_relay_peer_join(rv_relay_state_t* st, uint64_t session_id, const rv_sockaddr_t* from,
+                        void* send_ctx, rv_relay_send_fn send_fn) {
+    if (!peer_allowed(st, from)) {
+        if (st->metrics) st->metrics->drops[RV_RELAY_DROP_PEER]++;
+        return;
+    }
+
+    const int created = find_session(st, session_id) == NULL;
+    const uint32_t v = find_or_create_session(st, session_id);
+    if (!v) return;
+
+    rv_relay_session_t* s = &st->sessions[v - 1];
+    const int known = find_peer(s, from);
+    if (known >= 0) {
+        s->clients[known].seen_us = st->now_us;
+        return;
+    }
+    if (add_peer(st, v, from, RV_RELAY_PEER_DOWN) < 0) {
+        if (s->count == 0) remove_session(st, v);
+        return;
+    }
+    if (st->metrics) st->metrics->joins++;
+    if (created) link_upstream(st, v, send_ctx, send_fn);
+}
+
+void rv_relay_forward_peer(rv_relay_state_t* st, const rv_sockaddr_t* from, const rv_pkt_view_t* pv,
+                           void* send_ctx, rv_relay_send_fn send_fn) {
+    rv_relay_metrics_t* mt = st->metrics;
+    uint64_t session_id = 0;
+    const uint8_t* pkt = NULL;
+    uint16_t pkt_len = 0;
+    rv_pkt_view_t inner;
+    if (rv_pkt_view_peer(pv, &session_id, &pkt, &pkt_len) != 0 || rv_pkt_view_parse(pkt, pkt_len, &inner) != 0 ||
+        (inner.type != RV_PKT_VOICE && inner.type != RV_PKT_REPORT)) {
+        if (mt) mt->drops[RV_RELAY_DROP_MALFORMED]++;
+        return;
+    }
+
+    rv_relay_session_t* s = find_session(st, session_id);
+    const int m = s ? find_peer(s, from) : -1;
+    if (m < 0) {
+        if (mt) mt->drops[RV_RELAY_DROP_PEER]++;
+        return;
+    }
+    s->clients[m].seen_us = st->now_us;
+    if (pv->seq >= RV_RELAY_PEER_MAX_HOPS) {
+        if (mt) mt->drops[RV_RELAY_DROP_LOOP]++;
+        return;
+    }
+    const uint16_t hops = (uint16_t)(pv->seq + 1u);
+
+    if (inner.type == RV_PKT_REPORT) {
+        rv_report_t rep;
+        if (rv_pkt_view_report(&inner, &rep) != 0) return;
+        const int t = find_player(s, rep.target_id);
+        if (t >= 0) (void)send_fn(send_ctx, &s->clients[t].addr, pkt, pkt_len);
+        else send_remote(s, m, rep.target_id, hops, pkt, pkt_len, send_ctx, send_fn);
+        return;
+    }
+
+    if (!remote_admit(st, s, (uint32_t)m, inner.speaker_id)) {
+        if (mt) mt->drops[RV_RELAY_DROP_LOOP]++;
+        return;
+    }
+    wrap_for_peers(st, s, 1, hops, pkt, pkt_len);
+    const uint64_t forwards = mt ? mt->forwards : 0;
+    route_voice(st, s, (uint32_t)m, &inner, pkt, pkt_len, send_ctx, send_fn);
+    if (mt) {
+        mt->voice++;
+        rv_relay_metrics_fanout(mt, mt->forwards - forwards);
+    }
+}
+
+void rv_relay_peers_tick(rv_relay_state_t* st, void* send_ctx, rv_relay_send_fn send_fn) {
+    // Three keepalives missed
+    const uint64_t timeout = 3ull * RV_RELAY_PEER_KEEPALIVE_MS * 1000u;
+    const uint64_t now = st->now_us;
+    if (++st->peer_keepalives == 0) st->peer_keepalives = 1;
+
+    for (uint32_t v = 1; v <= st->sessions_cap; v++) {
+        rv_relay_session_t* s = &st->sessions[v - 1];
+        if (!s->in_use || !s->peers) continue;
+
+        for (uint32_t i = s->remote_count; i-- > 0;) {
+            if (now - s->remotes[i].seen_us > timeout) s->remotes[i] = s->remotes[--s->remote_count];
+        }
+        // Backwards, so a removal only moves members already visited
+        for (uint32_t i = s->count; i-- > 0 && s->in_use;) {
+            const rv_relay_client_t* c = &s->clients[i];
+            if (c->peer == RV_RELAY_PEER_DOWN && now - c->seen_us > timeout) {
+                remove_member(st, v, i, send_ctx, send_fn);
+            } else if (c->peer == RV_RELAY_PEER_UP && send_fn) {
+                uint8_t join[32];
+                const int n = rv_build_keepalive_packet(join, (int)sizeof(join), s->session_id, 0,
+                                                        RV_CAP_PEER | RV_CAP_V2, st->peer_keepalives);
+                if (n > 0) (void)send_fn(send_ctx, &c->addr, join, n);
+            }
+        }
+    }
+}
+
+// ---- Endpoint routes ----
+
+void rv_relay_routes_init(rv_relay_routes_t* r) {
+    memset(r, 0, sizeof(*r));
+    r->hash_seed = mix64((uint64_t)(uintptr_t)r ^ (uint64_t)time(NULL));
+}
+
+void rv_relay_routes_free(rv_relay_routes_t* r) {
+    if (!r) return;
+    free(r->slots);
+    memset(r, 0, sizeof(*r));
+}
+
+static rv_relay_route_t* route_slot(const rv_relay_routes_t* r, const rv_relay_ep_key_t* k) {
+    const uint32_t mask = r->cap - 1;
+    uint32_t i = hash_key(r->hash_seed, k) & mask;
+    for (;;) {
+        rv_relay_route_t* e = &r->slots[i];
+        if (e->value == 0 || ep_key_equal(&e->key, k)) return e;
+        i = (i + 1) & mask;
+    }
+}
+
+rv_relay_route_t* rv_relay_routes_get(rv_relay_routes_t* r, const rv_sockaddr_t* addr, uint64_t now_us) {
+    if (r->cap == 0) return NULL;
+    const rv_relay_ep_key_t key = ep_key(addr);
+    rv_relay_route_t* e = route_slot(r, &key);
+    if (e->value == 0) return NULL;
+    e->seen_us = now_us;
+    return e;
+}
+
+int rv_relay_routes_set(rv_relay_routes_t* r, const rv_sockaddr_t* addr, uint32_t value, uint64_t now_us) {
+    if ((r->count + 1) * 2 > r->cap) {
+        const uint32_t old_cap = r->cap;
+        rv_relay_route_t* old = r->slots;
+        const uint32_t cap = old_cap ? old_cap * 2 : RV_RELAY_MIN_SLOTS;
+        rv_relay_route_t* slots = (rv_relay_route_t*)calloc(cap, sizeof(rv_relay_route_t));
+        if (!slots) return -1;
+
+        r->slots = slots;
+        r->cap = cap;
+        for (uint32_t i = 0; i < old_cap; ++i) {
+            if (old[i].value) *route_slot(r, &old[i].key) = old[i];
         }
+        free(old);
     }
-    if (!s) return;
 
-    for (int i = 0; i < RV_RELAY_MAX_CLIENTS_PER_SESSION; i++) {
-        if (!s->clients[i].in_use) continue;
-        if (addr_equal(&s->clients[i].addr, from)) continue; // don't echo back
-        (void)send_fn(send_ctx, &s->clients[i].addr, pkt, pkt_len);
+    const rv_relay_ep_key_t key = ep_key(addr);
+    rv_relay_route_t* e = route_slot(r, &key);
+    if (e->value == 0) {
+        uint32_t gen = 0;
+        if (r->idle) {
+            gen = rv_relay_wheel_gen(r->idle);
+            if (rv_relay_wheel_add(r->idle, &key, gen, now_us + r->idle_us) != 0) return -1;
+        }
+        e->idle_gen = gen;
+        r->count++;
     }
+    e->key = key;
+    e->value = value + 1;
+    e->seen_us = now_us;
+    return 0;
+}
+
+static void route_remove(rv_relay_routes_t* r, rv_relay_route_t* e) {
+    const uint32_t mask = r->cap - 1;
+    uint32_t i = (uint32_t)(e - r->slots);
+    uint32_t j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        const rv_relay_route_t* n = &r->slots[j];
+        if (n->value == 0) break;
+        if (probe_keeps(i, j, hash_key(r->hash_seed, &n->key) & mask)) continue;
+        r->slots[i] = *n;
+        i = j;
+    }
+    memset(&r->slots[i], 0, sizeof(r->slots[i]));
+    r->count--;
+}
+
+void rv_relay_routes_remove(rv_relay_routes_t* r, const rv_sockaddr_t* addr) {
+    if (r->cap == 0) return;
+    const rv_relay_ep_key_t key = ep_key(addr);
+    rv_relay_route_t* e = route_slot(r, &key);
+    if (e->value) route_remove(r, e);
+}
+
+// Like member_idle
+static void route_idle(void* ctx, const rv_relay_timer_t* t, uint64_t now_us) {
+    rv_relay_routes_t* r = (rv_relay_routes_t*)ctx;
+    if (r->cap == 0) return;
+    rv_relay_route_t* e = route_slot(r, &t->key);
+    if (e->value == 0 || e->idle_gen != t->gen) return;
+    if (e->seen_us + r->idle_us > now_us &&
+        rv_relay_wheel_add(r->idle, &t->key, t->gen, e->seen_us + r->idle_us) == 0)
+        return;
+    route_remove(r, e);
+}
+
+void rv_relay_routes_expire(rv_relay_routes_t* r, uint64_t now_us) {
+    if (r->idle) rv_relay_wheel_advance(r->idle, now_us, route_idle, r);
 }
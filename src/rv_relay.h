@@ -1,36 +1,355 @@
 #pragma once
 #include <stdint.h>
 #include "rv_udp.h"
+#include "rv_netproto.h"
 
-#define RV_RELAY_MAX_SESSIONS 64
-#define RV_RELAY_MAX_CLIENTS_PER_SESSION 16
+// Upper bound on one session; sessions and the tables grow as needed
+#ifndef RV_RELAY_MAX_CLIENTS_PER_SESSION
+#define RV_RELAY_MAX_CLIENTS_PER_SESSION 256
+#endif
+
+// Proximity grid cell edge, in the world units of INTEREST positions
+#ifndef RV_RELAY_GRID_CELL
+#define RV_RELAY_GRID_CELL 32
+#endif
+
+// Last-N: a selected speaker silent this long gives up its slot, and a
+// newcomer must be this much louder (dB, smoothed) to take a busy one
+#ifndef RV_RELAY_LAST_N_HOLD_MS
+#define RV_RELAY_LAST_N_HOLD_MS 1000u
+#endif
+#ifndef RV_RELAY_LAST_N_MARGIN_DB
+#define RV_RELAY_LAST_N_MARGIN_DB 6u
+#endif
+
+// Members and routes that send nothing for this long are dropped. Clients
+// resend their JOIN every RV_KEEPALIVE_INTERVAL_MS (voice.c) to stay.
+#ifndef RV_RELAY_IDLE_MS
+#define RV_RELAY_IDLE_MS 30000u
+#endif
+// Resolution of the idle timers
+#ifndef RV_RELAY_IDLE_TICK_MS
+#define RV_RELAY_IDLE_TICK_MS 1000u
+#endif
+
+// Flood limits: voice per endpoint, as token buckets holding up to
+// RV_RELAY_RATE_BURST_MS of their rate, and endpoints joining per shard.
+// 10 ms frames take 100 packets/s; 510 kbit/s with RED about 100 KB/s.
+#ifndef RV_RELAY_RATE_PPS
+#define RV_RELAY_RATE_PPS 200u
+#endif
+#ifndef RV_RELAY_RATE_BYTES
+#define RV_RELAY_RATE_BYTES 131072u
+#endif
+#ifndef RV_RELAY_RATE_BURST_MS
+#define RV_RELAY_RATE_BURST_MS 500u
+#endif
+#ifndef RV_RELAY_JOIN_RATE
+#define RV_RELAY_JOIN_RATE 5000u
+#endif
+
+// Cascading: relays that share a session pass its voice to each other
+// wrapped in RV_PKT_PEER. A packet that has crossed this many relays is
+// dropped, and a remote speaker sticks to the peer it arrives from until
+// that peer has not carried it for RV_RELAY_PEER_REBIND_MS.
+#ifndef RV_RELAY_PEER_MAX_HOPS
+#define RV_RELAY_PEER_MAX_HOPS 8u
+#endif
+#ifndef RV_RELAY_PEER_REBIND_MS
+#define RV_RELAY_PEER_REBIND_MS 1000u
+#endif
+// Keepalive JOINs to the upstream relay, and checks for idle peers
+#ifndef RV_RELAY_PEER_KEEPALIVE_MS
+#define RV_RELAY_PEER_KEEPALIVE_MS 5000u
+#endif
+#ifndef RV_RELAY_MAX_PEER_ADDRS
+#define RV_RELAY_MAX_PEER_ADDRS 16
+#endif
+#define RV_RELAY_PEER_PKT 1500          // largest PEER packet sent (one MTU)
+
+// Per second; 0 leaves that dimension unlimited
+typedef struct rv_relay_rate {
+    uint32_t pps;
+    uint32_t bytes;
+} rv_relay_rate_t;
+
+// Tokens are scaled by 10^6 so refills need no division; zeroed is full
+typedef struct rv_relay_bucket {
+    uint64_t at_us;       // last refill, 0 = never
+    uint64_t pkts;
+    uint64_t bytes;
+} rv_relay_bucket_t;
+
+// Where a client's pending bundle is (see rv_relay_bundle.h)
+typedef struct rv_relay_bundle_ref {
+    uint32_t gen;         // bundler generation it was opened in
+    uint32_t slot;
+} rv_relay_bundle_ref_t;
 
 typedef struct rv_relay_client {
-    uint8_t in_use;
     uint16_t player_id;
+    uint8_t wire_ver;     // highest header version this client parses
+    uint8_t bundle;       // RV_CAP_BUNDLE: voice may arrive bundled
+    uint8_t mix;          // RV_CAP_MIX: plays a relay mix
+    uint8_t mixed;        // gets the session mix, not forwards (never with an interest)
+    uint8_t mix_live;     // got the mix lately; 0 starts a new talkspurt
+    uint16_t mix_seq;     // seq of the next mixed packet to it
+    uint8_t has_interest; // sent INTEREST; until then it hears everything
+    uint8_t selected;     // holds a last-N slot
+    uint8_t peer;         // a relay (rv_relay_peer_t): carries many speakers, not in endpoints
+    uint16_t loudness;    // smoothed 127 - level, Q4 (last-N ranking)
+    rv_interest_t interest;
+    rv_relay_bundle_ref_t bundle_ref;
+    uint64_t spoke_us;    // last voice packet (last-N)
+    uint64_t seen_us;     // last packet of any kind (idle eviction)
+    rv_relay_bucket_t bucket; // its voice against rv_relay_state_t.rate
+    uint32_t idle_gen;    // its idle timer (see rv_relay_wheel.h)
     rv_sockaddr_t addr;
 } rv_relay_client_t;
 
+typedef enum rv_relay_peer {
+    RV_RELAY_PEER_NONE = 0,
+    RV_RELAY_PEER_DOWN,   // joined us with RV_CAP_PEER; dropped when idle
+    RV_RELAY_PEER_UP,     // the upstream we joined; kept while the session lives
+} rv_relay_peer_t;
+
+// A speaker on another relay and the peer its voice comes through
+typedef struct rv_relay_remote {
+    uint16_t speaker_id;
+    uint16_t peer;        // member index
+    uint64_t seen_us;
+} rv_relay_remote_t;
+
 typedef struct rv_relay_session {
-    uint8_t in_use;
     uint64_t session_id;
-    rv_relay_client_t clients[RV_RELAY_MAX_CLIENTS_PER_SESSION];
+    uint8_t in_use;
+    uint8_t wire_ver;     // lowest wire_ver of all clients; packets are forwarded as-is
+    uint32_t count;       // clients[0..count) are the members, densely packed
+    uint32_t cap;
+    rv_relay_client_t* clients;
+    uint32_t next_free;   // free list link while !in_use
+    uint32_t selected;    // members holding a last-N slot
+
+    // Proximity grid: members with a position and a hearing range,
+    // bucketed by hashed cell, then the members that hear proximity voice
+    // from anywhere. Rebuilt by the first proximity packet after a change.
+    uint8_t grid_dirty;
+    uint32_t grid_buckets;    // power of two
+    uint32_t* grid_start;     // [grid_buckets + 1] into grid_items
+    uint32_t* grid_items;     // member indices
+    uint32_t grid_count;      // grid_items in use, the "anywhere" ones last
+    uint32_t grid_cap;
+    uint16_t grid_range;      // largest hearing range in the grid
+
+    struct rv_relay_mix_session* mix; // mixing (see rv_relay_mix.h), else NULL
+    uint32_t unmixed;         // members still forwarded to while mixing
+
+    uint32_t peers;           // members that are relays
+    rv_relay_remote_t* remotes;
+    uint32_t remote_count;
+    uint32_t remote_cap;
 } rv_relay_session_t;
 
+// Address as a hash key: v4 in mapped form, no padding
+typedef struct rv_relay_ep_key {
+    uint8_t ip[16];
+    uint16_t port;
+    uint16_t ver;
+} rv_relay_ep_key_t;
+
+typedef struct rv_relay_ep {
+    rv_relay_ep_key_t key;
+    uint32_t session;     // index into sessions, +1 (0 marks an empty slot)
+    uint32_t member;      // index into that session's clients
+} rv_relay_ep_t;
+
 typedef struct rv_relay_state {
-    rv_relay_session_t sessions[RV_RELAY_MAX_SESSIONS];
+    rv_relay_session_t* sessions;   // slab; indices stay valid as it grows
+    uint32_t sessions_cap;
+    uint32_t free_session;          // head of the free list, +1 (0: none)
+
+    // Open addressing, linear probing, power-of-two sizes
+    uint32_t* session_index;        // session slab index + 1, keyed by session_id
+    uint32_t session_index_cap;
+    rv_relay_ep_t* endpoints;       // address -> (session, member)
+    uint32_t endpoints_cap;
+
+    uint64_t hash_seed;
+    uint32_t session_count;
+    uint32_t client_count;
+
+    uint32_t last_n;                // forward at most N speakers per session, 0 = all
+    uint64_t now_us;                // event loop clock, set before each batch
+
+    // Voice to RV_CAP_BUNDLE clients goes here instead of to send_fn;
+    // the caller flushes it (NULL: bundling off)
+    struct rv_relay_bundler* bundler;
+
+    // Sessions with enough members are mixed by it (NULL: mixing off)
+    struct rv_relay_mixer* mixer;
+
+    // Members idle for idle_us are dropped through its timers, the caller
+    // runs them with rv_relay_expire (NULL: members stay until they leave)
+    struct rv_relay_wheel* idle;
+    uint64_t idle_us;
+
+    // Counted into when set (see rv_relay_metrics.h)
+    struct rv_relay_metrics* metrics;
+
+    // Voice allowed per member (zero: unlimited)
+    rv_relay_rate_t rate;
+
+    // Cascading: every session is joined at the upstream relay as well
+    // (has_upstream), and relays at these addresses (any port) may join
+    // ours as peers
+    uint8_t has_upstream;
+    rv_sockaddr_t upstream;
+    rv_relay_ep_key_t peer_allow[RV_RELAY_MAX_PEER_ADDRS];
+    uint32_t peer_allow_count;
+    uint16_t peer_keepalives;       // count in the last keepalive JOIN
+    uint8_t peer_pkt[RV_RELAY_PEER_PKT];  // the packet being forwarded, wrapped
+    int peer_len;                   // 0: not wrapped (no other peer, or too big)
 } rv_relay_state_t;
 
 void rv_relay_init(rv_relay_state_t* st);
+void rv_relay_free(rv_relay_state_t* st);
+
+// Take a packet of len bytes from b at now_us: 1 if it fits the rate,
+// 0 if it is over (nothing is taken then)
+int  rv_relay_bucket_take(rv_relay_bucket_t* b, const rv_relay_rate_t* rate, int len, uint64_t now_us);
+
+// Sends or copies data before it returns, unless data lies in the buffer
+// the packet was received into: callers build packets in stack or state
+// buffers and reuse them for the next send (peer keepalives, wrapped voice).
+typedef int (*rv_relay_send_fn)(void* ctx, const rv_sockaddr_t* to, const uint8_t* data, int len);
+
+// Drop the endpoint from whatever session it joined (no-op if none). When
+// that raises the session's wire version, its clients get a JOIN_ACK with
+// the new one (send_fn may be NULL).
+void rv_relay_leave(rv_relay_state_t* st, const rv_sockaddr_t* from,
+                    void* send_ctx, rv_relay_send_fn send_fn);
 
-// Register/update client endpoint in session
-void rv_relay_join(rv_relay_state_t* st, uint64_t session_id, uint16_t player_id, const rv_sockaddr_t* from);
+// Drop the members that have been idle for st->idle_us by now_us, like
+// rv_relay_leave. A session goes with its last member.
+void rv_relay_expire(rv_relay_state_t* st, uint64_t now_us, void* send_ctx, rv_relay_send_fn send_fn);
 
-// Forward a received VOICE packet to all other clients in same session
+
+// Register/update client endpoint in session. caps are the RV_CAP_* bits
+// from its JOIN. An endpoint belongs to one session at a time: joining
+// another one moves it. The client gets a JOIN_ACK with the session wire version;
+// when that version changes, every other client gets one too.
+void rv_relay_join(rv_relay_state_t* st, uint64_t session_id, uint16_t player_id, uint16_t caps,
+                   const rv_sockaddr_t* from,
+                   void* send_ctx,
+                   rv_relay_send_fn send_fn);
+
+// A keepalive JOIN (header seq != 0): 0 if the endpoint is still this
+// player in this session, which only marks it alive, -1 if it needs the
+// full rv_relay_join (the relay restarted or evicted it)
+int  rv_relay_refresh(rv_relay_state_t* st, uint64_t session_id, uint16_t player_id,
+                      const rv_sockaddr_t* from);
+
+// 1 if the endpoint has joined some session, so a JOIN from it is not a new client
+int  rv_relay_joined(const rv_relay_state_t* st, const rv_sockaddr_t* from);
+
+// Record what the sender wants to hear (see RV_PKT_INTEREST)
+void rv_relay_set_interest(rv_relay_state_t* st, const rv_sockaddr_t* from,
+                           const rv_interest_t* interest);
+
+// Forward a received VOICE packet (pv is its parsed view) to the other
+// clients in the sender's session that are interested. Voice over the
+// sender's rate, or with another player's speaker id, is dropped. Radio voice goes
+// to the clients listening on its channel, proximity voice to those whose
+// hearing range covers the sender's position. With last_n set, only
+// speakers holding one of the session's N slots are forwarded, ranked by
+// the LEVEL byte. In a session that mixes (st->mixer), voice goes into
+// the mix and is only forwarded to members that do not take it. The
+// session comes from the endpoint the sender joined from; packets from
+// endpoints that never joined are dropped.
 void rv_relay_forward_voice(rv_relay_state_t* st,
-                            uint64_t session_id,
                             const rv_sockaddr_t* from,
+                            const rv_pkt_view_t* pv,
                             const uint8_t* pkt,
                             int pkt_len,
                             void* send_ctx,
-                            int (*send_fn)(void* ctx, const rv_sockaddr_t* to, const uint8_t* data, int len));
+                            rv_relay_send_fn send_fn);
+
+// Send a packet to one player in the session the sender (from) belongs to.
+// Used for REPORT, which is addressed to the speaker it describes; one
+// whose reporter_id is not the sender's player id is dropped.
+void rv_relay_forward_to_player(rv_relay_state_t* st,
+                                const rv_sockaddr_t* from,
+                                uint16_t reporter_id,
+                                uint16_t target_player_id,
+                                const uint8_t* pkt,
+                                int pkt_len,
+                                void* send_ctx,
+                                rv_relay_send_fn send_fn);
+
+// ---- Cascading ----
+// Relays share a session by joining it at each other as peers: a relay
+// with an upstream joins every session it has there (JOIN with
+// RV_CAP_PEER, player_id 0) and keeps the upstream as a member. Voice
+// from any member goes to every other peer once, wrapped in RV_PKT_PEER,
+// and each relay fans it out to its own clients. A relay hands what a peer
+// sent on to its clients and its other peers, never back. Loops from a
+// miswired topology die out: voice from a peer that carries a local
+// player's id, or a remote speaker arriving through a second peer, is
+// dropped, and so is anything that crossed RV_RELAY_PEER_MAX_HOPS relays.
+
+// Join every session at upstream too (NULL: none)
+void rv_relay_set_upstream(rv_relay_state_t* st, const rv_sockaddr_t* upstream);
+
+// Accept peer JOINs from addr's IP address; -1 when the list is full
+int  rv_relay_allow_peer(rv_relay_state_t* st, const rv_sockaddr_t* addr);
+
+// A JOIN with RV_CAP_PEER, first or keepalive: from becomes (or stays) a
+// peer of the session. Dropped unless from was allowed.
+void rv_relay_peer_join(rv_relay_state_t* st, uint64_t session_id, const rv_sockaddr_t* from,
+                        void* send_ctx, rv_relay_send_fn send_fn);
+
+// A PEER packet (pv is its parsed view) from one of the session's peers:
+// VOICE is forwarded like rv_relay_forward_voice, but neither rate-limited
+// nor ranked for last-N, and REPORT goes to its target
+void rv_relay_forward_peer(rv_relay_state_t* st, const rv_sockaddr_t* from, const rv_pkt_view_t* pv,
+                           void* send_ctx, rv_relay_send_fn send_fn);
+
+// Every RV_RELAY_PEER_KEEPALIVE_MS: keepalive JOINs upstream; peers that
+// joined us and missed three of theirs leave
+void rv_relay_peers_tick(rv_relay_state_t* st, void* send_ctx, rv_relay_send_fn send_fn);
+
+// ---- Endpoint routes ----
+// Address -> small integer, hashed like the client index. The sharded
+// relay keeps one per shard for the endpoints that arrive there, mapping
+// each to the shard that owns its session.
+
+typedef struct rv_relay_route {
+    rv_relay_ep_key_t key;
+    uint32_t value;       // +1 (0 marks an empty slot)
+    uint32_t idle_gen;
+    uint64_t seen_us;
+    rv_relay_bucket_t bucket; // against rv_relay_routes_t.rate
+} rv_relay_route_t;
+
+typedef struct rv_relay_routes {
+    rv_relay_route_t* slots;
+    uint32_t cap;
+    uint32_t count;
+    uint64_t hash_seed;
+
+    struct rv_relay_wheel* idle;  // like rv_relay_state_t.idle
+    uint64_t idle_us;
+    rv_relay_rate_t rate;         // voice allowed per route, checked by the caller
+} rv_relay_routes_t;
+
+void rv_relay_routes_init(rv_relay_routes_t* r);
+void rv_relay_routes_free(rv_relay_routes_t* r);
+
+// The route of addr, which counts as used at now_us, or NULL; valid until
+// the next set or remove
+rv_relay_route_t* rv_relay_routes_get(rv_relay_routes_t* r, const rv_sockaddr_t* addr, uint64_t now_us);
+// Add or replace; -1 when out of memory
+int  rv_relay_routes_set(rv_relay_routes_t* r, const rv_sockaddr_t* addr, uint32_t value, uint64_t now_us);
+void rv_relay_routes_remove(rv_relay_routes_t* r, const rv_sockaddr_t* addr);
+// Drop the routes unused for r->idle_us by now_us
+void rv_relay_routes_expire(rv_relay_routes_t* r, uint64_t now_us);
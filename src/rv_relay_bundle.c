@@ -0,0 +1,82 @@
+#include "rv_relay_bundle.h"
+#include <stdlib.h>
+#include <string.h>
+
+void rv_relay_bundler_init(rv_relay_bundler_t* b) {
+    memset(b, 0, sizeof(*b));
+    b->gen = 1;
+}
+
+void rv_relay_bundler_free(rv_relay_bundler_t* b) {
+    if (!b) return;
+    free(b->bundles);
+    memset(b, 0, sizeof(*b));
+}
+
+// A bundle of one goes out as the datagram it holds
+static void send_bundle(rv_relay_bundler_t* b, rv_relay_bundle_t* u, void* send_ctx, rv_relay_send_fn send_fn) {
+    if (u->count == 1) {
+        const int off = RV_BUNDLE_HDR_LEN + RV_BUNDLE_ITEM_HDR;
+        (void)send_fn(send_ctx, &u->to, u->buf + off, u->len - off);
+    } else if (u->count > 1) {
+        (void)send_fn(send_ctx, &u->to, u->buf, u->len);
+        b->bundled += (uint64_t)u->count;
+        b->sent++;
+    }
+    u->len = RV_BUNDLE_HDR_LEN;
+    u->count = 0;
+}
+
+static rv_relay_bundle_t* open_bundle(rv_relay_bundler_t* b, const rv_sockaddr_t* to) {
+    if (b->count == b->cap) {
+        const uint32_t cap = b->cap ? b->cap * 2 : 64;
+        rv_relay_bundle_t* grown = (rv_relay_bundle_t*)realloc(b->bundles, cap * sizeof(*grown));
+        if (!grown) return NULL;
+        b->bundles = grown;
+        b->cap = cap;
+    }
+    rv_relay_bundle_t* u = &b->bundles[b->count++];
+    u->to = *to;
+    u->len = rv_build_bundle_header(u->buf, (int)sizeof(u->buf));
+    u->count = 0;
+    return u;
+}
+
+int rv_relay_bundler_add(rv_relay_bundler_t* b, rv_relay_bundle_ref_t* ref,
+                         const rv_sockaddr_t* to, const uint8_t* pkt, int len,
+                         uint64_t now_us, void* send_ctx, rv_relay_send_fn send_fn) {
+    rv_relay_bundle_t* u = NULL;
+    if (ref->gen == b->gen && ref->slot < b->count) {
+        u = &b->bundles[ref->slot];
+    } else if (len <= RV_BUNDLE_MAX_BYTES - RV_BUNDLE_HDR_LEN - RV_BUNDLE_ITEM_HDR) {
+        if (b->count == 0) b->opened_us = now_us;
+        u = open_bundle(b, to);
+        if (u) {
+            ref->gen = b->gen;
+            ref->slot = (uint32_t)(u - b->bundles);
+        }
+    }
+    if (!u) return send_fn(send_ctx, to, pkt, len);
+
+    int r = rv_bundle_append(u->buf, u->len, (int)sizeof(u->buf), pkt, len);
+    if (r < 0) {
+        // Full: what is queued goes first, so the listener keeps the order.
+        // The rest goes into a fresh slot: a send may still point at this
+        // buffer until the io flush.
+        send_bundle(b, u, send_ctx, send_fn);
+        u = open_bundle(b, to);
+        if (!u) return send_fn(send_ctx, to, pkt, len);
+        ref->slot = (uint32_t)(u - b->bundles);
+        r = rv_bundle_append(u->buf, u->len, (int)sizeof(u->buf), pkt, len);
+        if (r < 0) return send_fn(send_ctx, to, pkt, len);
+    }
+    u->len = r;
+    u->count++;
+    return len;
+}
+
+void rv_relay_bundler_flush(rv_relay_bundler_t* b, void* send_ctx, rv_relay_send_fn send_fn) {
+    for (uint32_t i = 0; i < b->count; ++i) send_bundle(b, &b->bundles[i], send_ctx, send_fn);
+    b->count = 0;
+    if (++b->gen == 0) b->gen = 1;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+#include "rv_netproto.h"
+#include "rv_relay.h"
+
+/*
+ * Per-listener bundling of relay forwards (RV_PKT_BUNDLE).
+ *
+ * Voice for a client that parses bundles is copied into that client's
+ * pending bundle instead of being sent. rv_relay_bundler_flush then sends
+ * each bundle as one datagram, or a lone datagram as it was, so a listener
+ * with k talkers in the window costs one send and one receive instead of
+ * k. Clients carry an rv_relay_bundle_ref_t to their bundle; every flush
+ * starts a new generation, which makes all refs stale without touching
+ * them.
+ */
+
+#ifndef RV_RELAY_BUNDLE_WINDOW_MS
+#define RV_RELAY_BUNDLE_WINDOW_MS 2   // default hold time for --bundle
+#endif
+
+typedef struct rv_relay_bundle {
+    rv_sockaddr_t to;
+    int len;                       // bytes in buf, header included
+    int count;                     // datagrams in it
+    uint8_t buf[RV_BUNDLE_MAX_BYTES];
+} rv_relay_bundle_t;
+
+typedef struct rv_relay_bundler {
+    rv_relay_bundle_t* bundles;    // [count] pending this generation
+    uint32_t count;
+    uint32_t cap;
+    uint32_t gen;                  // never 0, so zeroed refs are stale
+    uint64_t opened_us;            // first add of this generation
+
+    uint64_t bundled;              // datagrams that went out in a bundle
+    uint64_t sent;                 // bundles sent
+} rv_relay_bundler_t;
+
+void rv_relay_bundler_init(rv_relay_bundler_t* b);
+void rv_relay_bundler_free(rv_relay_bundler_t* b);
+
+// Add pkt to the bundle for `to` (found through ref, which is updated).
+// A bundle that would overflow is sent through send_fn first; without
+// memory for a new bundle the packet is sent on its own.
+int  rv_relay_bundler_add(rv_relay_bundler_t* b, rv_relay_bundle_ref_t* ref,
+                          const rv_sockaddr_t* to, const uint8_t* pkt, int len,
+                          uint64_t now_us, void* send_ctx, rv_relay_send_fn send_fn);
+
+// Send every pending bundle and start a new generation
+void rv_relay_bundler_flush(rv_relay_bundler_t* b, void* send_ctx, rv_relay_send_fn send_fn);
+
+static inline int rv_relay_bundler_pending(const rv_relay_bundler_t* b) {
+    return b->count != 0;
+}
@@ -0,0 +1,189 @@
+#include "rv_relay_io.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if RV_RELAY_IO_URING
+#include "rv_relay_uring.h"
+#endif
+
+int rv_relay_io_init(rv_relay_io_t* io, rv_udp_socket_t* sock, int use_uring) {
+    if (!io || !sock) return -1;
+    memset(io, 0, sizeof(*io));
+    io->sock = sock;
+    io->wake_fd = -1;
+
+#if RV_RELAY_IO_URING
+    if (use_uring) {
+        io->uring = rv_relay_uring_create(sock);
+        if (io->uring) return 0;
+    }
+#else
+    (void)use_uring;
+#endif
+
+    io->pool = (uint8_t*)malloc((size_t)RV_RELAY_IO_BATCH * RV_RELAY_IO_PKT);
+    io->tx = (rv_udp_msg_t*)malloc(sizeof(rv_udp_msg_t) * RV_RELAY_IO_TX_MAX);
+    io->arena = (uint8_t*)malloc(RV_RELAY_IO_ARENA);
+    if (!io->pool || !io->tx || !io->arena) {
+        rv_relay_io_free(io);
+        return -2;
+    }
+
+    for (int i = 0; i < RV_RELAY_IO_BATCH; ++i) {
+        io->rx[i].data = io->pool + (size_t)i * RV_RELAY_IO_PKT;
+        io->rx[i].cap = RV_RELAY_IO_PKT;
+    }
+    return 0;
+}
+
+void rv_relay_io_free(rv_relay_io_t* io) {
+    if (!io) return;
+#if RV_RELAY_IO_URING
+    rv_relay_uring_destroy(io->uring);
+    io->uring = NULL;
+#endif
+    free(io->pool);
+    free(io->tx);
+    free(io->arena);
+    io->pool = NULL;
+    io->tx = NULL;
+    io->arena = NULL;
+}
+
+static void count_rx(rv_relay_io_t* io, int n) {
+    for (int i = 0; i < n; ++i) io->rx_bytes += (uint64_t)io->rx[i].len;
+    if (n > 0) io->rx_packets += (uint64_t)n;
+}
+
+int rv_relay_io_recv(rv_relay_io_t* io, int timeout_ms) {
+    if (!io) return -1;
+#if RV_RELAY_IO_URING
+    if (io->uring) {
+        const int n = rv_relay_uring_recv(io->uring, io->rx, RV_RELAY_IO_BATCH, timeout_ms);
+        count_rx(io, n);
+        if (rv_relay_uring_woken(io->uring)) io->woken = 1;
+        return n;
+    }
+#endif
+    // Under load the socket is rarely empty, so try before waiting
+    int n = rv_udp_recv_batch(io->sock, io->rx, RV_RELAY_IO_BATCH);
+    if (n == 0 && timeout_ms != 0) {
+#ifndef _WIN32
+        if (io->wake_fd >= 0) {
+            const int r = rv_udp_wait_readable_fd(io->sock, io->wake_fd, timeout_ms);
+            if (r <= 0) return r;
+            if (r & 2) io->woken = 1;
+            if (!(r & 1)) return 0;
+        } else
+#endif
+        {
+            const int r = rv_udp_wait_readable(io->sock, timeout_ms);
+            if (r <= 0) return r;
+        }
+        n = rv_udp_recv_batch(io->sock, io->rx, RV_RELAY_IO_BATCH);
+    }
+    count_rx(io, n);
+    return n;
+}
+
+#ifndef _WIN32
+int rv_relay_io_watch(rv_relay_io_t* io, int fd) {
+    if (!io || fd < 0) return -1;
+    io->wake_fd = fd;
+#if RV_RELAY_IO_URING
+    if (io->uring) return rv_relay_uring_watch(io->uring, fd);
+#endif
+    return 0;
+}
+#endif
+
+static int in_pool(const rv_relay_io_t* io, const uint8_t* p, int len) {
+    const uint8_t* end = io->pool + (size_t)RV_RELAY_IO_BATCH * RV_RELAY_IO_PKT;
+    return p >= io->pool && p + len <= end;
+}
+
+int rv_relay_io_send(void* ctx, const rv_sockaddr_t* to, const uint8_t* data, int len) {
+    rv_relay_io_t* io = (rv_relay_io_t*)ctx;
+    if (!io || !to || !data || len <= 0 || len > RV_RELAY_IO_PKT) return -1;
+
+#if RV_RELAY_IO_URING
+    if (io->uring) {
+        const int r = rv_relay_uring_send(io->uring, to, data, len);
+        if (r < 0) {
+            io->tx_dropped++;
+        } else {
+            io->tx_packets++;
+            io->tx_bytes += (uint64_t)len;
+        }
+        return r;
+    }
+#endif
+
+    const int copy = !in_pool(io, data, len);
+    if (io->tx_count == RV_RELAY_IO_TX_MAX ||
+        (copy && io->arena_used + (size_t)len > RV_RELAY_IO_ARENA))
+        rv_relay_io_flush(io);
+
+    rv_udp_msg_t* m = &io->tx[io->tx_count++];
+    m->addr = *to;
+    m->len = len;
+    m->cap = len;
+    if (copy) {
+        m->data = io->arena + io->arena_used;
+        memcpy(m->data, data, (size_t)len);
+        io->arena_used += (size_t)len;
+    } else {
+        m->data = (uint8_t*)(uintptr_t)data;
+    }
+    return len;
+}
+
+void rv_relay_io_flush(rv_relay_io_t* io) {
+    if (!io) return;
+#if RV_RELAY_IO_URING
+    if (io->uring) {
+        uint64_t failed = 0;
+        rv_relay_uring_flush(io->uring);
+        rv_relay_uring_counts(io->uring, &failed, NULL);
+        io->tx_dropped += failed - io->tx_failed_seen;
+        io->tx_failed_seen = failed;
+        return;
+    }
+#endif
+    if (io->tx_count == 0) return;
+
+    const int sent = rv_udp_send_batch(io->sock, io->tx, io->tx_count);
+    if (sent > 0) io->tx_packets += (uint64_t)sent;
+    for (int i = 0; i < sent; ++i) io->tx_bytes += (uint64_t)io->tx[i].len;
+    if (sent < io->tx_count) io->tx_dropped += (uint64_t)(io->tx_count - (sent > 0 ? sent : 0));
+
+    io->tx_count = 0;
+    io->arena_used = 0;
+}
+
+const char* rv_relay_io_backend(const rv_relay_io_t* io) {
+#if RV_RELAY_IO_URING
+    if (io && io->uring) return "io_uring";
+#else
+    (void)io;
+#endif
+#if defined(__linux__)
+    return "recvmmsg";
+#else
+    return "recvfrom";
+#endif
+}
+
+uint64_t rv_relay_io_syscalls(const rv_relay_io_t* io) {
+    if (!io) return 0;
+#if RV_RELAY_IO_URING
+    if (io->uring) {
+        uint64_t enters = 0;
+        rv_relay_uring_counts(io->uring, NULL, &enters);
+        return enters;
+    }
+#endif
+    uint64_t rx = 0, tx = 0;
+    rv_udp_syscall_counts(io->sock, &rx, &tx);
+    return rx + tx;
+}
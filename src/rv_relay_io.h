@@ -0,0 +1,84 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "rv_udp.h"
+
+/*
+ * Batched relay I/O over one socket.
+ *
+ * Datagrams are received in batches into a pool allocated once at init.
+ * rv_relay_io_send (an rv_relay_send_fn) only queues: a packet that lives
+ * in the pool is referenced, anything else (JOIN_ACK and other packets
+ * the relay builds itself) is copied into a small arena. rv_relay_io_flush
+ * hands the queue to rv_udp_send_batch, so one received batch costs one
+ * receive call plus a few sendmmsg calls, whatever the fan-out.
+ *
+ * Built with RV_RELAY_IO_URING, the same calls can run on the io_uring
+ * engine in rv_relay_uring.h instead, where sends are submitted together
+ * with the next wait.
+ */
+
+#ifndef RV_RELAY_IO_BATCH
+#define RV_RELAY_IO_BATCH  RV_UDP_BATCH_MAX   // datagrams per receive call
+#endif
+
+#ifndef RV_RELAY_IO_TX_MAX
+#define RV_RELAY_IO_TX_MAX 1024               // queued sends before a forced flush
+#endif
+
+#define RV_RELAY_IO_PKT    1500               // pool buffer size (one MTU)
+#define RV_RELAY_IO_ARENA  (64 * 1024)
+
+struct rv_relay_uring;
+
+typedef struct rv_relay_io {
+    rv_udp_socket_t* sock;
+    struct rv_relay_uring* uring;  // io_uring engine, or NULL for batched syscalls
+
+    uint8_t* pool;                 // RV_RELAY_IO_BATCH x RV_RELAY_IO_PKT
+    rv_udp_msg_t rx[RV_RELAY_IO_BATCH];
+
+    rv_udp_msg_t* tx;              // [RV_RELAY_IO_TX_MAX]
+    int tx_count;
+    uint8_t* arena;                // copies of relay-built packets
+    size_t arena_used;
+
+    uint64_t rx_packets;
+    uint64_t rx_bytes;
+    uint64_t tx_packets;
+    uint64_t tx_bytes;
+    uint64_t tx_dropped;           // queued but not accepted by the socket
+    uint64_t tx_failed_seen;       // engine failures already in tx_dropped
+
+    int wake_fd;                   // also ends a wait when readable (-1: none)
+    int woken;                     // set by rv_relay_io_recv when wake_fd fired
+} rv_relay_io_t;
+
+// use_uring: try the io_uring engine first (ignored when not built in).
+// Falls back to batched syscalls when the kernel lacks what it needs.
+int  rv_relay_io_init(rv_relay_io_t* io, rv_udp_socket_t* sock, int use_uring);
+void rv_relay_io_free(rv_relay_io_t* io);
+
+// Receive a batch into io->rx, waiting up to timeout_ms for the first
+// datagram (<0: no limit, 0: poll). Returns the count, 0 on timeout, <0 on
+// error. Sends still queued reference the pool, so flush before receiving
+// again; with io_uring the queued sends are submitted by this call.
+int  rv_relay_io_recv(rv_relay_io_t* io, int timeout_ms);
+
+#ifndef _WIN32
+// Let fd (an eventfd another thread writes to) end the waits of
+// rv_relay_io_recv, which then sets io->woken. Reading fd is up to the
+// caller.
+int  rv_relay_io_watch(rv_relay_io_t* io, int fd);
+#endif
+
+// rv_relay_send_fn: queue one datagram (ctx is the rv_relay_io_t)
+int  rv_relay_io_send(void* ctx, const rv_sockaddr_t* to, const uint8_t* data, int len);
+
+void rv_relay_io_flush(rv_relay_io_t* io);
+
+// "io_uring", "recvmmsg" or "recvfrom"
+const char* rv_relay_io_backend(const rv_relay_io_t* io);
+
+// Kernel transitions so far (socket calls or io_uring_enter)
+uint64_t rv_relay_io_syscalls(const rv_relay_io_t* io);
@@ -1,22 +1,17 @@
 #include <stdio.h>
 #include <stdlib.h>
-
-#ifdef _WIN32
-#include <windows.h>
-static void rv_sleep_ms(int ms) { Sleep((DWORD)ms); }
-#else
-#include <unistd.h>
-static void rv_sleep_ms(int ms) { usleep(ms * 1000); }
-#endif
+#include <string.h>
 
 #include "rv_udp.h"
-#include "rv_netproto.h"
 #include "rv_relay.h"
+#include "rv_relay_bundle.h"
+#include "rv_relay_shard.h"
 
-static int udp_send_wrap(void* ctx, const rv_sockaddr_t* to, const uint8_t* data, int len) {
-    rv_udp_socket_t* s = (rv_udp_socket_t*)ctx;
-    return rv_udp_sendto(s, to, data, len);
-}
+// Voice arrives in bursts from every talker at once; the default
+// buffers (about 200 KB on Linux) overflow long before the CPU does.
+#ifndef RV_RELAY_SOCKET_BUF
+#define RV_RELAY_SOCKET_BUF (4 * 1024 * 1024)
+#endif
 
 static uint16_t parse_u16(const char* s, uint16_t def) {
     if (!s || !*s) return def;
@@ -25,57 +20,159 @@ static uint16_t parse_u16(const char* s, uint16_t def) {
     return (uint16_t)v;
 }
 
+// IP:PORT, or [IPv6]:PORT
+static int parse_endpoint(const char* s, rv_sockaddr_t* out) {
+    const char* colon = strrchr(s, ':');
+    if (!colon || colon == s) return -1;
+    char host[64];
+    size_t n = (size_t)(colon - s);
+    if (s[0] == '[' && colon[-1] == ']') {
+        s++;
+        n -= 2;
+    }
+    if (n == 0 || n >= sizeof(host)) return -1;
+    memcpy(host, s, n);
+    host[n] = '\0';
+    const uint16_t port = parse_u16(colon + 1, 0);
+    if (port == 0) return -1;
+    return rv_parse_ip_port(host, port, out);
+}
+
 int main(int argc, char** argv) {
     uint16_t port = 40000;
-    if (argc >= 2) port = parse_u16(argv[1], 40000);
+    int use_uring = 0;     // --io=uring: io_uring engine when built in and supported
+    int threads = 1;       // --threads=N: N shards on their own cores
+    int last_n = 0;        // --last-n=N: forward the N loudest speakers per session
+    int bundle_ms = -1;    // --bundle[=MS]: one datagram per listener per window
+    int mix_min = 0;       // --mix[=N]: mix sessions of N members or more (bare: all)
+    int idle_s = RV_RELAY_IDLE_MS / 1000; // --idle=S: drop clients silent for S seconds (0: never)
+    const char* metrics = NULL; // --metrics[=PATH]: JSON lines of counters to stdout or PATH
+    long rate_pps = RV_RELAY_RATE_PPS;     // --rate=PPS[,BYTES]: voice per client and second (0: unlimited)
+    long rate_bytes = RV_RELAY_RATE_BYTES;
+    const char* upstream = NULL;  // --upstream=IP:PORT: cascade every session to that relay
+    const char* peers[RV_RELAY_MAX_PEER_ADDRS]; // --peer=IP (repeatable): relays that may cascade to us
+    int peer_count = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--io=uring") == 0) use_uring = 1;
+        else if (strcmp(argv[i], "--io=mmsg") == 0) use_uring = 0;
+        else if (strncmp(argv[i], "--threads=", 10) == 0) threads = atoi(argv[i] + 10);
+        else if (strncmp(argv[i], "--last-n=", 9) == 0) last_n = atoi(argv[i] + 9);
+        else if (strcmp(argv[i], "--bundle") == 0) bundle_ms = RV_RELAY_BUNDLE_WINDOW_MS;
+        else if (strncmp(argv[i], "--bundle=", 9) == 0) bundle_ms = atoi(argv[i] + 9);
+        else if (strcmp(argv[i], "--mix") == 0) mix_min = 1;
+        else if (strncmp(argv[i], "--mix=", 6) == 0) mix_min = atoi(argv[i] + 6) > 0 ? atoi(argv[i] + 6) : 1;
+        else if (strncmp(argv[i], "--idle=", 7) == 0) idle_s = atoi(argv[i] + 7) > 0 ? atoi(argv[i] + 7) : 0;
+        else if (strcmp(argv[i], "--metrics") == 0) metrics = "-";
+        else if (strncmp(argv[i], "--metrics=", 10) == 0) metrics = argv[i] + 10;
+        else if (strncmp(argv[i], "--rate=", 7) == 0) {
+            char* end = NULL;
+            rate_pps = strtol(argv[i] + 7, &end, 10);
+            rate_bytes = *end == ',' ? strtol(end + 1, NULL, 10) : (rate_pps ? rate_bytes : 0);
+            if (rate_pps < 0) rate_pps = 0;
+            if (rate_bytes < 0) rate_bytes = 0;
+        }
+        else if (strncmp(argv[i], "--upstream=", 11) == 0) upstream = argv[i] + 11;
+        else if (strncmp(argv[i], "--peer=", 7) == 0) {
+            if (peer_count == RV_RELAY_MAX_PEER_ADDRS) {
+                printf("relay: at most %d --peer addresses\n", RV_RELAY_MAX_PEER_ADDRS);
+                return 1;
+            }
+            peers[peer_count++] = argv[i] + 7;
+        }
+        else port = parse_u16(argv[i], 40000);
+    }
+
+    // --metrics without a path owns stdout: one JSON object per line
+    FILE* info = metrics && strcmp(metrics, "-") == 0 ? stderr : stdout;
+
+    if (threads < 1) threads = 1;
+    if (threads > RV_RELAY_MAX_SHARDS) threads = RV_RELAY_MAX_SHARDS;
+    if (threads > 1 && !rv_relay_shards_supported()) {
+        fprintf(info, "relay: --threads needs SO_REUSEPORT balancing (Linux); running one shard\n");
+        threads = 1;
+    }
 
     if (rv_udp_startup() != 0) {
-        printf("relay: WSAStartup failed\n");
+        fprintf(info, "relay: socket startup failed\n");
         return 1;
     }
 
-    rv_udp_socket_t* sock = rv_udp_create_dualstack(port, 1 /*nonblocking*/);
-    if (!sock) {
-        printf("relay: failed to bind UDP port %u\n", (unsigned)port);
+    rv_sockaddr_t upstream_addr;
+    rv_sockaddr_t peer_addrs[RV_RELAY_MAX_PEER_ADDRS];
+    if (upstream && parse_endpoint(upstream, &upstream_addr) != 0) {
+        fprintf(info, "relay: --upstream=%s is not IP:PORT\n", upstream);
         rv_udp_cleanup();
-        return 2;
+        return 1;
+    }
+    for (int i = 0; i < peer_count; ++i) {
+        if (rv_parse_ip_port(peers[i], 0, &peer_addrs[i]) != 0) {
+            fprintf(info, "relay: --peer=%s is not an IP address\n", peers[i]);
+            rv_udp_cleanup();
+            return 1;
+        }
     }
 
-    rv_relay_state_t st;
-    rv_relay_init(&st);
-
-    printf("residual_relay listening on UDP port %u (dual-stack)\n", (unsigned)port);
-
-    uint8_t buf[1400];
-
-    for (;;) {
-        rv_sockaddr_t from;
-        int r = rv_udp_recvfrom(sock, &from, buf, (int)sizeof(buf));
-        if (r <= 0) {
-            rv_sleep_ms(1);
-            continue;
+    // All sockets join the port's group before any traffic, so the kernel
+    // keeps sending each client to the same one
+    FILE* metrics_out = NULL;
+    if (metrics) {
+        metrics_out = strcmp(metrics, "-") == 0 ? stdout : fopen(metrics, "a");
+        if (!metrics_out) {
+            fprintf(info, "relay: cannot open %s for metrics\n", metrics);
+            rv_udp_cleanup();
+            return 2;
         }
+    }
 
-        rv_pkt_hdr_t hdr;
-        if (rv_parse_packet_header(buf, r, &hdr) != 0) continue;
+    rv_udp_socket_t* socks[RV_RELAY_MAX_SHARDS];
+    for (int i = 0; i < threads; ++i) {
+        socks[i] = threads == 1 ? rv_udp_create_dualstack(port, 1 /*nonblocking*/)
+                                : rv_udp_create_reuseport(port, 1 /*nonblocking*/);
+        if (!socks[i]) {
+            fprintf(info, "relay: failed to bind UDP port %u\n", (unsigned)port);
+            while (i-- > 0) rv_udp_destroy(socks[i]);
+            rv_udp_cleanup();
+            return 2;
+        }
+        if (rv_udp_set_buffers(socks[i], RV_RELAY_SOCKET_BUF, RV_RELAY_SOCKET_BUF) != 0 && i == 0)
+            fprintf(info, "relay: could not set socket buffers to %d bytes\n", RV_RELAY_SOCKET_BUF);
+    }
 
-        if (hdr.type == RV_PKT_JOIN) {
-            uint64_t session_id = 0;
-            uint16_t player_id = 0;
-            if (rv_parse_join_payload(buf, r, &session_id, &player_id) == 0) {
-                rv_relay_join(&st, session_id, player_id, &from);
-                printf("JOIN session=%llu player=%u\n",
-                       (unsigned long long)session_id, (unsigned)player_id);
-            }
-        } else if (hdr.type == RV_PKT_VOICE) {
-            // Prototype routing: single session for now
-            const uint64_t session_id = 1234;
+    rv_relay_shards_t* shards = rv_relay_shards_create(socks, threads, use_uring);
+    if (!shards) {
+        fprintf(info, "relay: out of memory\n");
+        rv_udp_cleanup();
+        return 3;
+    }
+    rv_relay_shards_set_idle(shards, (uint32_t)idle_s * 1000u);
+    rv_relay_shards_set_metrics(shards, metrics_out);
+    rv_relay_shards_set_rate(shards, (uint32_t)rate_pps, (uint32_t)rate_bytes);
+    if (last_n > 0) rv_relay_shards_set_last_n(shards, (uint32_t)last_n);
+    if (upstream) rv_relay_shards_set_upstream(shards, &upstream_addr);
+    for (int i = 0; i < peer_count; ++i) (void)rv_relay_shards_allow_peer(shards, &peer_addrs[i]);
+    if (bundle_ms >= 0) rv_relay_shards_set_bundle(shards, bundle_ms);
+    if (mix_min > 0 && rv_relay_shards_set_mix(shards, (uint32_t)mix_min) != 0) {
+        fprintf(info, "relay: --mix needs a relay built with RV_RELAY_MIX (Opus); forwarding only\n");
+        mix_min = 0;
+    }
+    if (rv_relay_shards_start(shards) != 0) {
+        fprintf(info, "relay: could not start %d shards\n", threads);
+        rv_relay_shards_destroy(shards);
+        rv_udp_cleanup();
+        return 3;
+    }
 
-            // ✅ FIX: pass &from (address), NOT speaker_id or player_id
-            rv_relay_forward_voice(&st, session_id, &from, buf, r, sock, udp_send_wrap);
+    fprintf(info, "residual_relay listening on UDP port %u (dual-stack, %s, %d shard%s)\n",
+           (unsigned)port, rv_relay_shards_backend(shards), threads, threads == 1 ? "" : "s");
+    if (last_n > 0) fprintf(info, "relay: forwarding the %d loudest speakers per session\n", last_n);
+    if (bundle_ms >= 0) fprintf(info, "relay: bundling forwards per listener every %d ms\n", bundle_ms);
+    if (metrics_out && metrics_out != stdout) fprintf(info, "relay: writing metrics to %s\n", metrics);
+    if (idle_s == 0) fprintf(info, "relay: keeping idle clients until they leave\n");
+    if (rate_pps == 0 && rate_bytes == 0) fprintf(info, "relay: not limiting voice rates\n");
+    if (mix_min > 0) fprintf(info, "relay: mixing sessions of %d or more clients\n", mix_min);
+    if (upstream) fprintf(info, "relay: cascading sessions to %s\n", upstream);
+    if (peer_count > 0) fprintf(info, "relay: accepting %d peer relay address%s\n", peer_count, peer_count == 1 ? "" : "es");
 
-            printf("VOICE len=%d from speaker=%u seq=%u\n",
-                   r, (unsigned)hdr.speaker_id, (unsigned)hdr.seq);
-        }
-    }
+    rv_relay_shards_run(shards);
+    return 0;
 }
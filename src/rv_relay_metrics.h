@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Relay counters, one set per shard.
+ *
+ * Only the shard's own thread touches them, so the packet path bumps
+ * plain integers, with no atomics or locks. The shard reports them from a
+ * housekeeping timer (see rv_relay_shards_set_metrics), together with the
+ * I/O counters of its socket and the sizes of its tables.
+ *
+ * Histograms use power-of-two buckets: bucket 0 counts zero, bucket k
+ * counts [2^(k-1), 2^k), and the last one everything above.
+ */
+
+#define RV_RELAY_FANOUT_BUCKETS  10   // 0, 1, 2-3, ..., 128-255, 256+ sends
+#define RV_RELAY_LATENCY_BUCKETS 21   // 0 us .. 2^19 us (about 0.5 s) and above
+
+typedef enum rv_relay_drop {
+    RV_RELAY_DROP_MALFORMED = 0,  // not a packet of ours
+    RV_RELAY_DROP_UNJOINED,       // from an endpoint with no session
+    RV_RELAY_DROP_HANDOFF,        // the owning shard's ring was full
+    RV_RELAY_DROP_LAST_N,         // speaker without a last-N slot
+    RV_RELAY_DROP_RATE,           // voice over its endpoint's rate
+    RV_RELAY_DROP_SPOOFED,        // speaker/reporter id other than the sender's
+    RV_RELAY_DROP_JOIN_RATE,      // new endpoint over the shard's join rate
+    RV_RELAY_DROP_PEER,           // relay traffic from an address that is no peer
+    RV_RELAY_DROP_LOOP,           // cascaded voice past its hops, or looping back
+    RV_RELAY_DROP_COUNT
+} rv_relay_drop_t;
+
+typedef struct rv_relay_metrics {
+    uint64_t joins;               // JOINs that were not keepalives
+    uint64_t voice;               // VOICE packets routed to their session
+    uint64_t forwards;            // datagrams (or bundle entries) they went out as
+    uint64_t mixed;               // VOICE packets that went into a mix
+    uint64_t drops[RV_RELAY_DROP_COUNT];
+
+    uint64_t fanout[RV_RELAY_FANOUT_BUCKETS];   // forwards per routed VOICE
+    uint64_t latency[RV_RELAY_LATENCY_BUCKETS]; // receive to send, microseconds
+} rv_relay_metrics_t;
+
+static inline uint32_t rv_relay_metrics_bucket(uint64_t v, uint32_t buckets) {
+    uint32_t b = 0;
+    while (v && b < buckets - 1) {
+        v >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static inline void rv_relay_metrics_fanout(rv_relay_metrics_t* m, uint64_t sends) {
+    m->fanout[rv_relay_metrics_bucket(sends, RV_RELAY_FANOUT_BUCKETS)]++;
+}
+
+static inline void rv_relay_metrics_latency(rv_relay_metrics_t* m, uint64_t us) {
+    m->latency[rv_relay_metrics_bucket(us, RV_RELAY_LATENCY_BUCKETS)]++;
+}
@@ -0,0 +1,352 @@
+#include "rv_relay_mix.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if RV_RELAY_MIX
+
+#include "rv_opus.h"
+#include "rv_opus_jitter.h"
+#include "rv_vad.h"
+
+#define RV_MIX_MAX_FRAMES 6    // frames in one Opus packet (120 ms)
+#define RV_MIX_IDLE_TICKS ((RV_RELAY_MIX_IDLE_MS + RV_RELAY_MIX_FRAME_MS - 1) / RV_RELAY_MIX_FRAME_MS)
+
+// One speaker being decoded, and the mix of everyone else for it
+typedef struct rv_mix_voice {
+    uint16_t player_id;
+    uint8_t active;            // has a frame in this tick's sum
+    uint32_t idle_ticks;
+    rv_opus_dec_t* dec;
+    rv_opus_enc_t* enc;        // mix minus this speaker, created on first use
+    int16_t pcm[RV_RELAY_MIX_FRAME];
+    int out_len;               // encoded this tick, <0: not yet
+    uint8_t out_level;
+    uint8_t out[RV_OPUS_MAX_PACKET];
+    rv_opus_jitter_t jb;
+} rv_mix_voice_t;
+
+struct rv_relay_mix_session {
+    uint32_t session;          // slab index in rv_relay_state_t
+    uint32_t slot;             // index in the mixer's list
+    rv_mix_voice_t** voices;   // [count]
+    uint32_t count;
+    uint32_t cap;
+    rv_opus_enc_t* enc;        // the mix of everyone, for listeners not talking
+    int out_len;
+    uint8_t out_level;
+    uint8_t out[RV_OPUS_MAX_PACKET];
+};
+
+static rv_opus_config_t mix_config(void) {
+    rv_opus_config_t c;
+    memset(&c, 0, sizeof(c));
+    c.sample_rate = RV_RELAY_MIX_RATE;
+    c.channels = 1;
+    c.frame_ms = RV_RELAY_MIX_FRAME_MS;
+    c.bitrate_bps = RV_RELAY_MIX_BITRATE;
+    c.use_fec = 1;
+    c.complexity = 5;
+    c.expected_loss_pct = 5;
+    c.signal = RV_OPUS_SIGNAL_VOICE;
+    return c;
+}
+
+int rv_relay_mix_supported(void) {
+    return 1;
+}
+
+void rv_relay_mixer_init(rv_relay_mixer_t* m, uint32_t min_members) {
+    memset(m, 0, sizeof(*m));
+    m->min_members = min_members ? min_members : 1;
+}
+
+static void voice_free(rv_mix_voice_t* vc) {
+    if (vc->dec) rv_opus_dec_destroy(vc->dec);
+    if (vc->enc) rv_opus_enc_destroy(vc->enc);
+    free(vc);
+}
+
+static void session_free(rv_relay_mix_session_t* ms) {
+    for (uint32_t i = 0; i < ms->count; ++i) voice_free(ms->voices[i]);
+    free(ms->voices);
+    if (ms->enc) rv_opus_enc_destroy(ms->enc);
+    free(ms);
+}
+
+void rv_relay_mixer_free(rv_relay_mixer_t* m) {
+    if (!m) return;
+    for (uint32_t i = 0; i < m->count; ++i) session_free(m->sessions[i]);
+    free(m->sessions);
+    memset(m, 0, sizeof(*m));
+}
+
+rv_relay_mix_session_t* rv_relay_mix_open(rv_relay_mixer_t* m, uint32_t session) {
+    if (m->count == m->cap) {
+        const uint32_t cap = m->cap ? m->cap * 2 : 8;
+        rv_relay_mix_session_t** grown =
+            (rv_relay_mix_session_t**)realloc(m->sessions, cap * sizeof(*grown));
+        if (!grown) return NULL;
+        m->sessions = grown;
+        m->cap = cap;
+    }
+    rv_relay_mix_session_t* ms = (rv_relay_mix_session_t*)calloc(1, sizeof(*ms));
+    if (!ms) return NULL;
+    const rv_opus_config_t cfg = mix_config();
+    ms->enc = rv_opus_enc_create(&cfg);
+    if (!ms->enc) {
+        free(ms);
+        return NULL;
+    }
+    ms->session = session;
+    ms->slot = m->count;
+    m->sessions[m->count++] = ms;
+    return ms;
+}
+
+void rv_relay_mix_close(rv_relay_mixer_t* m, rv_relay_mix_session_t* ms) {
+    if (!ms) return;
+    const uint32_t last = --m->count;
+    if (ms->slot != last) {
+        m->sessions[ms->slot] = m->sessions[last];
+        m->sessions[ms->slot]->slot = ms->slot;
+    }
+    session_free(ms);
+}
+
+static rv_mix_voice_t* find_voice(rv_relay_mix_session_t* ms, uint16_t player_id) {
+    for (uint32_t i = 0; i < ms->count; ++i)
+        if (ms->voices[i]->player_id == player_id) return ms->voices[i];
+    return NULL;
+}
+
+static rv_mix_voice_t* add_voice(rv_relay_mix_session_t* ms, uint16_t player_id) {
+    if (ms->count == ms->cap) {
+        const uint32_t cap = ms->cap ? ms->cap * 2 : 8;
+        rv_mix_voice_t** grown = (rv_mix_voice_t**)realloc(ms->voices, cap * sizeof(*grown));
+        if (!grown) return NULL;
+        ms->voices = grown;
+        ms->cap = cap;
+    }
+    rv_mix_voice_t* vc = (rv_mix_voice_t*)calloc(1, sizeof(*vc));
+    if (!vc) return NULL;
+    const rv_opus_config_t cfg = mix_config();
+    vc->dec = rv_opus_dec_create(&cfg);
+    if (!vc->dec) {
+        free(vc);
+        return NULL;
+    }
+    vc->player_id = player_id;
+    rv_opus_jitter_init(&vc->jb);
+    ms->voices[ms->count++] = vc;
+    return vc;
+}
+
+// Same unpacking as rv_voice_ingest_packet: timestamp, RED, multi-frame
+int rv_relay_mix_push(rv_relay_mix_session_t* ms, uint16_t player_id, const rv_pkt_view_t* pv) {
+    if (!ms || !pv || (pv->ext & RV_EXT_ENC)) return -1;
+
+    rv_pkt_view_t v = *pv;
+    uint32_t ts_us = 0;
+    if (rv_pkt_view_take_ts(&v, &ts_us) < 0) return -2;
+
+    const uint8_t* payload = v.payload;
+    uint16_t payload_len = v.payload_len;
+    rv_red_block_t red[RV_RED_MAX_DEPTH];
+    int red_count = 0;
+    if ((v.ext & RV_EXT_RED) &&
+        rv_parse_red_payload(payload, payload_len, red, RV_RED_MAX_DEPTH, &red_count,
+                             &payload, &payload_len) != 0)
+        return -3;
+    if (payload_len == 0) return -4;
+
+    rv_mix_voice_t* vc = find_voice(ms, player_id);
+    if (!vc) vc = add_voice(ms, player_id);
+    if (!vc) return -5;
+
+    if (v.flags & RV_FLAG_TALKSPURT) rv_opus_jitter_resync(&vc->jb, v.seq);
+
+    if ((payload[0] & 0x3u) == 0) {
+        rv_opus_jitter_push(&vc->jb, v.seq, payload, payload_len);
+    } else {
+        uint8_t frames[RV_BUNDLE_MAX_BYTES + RV_MIX_MAX_FRAMES];
+        uint16_t lens[RV_MIX_MAX_FRAMES];
+        const int count = rv_opus_packet_split(payload, (int)payload_len, frames, (int)sizeof(frames),
+                                               lens, RV_MIX_MAX_FRAMES);
+        if (count <= 0) return -6;
+        const uint8_t* f = frames;
+        for (int k = 0; k < count; ++k) {
+            rv_opus_jitter_push(&vc->jb, (uint16_t)(v.seq + k), f, lens[k]);
+            f += lens[k];
+        }
+    }
+    for (int k = 0; k < red_count; ++k)
+        rv_opus_jitter_push_redundant(&vc->jb, (uint16_t)(v.seq - red[k].seq_offset),
+                                      red[k].data, red[k].len);
+    vc->idle_ticks = 0;
+    return 0;
+}
+
+// One tick of a speaker into vc->pcm; 1 when it had any. Senders with
+// shorter frames (10 ms) take several per tick, so they neither fall
+// behind nor lose every other frame.
+static int voice_pull(rv_mix_voice_t* vc) {
+    int filled = 0;
+    while (filled < RV_RELAY_MIX_FRAME) {
+        const uint8_t* pkt = NULL;
+        uint16_t pkt_len = 0;
+        uint8_t fec = 0;
+        if (!rv_opus_jitter_pop(&vc->jb, &pkt, &pkt_len, &fec)) break;
+
+        // The decoder wants room for a whole tick; concealment fills that much
+        int16_t pcm[RV_RELAY_MIX_FRAME];
+        int n = fec
+            ? rv_opus_decode_fec(vc->dec, pkt, (int)pkt_len, pcm, RV_RELAY_MIX_FRAME)
+            : rv_opus_decode(vc->dec, pkt, (int)pkt_len, pcm, RV_RELAY_MIX_FRAME);
+        if (n <= 0) continue;
+        if (n > RV_RELAY_MIX_FRAME - filled) n = RV_RELAY_MIX_FRAME - filled;
+        memcpy(vc->pcm + filled, pcm, sizeof(int16_t) * (size_t)n);
+        filled += n;
+    }
+    if (filled == 0) return 0;
+    // A stream that paused mid-tick leaves the rest silent
+    if (filled < RV_RELAY_MIX_FRAME)
+        memset(vc->pcm + filled, 0, sizeof(int16_t) * (size_t)(RV_RELAY_MIX_FRAME - filled));
+    return 1;
+}
+
+static int16_t clamp16(int32_t x) {
+    if (x > INT16_MAX) return INT16_MAX;
+    if (x < INT16_MIN) return INT16_MIN;
+    return (int16_t)x;
+}
+
+// Encode sum minus `minus` (NULL: nothing); returns the length or <0
+static int encode_mix(rv_relay_mixer_t* m, rv_opus_enc_t* enc, const int16_t* minus,
+                      uint8_t* out, int cap, uint8_t* out_level) {
+    int16_t pcm[RV_RELAY_MIX_FRAME];
+    for (int i = 0; i < RV_RELAY_MIX_FRAME; ++i)
+        pcm[i] = clamp16(m->sum[i] - (minus ? minus[i] : 0));
+
+    uint64_t energy = 0;
+    uint32_t zc = 0;
+    rv_vad_analyze(pcm, RV_RELAY_MIX_FRAME, &energy, &zc);
+    *out_level = rv_vad_level((float)energy / (float)RV_RELAY_MIX_FRAME);
+
+    m->encoded++;
+    return rv_opus_encode(enc, pcm, RV_RELAY_MIX_FRAME, out, cap);
+}
+
+static void send_mix(rv_relay_mixer_t* m, rv_relay_client_t* c, const uint8_t* payload, int len,
+                     uint8_t level, void* send_ctx, rv_relay_send_fn send_fn) {
+    uint8_t pkt[sizeof(rv_pkt_hdr_t) + RV_V2_MAX_HDR + RV_OPUS_MAX_PACKET];
+    const uint8_t flags = c->mix_live ? 0 : RV_FLAG_TALKSPURT;
+    const int v2 = c->wire_ver >= RV_PROTO_VER2;
+    const int n = rv_build_voice_packet_red(pkt, (int)sizeof(pkt), v2 ? RV_PROTO_VER2 : RV_PROTO_VER,
+                                            RV_MIX_SPEAKER, c->mix_seq, flags, NULL,
+                                            v2 ? &level : NULL, NULL, 0, payload, (uint16_t)len);
+    if (n <= 0) return;
+    c->mix_seq++;
+    c->mix_live = 2;
+    (void)send_fn(send_ctx, &c->addr, pkt, n);
+    m->sent++;
+}
+
+static void mix_session(rv_relay_mixer_t* m, rv_relay_mix_session_t* ms, rv_relay_session_t* s,
+                        void* send_ctx, rv_relay_send_fn send_fn) {
+    memset(m->sum, 0, sizeof(m->sum));
+    uint32_t talking = 0;
+    for (uint32_t i = 0; i < ms->count;) {
+        rv_mix_voice_t* vc = ms->voices[i];
+        vc->out_len = -1;
+        vc->active = (uint8_t)voice_pull(vc);
+        if (vc->active) {
+            m->decoded++;
+            talking++;
+            vc->idle_ticks = 0;
+            for (int k = 0; k < RV_RELAY_MIX_FRAME; ++k) m->sum[k] += vc->pcm[k];
+        } else if (++vc->idle_ticks >= RV_MIX_IDLE_TICKS) {
+            ms->voices[i] = ms->voices[--ms->count];
+            voice_free(vc);
+            continue;
+        }
+        ++i;
+    }
+    ms->out_len = -1;
+
+    for (uint32_t i = 0; i < s->count; ++i) {
+        rv_relay_client_t* c = &s->clients[i];
+        if (!c->mixed) continue;
+        // mix_live counts down, so a listener that got nothing last tick
+        // starts its next packet as a new talkspurt
+        if (c->mix_live) c->mix_live--;
+        if (talking == 0) continue;
+
+        rv_mix_voice_t* own = find_voice(ms, c->player_id);
+        if (own && !own->active) own = NULL;
+        if (own && talking == 1) continue;   // nobody else to hear
+
+        if (own) {
+            if (own->out_len < 0) {
+                if (!own->enc) {
+                    const rv_opus_config_t cfg = mix_config();
+                    own->enc = rv_opus_enc_create(&cfg);
+                }
+                own->out_len = own->enc ? encode_mix(m, own->enc, own->pcm, own->out,
+                                                     (int)sizeof(own->out), &own->out_level)
+                                        : 0;
+            }
+            if (own->out_len > 0)
+                send_mix(m, c, own->out, own->out_len, own->out_level, send_ctx, send_fn);
+        } else {
+            if (ms->out_len < 0)
+                ms->out_len = encode_mix(m, ms->enc, NULL, ms->out, (int)sizeof(ms->out), &ms->out_level);
+            if (ms->out_len > 0)
+                send_mix(m, c, ms->out, ms->out_len, ms->out_level, send_ctx, send_fn);
+        }
+    }
+}
+
+void rv_relay_mix_tick(rv_relay_mixer_t* m, rv_relay_state_t* st,
+                       void* send_ctx, rv_relay_send_fn send_fn) {
+    if (!m || !st || !send_fn) return;
+    for (uint32_t i = 0; i < m->count; ++i) {
+        rv_relay_mix_session_t* ms = m->sessions[i];
+        mix_session(m, ms, &st->sessions[ms->session], send_ctx, send_fn);
+    }
+}
+
+#else // without Opus
+
+int rv_relay_mix_supported(void) {
+    return 0;
+}
+
+void rv_relay_mixer_init(rv_relay_mixer_t* m, uint32_t min_members) {
+    memset(m, 0, sizeof(*m));
+    m->min_members = min_members;
+}
+
+void rv_relay_mixer_free(rv_relay_mixer_t* m) {
+    if (m) memset(m, 0, sizeof(*m));
+}
+
+rv_relay_mix_session_t* rv_relay_mix_open(rv_relay_mixer_t* m, uint32_t session) {
+    (void)m; (void)session;
+    return NULL;
+}
+
+void rv_relay_mix_close(rv_relay_mixer_t* m, rv_relay_mix_session_t* ms) {
+    (void)m; (void)ms;
+}
+
+int rv_relay_mix_push(rv_relay_mix_session_t* ms, uint16_t player_id, const rv_pkt_view_t* pv) {
+    (void)ms; (void)player_id; (void)pv;
+    return -1;
+}
+
+void rv_relay_mix_tick(rv_relay_mixer_t* m, rv_relay_state_t* st,
+                       void* send_ctx, rv_relay_send_fn send_fn) {
+    (void)m; (void)st; (void)send_ctx; (void)send_fn;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#pragma once
+#include <stdint.h>
+#include "rv_netproto.h"
+#include "rv_relay.h"
+
+/*
+ * Server-side mixing (MCU mode) for large sessions.
+ *
+ * Once a session has min_members clients, its voice is decoded instead of
+ * forwarded, with the engine's own jitter buffer and Opus decoder. Every
+ * RV_RELAY_MIX_FRAME_MS the relay adds up one frame per active speaker,
+ * and each client that joined with RV_CAP_MIX gets that sum minus its own
+ * voice as a single stream from RV_MIX_SPEAKER. Listeners who are not
+ * talking share one encode; each talker needs one of its own. Clients
+ * without RV_CAP_MIX, clients that sent an INTEREST (the mix carries no
+ * channel or position to filter by), and sealed voice (the relay has no
+ * key) are still forwarded as before.
+ *
+ * A mixer belongs to one shard and mixes the sessions that shard owns, so
+ * mixing spreads over sessions and cores like the rest of the packet path.
+ * Built with RV_RELAY_MIX only, since it links Opus; without it
+ * rv_relay_mix_supported() is 0 and no session ever mixes.
+ */
+
+#ifndef RV_RELAY_MIX_FRAME_MS
+#define RV_RELAY_MIX_FRAME_MS RV_MIX_FRAME_MS   // what RV_CAP_MIX clients expect
+#endif
+#define RV_RELAY_MIX_RATE   48000
+#define RV_RELAY_MIX_FRAME  (RV_RELAY_MIX_RATE / 1000 * RV_RELAY_MIX_FRAME_MS)   // mono samples
+
+#ifndef RV_RELAY_MIX_BITRATE
+#define RV_RELAY_MIX_BITRATE 32000
+#endif
+
+// A speaker's decoder is released after this long without voice
+#ifndef RV_RELAY_MIX_IDLE_MS
+#define RV_RELAY_MIX_IDLE_MS 1000
+#endif
+
+typedef struct rv_relay_mix_session rv_relay_mix_session_t;
+
+typedef struct rv_relay_mixer {
+    uint32_t min_members;            // sessions this large mix
+    rv_relay_mix_session_t** sessions; // [count] mixing on this shard
+    uint32_t count;
+    uint32_t cap;
+    int32_t sum[RV_RELAY_MIX_FRAME];
+
+    uint64_t decoded;                // frames decoded (PLC and FEC included)
+    uint64_t encoded;                // mixes encoded
+    uint64_t sent;                   // mixed packets sent
+} rv_relay_mixer_t;
+
+// Whether this build can mix
+int  rv_relay_mix_supported(void);
+
+void rv_relay_mixer_init(rv_relay_mixer_t* m, uint32_t min_members);
+void rv_relay_mixer_free(rv_relay_mixer_t* m);
+
+// Start mixing the session at this slab index; NULL without memory
+rv_relay_mix_session_t* rv_relay_mix_open(rv_relay_mixer_t* m, uint32_t session);
+void rv_relay_mix_close(rv_relay_mixer_t* m, rv_relay_mix_session_t* ms);
+
+// Queue an unsealed VOICE packet from player_id for the next frames.
+// Returns 0, or <0 if it cannot be mixed (the caller forwards it).
+int  rv_relay_mix_push(rv_relay_mix_session_t* ms, uint16_t player_id, const rv_pkt_view_t* pv);
+
+// Mix one frame of every mixing session in st and send it to the members
+// that take the mix
+void rv_relay_mix_tick(rv_relay_mixer_t* m, rv_relay_state_t* st,
+                       void* send_ctx, rv_relay_send_fn send_fn);
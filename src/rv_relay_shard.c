@@ -0,0 +1,778 @@
+#include "rv_relay_shard.h"
+#include "rv_netproto.h"
+#include "rv_relay.h"
+#include "rv_relay_bundle.h"
+#include "rv_relay_metrics.h"
+#include "rv_relay_mix.h"
+#include "rv_relay_wheel.h"
+#include "rv_relay_io.h"
+#include "rv_time.h"
+#include "rv_timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Threads and SO_REUSEPORT balancing; elsewhere the relay runs one shard
+#ifndef RV_RELAY_SHARDS_THREADED
+#if defined(__linux__)
+#define RV_RELAY_SHARDS_THREADED 1
+#else
+#define RV_RELAY_SHARDS_THREADED 0
+#endif
+#endif
+
+#if RV_RELAY_SHARDS_THREADED
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+#ifndef RV_RELAY_STATS_PERIOD_MS
+#define RV_RELAY_STATS_PERIOD_MS 10000
+#endif
+
+#ifndef RV_RELAY_METRICS_PERIOD_MS
+#define RV_RELAY_METRICS_PERIOD_MS 10000
+#endif
+
+#if RV_RELAY_SHARDS_THREADED
+
+// ---- Handoff rings ----
+// Single producer, single consumer, like the capture ring in voice.c, but
+// over bytes so small voice packets do not each take an MTU slot. Records
+// are 64-byte aligned and never wrap; a negative len skips to the start.
+// The skip marker is a record header, so any tail end must hold one.
+
+#define RV_HANDOFF_ALIGN 64u
+
+typedef struct rv_handoff {
+    rv_sockaddr_t from;
+    int32_t len;          // 0: drop the endpoint from its session
+    uint64_t rx_us;       // when the arriving shard received it
+} rv_handoff_t;
+
+_Static_assert(sizeof(rv_handoff_t) <= RV_HANDOFF_ALIGN, "a handoff header must fit any ring tail");
+
+typedef struct rv_handoff_ring {
+    _Atomic uint32_t w;
+    uint8_t pad_w[60];    // producer and consumer indices on their own lines
+    _Atomic uint32_t r;
+    uint8_t pad_r[60];
+    uint8_t buf[RV_RELAY_SHARD_RING_BYTES];
+} rv_handoff_ring_t;
+
+static uint32_t handoff_size(int len) {
+    return ((uint32_t)sizeof(rv_handoff_t) + (uint32_t)len + RV_HANDOFF_ALIGN - 1) & ~(RV_HANDOFF_ALIGN - 1);
+}
+
+static int handoff_push(rv_handoff_ring_t* q, const rv_sockaddr_t* from, const uint8_t* data, int len,
+                        uint64_t rx_us) {
+    const uint32_t need = handoff_size(len);
+    uint32_t w = atomic_load_explicit(&q->w, memory_order_relaxed);
+    const uint32_t r = atomic_load_explicit(&q->r, memory_order_acquire);
+
+    uint32_t off = w & (RV_RELAY_SHARD_RING_BYTES - 1);
+    const uint32_t room = RV_RELAY_SHARD_RING_BYTES - off;
+    const uint32_t skip = room < need ? room : 0;
+    if (RV_RELAY_SHARD_RING_BYTES - (w - r) < skip + need) return 0; // full
+
+    rv_handoff_t h;
+    memset(&h, 0, sizeof(h));
+    if (skip) {
+        h.len = -1;
+        memcpy(q->buf + off, &h, sizeof(h));
+        w += skip;
+        off = 0;
+    }
+    h.from = *from;
+    h.len = len;
+    h.rx_us = rx_us;
+    memcpy(q->buf + off, &h, sizeof(h));
+    if (len > 0) memcpy(q->buf + off + sizeof(h), data, (size_t)len);
+
+    atomic_store_explicit(&q->w, w + need, memory_order_release);
+    return 1;
+}
+
+static int handoff_pending(rv_handoff_ring_t* q) {
+    return atomic_load_explicit(&q->w, memory_order_relaxed) !=
+           atomic_load_explicit(&q->r, memory_order_relaxed);
+}
+
+#endif // RV_RELAY_SHARDS_THREADED
+
+// ---- Shards ----
+
+typedef struct rv_relay_shard {
+    struct rv_relay_shards* group;
+    int index;
+    rv_udp_socket_t* sock;
+    rv_relay_io_t io;
+    int io_ready;
+    rv_relay_state_t state;        // sessions this shard owns
+    rv_relay_routes_t routes;      // endpoints arriving here -> owning shard
+    rv_relay_bundler_t bundler;    // used when state.bundler points here
+    rv_relay_mixer_t mixer;        // used when state.mixer points here
+    rv_relay_wheel_t idle_members; // idle timers of state and routes,
+    rv_relay_wheel_t idle_routes;  // when those point here
+    rv_timers_t timers;
+    uint64_t last_rx;              // rx_packets at the last stats line
+    uint64_t handoffs;             // packets passed to their owner
+    rv_relay_metrics_t metrics;    // state.metrics points here
+    rv_relay_bucket_t joins;       // new endpoints, at RV_RELAY_JOIN_RATE
+    uint64_t* voice_rx;            // receive times of the VOICE packets
+    uint32_t voice_count;          // handled since the last flush
+    uint32_t voice_cap;
+#if RV_RELAY_SHARDS_THREADED
+    rv_handoff_ring_t** inbox;     // [count]: written by shard i, NULL for self
+    uint64_t wake_mask;            // owners handed packets in this batch
+    _Atomic int sleeping;          // set before blocking with an empty inbox
+    int wake_fd;                   // eventfd that ends that wait
+    pthread_t thread;
+#endif
+} rv_relay_shard_t;
+
+struct rv_relay_shards {
+    rv_relay_shard_t* shards;
+    int count;
+    int use_uring;
+    int64_t bundle_window_us;      // < 0: forwards are not bundled
+    FILE* metrics_out;             // JSON lines, or NULL
+    uint64_t hash_seed;            // session_id -> owning shard
+#if RV_RELAY_SHARDS_THREADED
+    pthread_mutex_t lock;          // startup only
+    pthread_cond_t cond;
+    int opened, failed, go;
+#endif
+};
+
+int rv_relay_shards_supported(void) {
+    return RV_RELAY_SHARDS_THREADED;
+}
+
+// Housekeeping: one traffic line per period, skipped while idle
+static void print_stats(void* ctx, uint64_t now_us) {
+    rv_relay_shard_t* sh = (rv_relay_shard_t*)ctx;
+    const rv_relay_io_t* io = &sh->io;
+    (void)now_us;
+    if (io->rx_packets == sh->last_rx) return;
+    sh->last_rx = io->rx_packets;
+
+    if (sh->group->count == 1) {
+        printf("relay: rx=%llu tx=%llu dropped=%llu syscalls=%llu\n",
+               (unsigned long long)io->rx_packets, (unsigned long long)io->tx_packets,
+               (unsigned long long)io->tx_dropped, (unsigned long long)rv_relay_io_syscalls(io));
+    } else {
+        printf("relay[%d]: rx=%llu tx=%llu dropped=%llu handoffs=%llu lost=%llu syscalls=%llu\n",
+               sh->index, (unsigned long long)io->rx_packets, (unsigned long long)io->tx_packets,
+               (unsigned long long)io->tx_dropped, (unsigned long long)sh->handoffs,
+               (unsigned long long)sh->metrics.drops[RV_RELAY_DROP_HANDOFF],
+               (unsigned long long)rv_relay_io_syscalls(io));
+    }
+}
+
+static int json_array(char* out, size_t cap, const uint64_t* v, int n) {
+    size_t len = 0;
+    for (int i = 0; i < n && len < cap; ++i) {
+        const int w = snprintf(out + len, cap - len, "%s%llu", i ? "," : "", (unsigned long long)v[i]);
+        if (w < 0) return -1;
+        len += (size_t)w;
+    }
+    return len < cap ? (int)len : -1;
+}
+
+// One JSON object per shard and period; cumulative counters, so a
+// collector takes differences, and gauges for the tables
+static void write_metrics(void* ctx, uint64_t now_us) {
+    rv_relay_shard_t* sh = (rv_relay_shard_t*)ctx;
+    const rv_relay_io_t* io = &sh->io;
+    const rv_relay_metrics_t* m = &sh->metrics;
+    (void)now_us;
+
+    char fanout[256], latency[512];
+    if (json_array(fanout, sizeof(fanout), m->fanout, RV_RELAY_FANOUT_BUCKETS) < 0 ||
+        json_array(latency, sizeof(latency), m->latency, RV_RELAY_LATENCY_BUCKETS) < 0)
+        return;
+
+    char line[2048];
+    const int n = snprintf(line, sizeof(line),
+        "{\"time\":%lld,\"shard\":%d,\"sessions\":%u,\"clients\":%u,"
+        "\"rx_packets\":%llu,\"rx_bytes\":%llu,\"tx_packets\":%llu,\"tx_bytes\":%llu,"
+        "\"joins\":%llu,\"voice\":%llu,\"forwards\":%llu,\"mixed\":%llu,\"handoffs\":%llu,"
+        "\"bundles\":%llu,\"mix_packets\":%llu,\"syscalls\":%llu,"
+        "\"drops\":{\"malformed\":%llu,\"unjoined\":%llu,\"handoff\":%llu,\"last_n\":%llu,"
+        "\"rate\":%llu,\"spoofed\":%llu,\"join_rate\":%llu,\"peer\":%llu,\"loop\":%llu,\"send\":%llu},"
+        "\"fanout\":[%s],\"latency_us\":[%s]}\n",
+        (long long)time(NULL), sh->index, (unsigned)sh->state.session_count, (unsigned)sh->state.client_count,
+        (unsigned long long)io->rx_packets, (unsigned long long)io->rx_bytes,
+        (unsigned long long)io->tx_packets, (unsigned long long)io->tx_bytes,
+        (unsigned long long)m->joins, (unsigned long long)m->voice, (unsigned long long)m->forwards,
+        (unsigned long long)m->mixed, (unsigned long long)sh->handoffs,
+        (unsigned long long)sh->bundler.sent, (unsigned long long)sh->mixer.sent,
+        (unsigned long long)rv_relay_io_syscalls(io),
+        (unsigned long long)m->drops[RV_RELAY_DROP_MALFORMED], (unsigned long long)m->drops[RV_RELAY_DROP_UNJOINED],
+        (unsigned long long)m->drops[RV_RELAY_DROP_HANDOFF], (unsigned long long)m->drops[RV_RELAY_DROP_LAST_N],
+        (unsigned long long)m->drops[RV_RELAY_DROP_RATE], (unsigned long long)m->drops[RV_RELAY_DROP_SPOOFED],
+        (unsigned long long)m->drops[RV_RELAY_DROP_JOIN_RATE], (unsigned long long)m->drops[RV_RELAY_DROP_PEER],
+        (unsigned long long)m->drops[RV_RELAY_DROP_LOOP], (unsigned long long)io->tx_dropped, fanout, latency);
+    if (n <= 0 || (size_t)n >= sizeof(line)) return;
+
+    // One write per line: shards share the stream, and stdio locks per call
+    FILE* out = sh->group->metrics_out;
+    fputs(line, out);
+    fflush(out);
+}
+
+// Forwarding latency: from receipt to the sends being handed to the I/O
+// engine, for every VOICE packet handled since the last flush
+static void note_voice(rv_relay_shard_t* sh, uint64_t rx_us) {
+    if (sh->voice_count == sh->voice_cap) {
+        const uint32_t cap = sh->voice_cap ? sh->voice_cap * 2 : RV_RELAY_IO_BATCH;
+        uint64_t* grown = (uint64_t*)realloc(sh->voice_rx, cap * sizeof(*grown));
+        if (!grown) return;
+        sh->voice_rx = grown;
+        sh->voice_cap = cap;
+    }
+    sh->voice_rx[sh->voice_count++] = rx_us;
+}
+
+static void record_latency(rv_relay_shard_t* sh) {
+    if (sh->voice_count == 0) return;
+    const uint64_t now = rv_time_now_us();
+    for (uint32_t i = 0; i < sh->voice_count; ++i)
+        rv_relay_metrics_latency(&sh->metrics, now > sh->voice_rx[i] ? now - sh->voice_rx[i] : 0);
+    sh->voice_count = 0;
+}
+
+// What clients and peer relays send; anything else (ACKs, bundles) only
+// goes out
+static int inbound(const rv_pkt_view_t* pv) {
+    return pv->type == RV_PKT_JOIN || pv->type == RV_PKT_VOICE || pv->type == RV_PKT_REPORT ||
+           pv->type == RV_PKT_INTEREST || pv->type == RV_PKT_PEER;
+}
+
+// Endpoints that are new to the shard; keeps a JOIN flood from spoofed
+// addresses from growing the tables without bound
+static int admit_join(rv_relay_shard_t* sh) {
+    static const rv_relay_rate_t rate = { RV_RELAY_JOIN_RATE, 0 };
+    if (rv_relay_bucket_take(&sh->joins, &rate, 0, sh->state.now_us)) return 1;
+    sh->metrics.drops[RV_RELAY_DROP_JOIN_RATE]++;
+    return 0;
+}
+
+// Packets of sessions this shard owns (all of them with one shard)
+static void handle_owned(rv_relay_shard_t* sh, const rv_sockaddr_t* from, const uint8_t* buf, int r,
+                         uint64_t rx_us) {
+    rv_pkt_view_t pv;
+    if (rv_pkt_view_parse(buf, r, &pv) != 0 || !inbound(&pv)) {
+        sh->metrics.drops[RV_RELAY_DROP_MALFORMED]++;
+        return;
+    }
+
+    if (pv.type == RV_PKT_JOIN) {
+        uint64_t session_id = 0;
+        uint16_t player_id = 0;
+        uint16_t caps = 0;
+        if (rv_pkt_view_join(&pv, &session_id, &player_id, &caps) != 0) return;
+        if (caps & RV_CAP_PEER) {
+            rv_relay_peer_join(&sh->state, session_id, from, &sh->io, rv_relay_io_send);
+            return;
+        }
+        // Keepalives count up from 1 and only need a join if we lost the client
+        if (pv.seq != 0 && rv_relay_refresh(&sh->state, session_id, player_id, from) == 0) return;
+        // With more shards the arriving one admitted the endpoint; a known
+        // endpoint rejoining is not a new client either
+        if (sh->group->count == 1 && !rv_relay_joined(&sh->state, from) && !admit_join(sh)) return;
+        rv_relay_join(&sh->state, session_id, player_id, caps, from, &sh->io, rv_relay_io_send);
+    } else if (pv.type == RV_PKT_VOICE) {
+        rv_relay_forward_voice(&sh->state, from, &pv, buf, r, &sh->io, rv_relay_io_send);
+        note_voice(sh, rx_us);
+    } else if (pv.type == RV_PKT_REPORT) {
+        rv_report_t rep;
+        if (rv_pkt_view_report(&pv, &rep) == 0)
+            rv_relay_forward_to_player(&sh->state, from, pv.speaker_id, rep.target_id, buf, r, &sh->io,
+                                       rv_relay_io_send);
+    } else if (pv.type == RV_PKT_INTEREST) {
+        rv_interest_t in;
+        if (rv_pkt_view_interest(&pv, &in) == 0) rv_relay_set_interest(&sh->state, from, &in);
+    } else if (pv.type == RV_PKT_PEER) {
+        rv_relay_forward_peer(&sh->state, from, &pv, &sh->io, rv_relay_io_send);
+        note_voice(sh, rx_us);
+    }
+}
+
+#if RV_RELAY_SHARDS_THREADED
+
+static uint32_t shard_of(const rv_relay_shards_t* g, uint64_t session_id) {
+    uint64_t x = session_id ^ g->hash_seed;
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return (uint32_t)(x % (uint64_t)g->count);
+}
+
+static void hand_off(rv_relay_shard_t* sh, uint32_t owner, const rv_sockaddr_t* from,
+                     const uint8_t* data, int len) {
+    rv_relay_shard_t* dst = &sh->group->shards[owner];
+    if (!handoff_push(dst->inbox[sh->index], from, data, len, sh->state.now_us)) {
+        sh->metrics.drops[RV_RELAY_DROP_HANDOFF]++;
+        return;
+    }
+    sh->handoffs++;
+    sh->wake_mask |= (uint64_t)1 << owner;
+}
+
+// Wake the owners that went to sleep before their handoffs arrived; pairs
+// with the fence in shard_loop
+static void wake_owners(rv_relay_shard_t* sh) {
+    if (!sh->wake_mask) return;
+    atomic_thread_fence(memory_order_seq_cst);
+    for (int i = 0; i < sh->group->count; ++i) {
+        if (!((sh->wake_mask >> i) & 1)) continue;
+        rv_relay_shard_t* dst = &sh->group->shards[i];
+        if (atomic_load_explicit(&dst->sleeping, memory_order_relaxed) &&
+            atomic_exchange_explicit(&dst->sleeping, 0, memory_order_relaxed)) {
+            const uint64_t one = 1;
+            const ssize_t w = write(dst->wake_fd, &one, sizeof(one));
+            (void)w;
+        }
+    }
+    sh->wake_mask = 0;
+}
+
+static int inbox_pending(rv_relay_shard_t* sh) {
+    for (int i = 0; i < sh->group->count; ++i) {
+        if (sh->inbox[i] && handoff_pending(sh->inbox[i])) return 1;
+    }
+    return 0;
+}
+
+static int drain_inbox(rv_relay_shard_t* sh) {
+    int n = 0;
+    for (int i = 0; i < sh->group->count; ++i) {
+        rv_handoff_ring_t* q = sh->inbox[i];
+        if (!q) continue;
+
+        uint32_t r = atomic_load_explicit(&q->r, memory_order_relaxed);
+        const uint32_t w = atomic_load_explicit(&q->w, memory_order_acquire);
+        while (r != w) {
+            const uint32_t off = r & (RV_RELAY_SHARD_RING_BYTES - 1);
+            rv_handoff_t h;
+            memcpy(&h, q->buf + off, sizeof(h));
+            if (h.len < 0) {
+                r += RV_RELAY_SHARD_RING_BYTES - off;
+                continue;
+            }
+            // Sends copy what they queue, so the record can go right after
+            if (h.len == 0) rv_relay_leave(&sh->state, &h.from, &sh->io, rv_relay_io_send);
+            else handle_owned(sh, &h.from, q->buf + off + sizeof(h), h.len, h.rx_us);
+            r += handoff_size(h.len);
+            n++;
+        }
+        atomic_store_explicit(&q->r, r, memory_order_release);
+    }
+    return n;
+}
+
+#endif // RV_RELAY_SHARDS_THREADED
+
+static void route_packet(rv_relay_shard_t* sh, const rv_udp_msg_t* m) {
+    if (sh->group->count == 1) {
+        handle_owned(sh, &m->addr, m->data, m->len, sh->state.now_us);
+        return;
+    }
+#if RV_RELAY_SHARDS_THREADED
+    rv_pkt_view_t pv;
+    if (rv_pkt_view_parse(m->data, m->len, &pv) != 0 || !inbound(&pv)) {
+        sh->metrics.drops[RV_RELAY_DROP_MALFORMED]++;
+        return;
+    }
+
+    // Floods are stopped here, before they take room in the owner's ring
+    uint32_t owner = 0;
+    rv_relay_route_t* route = rv_relay_routes_get(&sh->routes, &m->addr, sh->state.now_us);
+    if (pv.type == RV_PKT_JOIN) {
+        uint64_t session_id = 0;
+        uint16_t player_id = 0;
+        uint16_t caps = 0;
+        if (rv_pkt_view_join(&pv, &session_id, &player_id, &caps) != 0) {
+            sh->metrics.drops[RV_RELAY_DROP_MALFORMED]++;
+            return;
+        }
+        owner = shard_of(sh->group, session_id);
+
+        // A peer relay joins many sessions from one address, so it gets no
+        // route; its owners check it against the allowed addresses
+        if (!(caps & RV_CAP_PEER)) {
+            if (!route && !admit_join(sh)) return;
+
+            // Moving to a session on another shard: leave the old one there
+            const uint32_t prev = route ? route->value - 1 : owner;
+            if (prev != owner) {
+                if (prev == (uint32_t)sh->index) rv_relay_leave(&sh->state, &m->addr, &sh->io, rv_relay_io_send);
+                else hand_off(sh, prev, &m->addr, NULL, 0);
+            }
+            if (rv_relay_routes_set(&sh->routes, &m->addr, owner, sh->state.now_us) != 0) return;
+        }
+    } else if (pv.type == RV_PKT_PEER) {
+        // Peers have no route: the wrapper names the session
+        uint64_t session_id = 0;
+        const uint8_t* inner = NULL;
+        uint16_t inner_len = 0;
+        if (rv_pkt_view_peer(&pv, &session_id, &inner, &inner_len) != 0) {
+            sh->metrics.drops[RV_RELAY_DROP_MALFORMED]++;
+            return;
+        }
+        owner = shard_of(sh->group, session_id);
+    } else if (!route) {
+        sh->metrics.drops[RV_RELAY_DROP_UNJOINED]++;   // never joined
+        return;
+    } else {
+        owner = route->value - 1;
+        const rv_relay_rate_t* rate = &sh->routes.rate;
+        if (pv.type == RV_PKT_VOICE && (rate->pps || rate->bytes) &&
+            !rv_relay_bucket_take(&route->bucket, rate, m->len, sh->state.now_us)) {
+            sh->metrics.drops[RV_RELAY_DROP_RATE]++;
+            return;
+        }
+    }
+
+    if (owner == (uint32_t)sh->index) handle_owned(sh, &m->addr, m->data, m->len, sh->state.now_us);
+    else hand_off(sh, owner, &m->addr, m->data, m->len);
+#endif
+}
+
+static void shard_loop(rv_relay_shard_t* sh) {
+#if RV_RELAY_SHARDS_THREADED
+    int idle = 1;
+#endif
+    for (;;) {
+        int timeout = rv_timers_wait_ms(&sh->timers, rv_time_now_us());
+#if RV_RELAY_SHARDS_THREADED
+        if (sh->inbox) {
+            // Busy shards only poll; producers wake a shard that is about
+            // to block, and it re-checks the inbox after saying so
+            if (!idle) {
+                timeout = 0;
+            } else {
+                atomic_store_explicit(&sh->sleeping, 1, memory_order_relaxed);
+                atomic_thread_fence(memory_order_seq_cst);
+                if (inbox_pending(sh)) timeout = 0;
+            }
+        }
+#endif
+        const int64_t window = sh->group->bundle_window_us;
+        if (rv_relay_bundler_pending(&sh->bundler)) {
+            const int64_t left = (int64_t)(sh->bundler.opened_us + (uint64_t)window) - (int64_t)rv_time_now_us();
+            const int ms = left > 0 ? (int)((left + 999) / 1000) : 0;
+            if (timeout < 0 || ms < timeout) timeout = ms;
+        }
+        const int n = rv_relay_io_recv(&sh->io, timeout);
+        sh->state.now_us = rv_time_now_us();
+
+        int handed = 0;
+#if RV_RELAY_SHARDS_THREADED
+        if (sh->inbox) {
+            atomic_store_explicit(&sh->sleeping, 0, memory_order_relaxed);
+            if (sh->io.woken) {
+                uint64_t v;
+                const ssize_t r = read(sh->wake_fd, &v, sizeof(v));
+                (void)r;
+                sh->io.woken = 0;
+            }
+        }
+#endif
+        for (int i = 0; i < n; ++i)
+            route_packet(sh, &sh->io.rx[i]);
+
+#if RV_RELAY_SHARDS_THREADED
+        if (sh->inbox) {
+            wake_owners(sh);
+            handed = drain_inbox(sh);
+        }
+#endif
+        // Bundles go out once the oldest has waited its window
+        int bundled = 0;
+        if (rv_relay_bundler_pending(&sh->bundler) &&
+            sh->state.now_us >= sh->bundler.opened_us + (uint64_t)window) {
+            rv_relay_bundler_flush(&sh->bundler, &sh->io, rv_relay_io_send);
+            bundled = 1;
+        }
+        // Forwards only reference the receive pool; send them before it is reused
+        if (n > 0 || handed > 0 || bundled) rv_relay_io_flush(&sh->io);
+        record_latency(sh);
+#if RV_RELAY_SHARDS_THREADED
+        idle = n <= 0 && handed == 0;
+#endif
+
+        rv_timers_run(&sh->timers, rv_time_now_us());
+    }
+}
+
+// One frame of every session this shard mixes, sent right away rather
+// than with the next batch of forwards
+static void mix_frame(void* ctx, uint64_t now_us) {
+    rv_relay_shard_t* sh = (rv_relay_shard_t*)ctx;
+    (void)now_us;
+    if (sh->mixer.count == 0) return;
+    rv_relay_mix_tick(&sh->mixer, &sh->state, &sh->io, rv_relay_io_send);
+    rv_relay_io_flush(&sh->io);
+}
+
+// Members that went quiet leave their sessions, and endpoints that stopped
+// arriving here lose their routes
+static void expire_idle(void* ctx, uint64_t now_us) {
+    rv_relay_shard_t* sh = (rv_relay_shard_t*)ctx;
+    rv_relay_expire(&sh->state, now_us, &sh->io, rv_relay_io_send);
+    rv_relay_routes_expire(&sh->routes, now_us);
+    rv_relay_io_flush(&sh->io);
+}
+
+// Keepalives to the upstream, and peers that stopped sending leave
+static void peers_tick(void* ctx, uint64_t now_us) {
+    rv_relay_shard_t* sh = (rv_relay_shard_t*)ctx;
+    (void)now_us;
+    rv_relay_peers_tick(&sh->state, &sh->io, rv_relay_io_send);
+    rv_relay_io_flush(&sh->io);
+}
+
+// Runs on the shard's own thread: the io_uring engine belongs to the
+// thread that sets it up
+static int shard_open(rv_relay_shard_t* sh) {
+    if (rv_relay_io_init(&sh->io, sh->sock, sh->group->use_uring) != 0) return -1;
+    sh->io_ready = 1;
+#if RV_RELAY_SHARDS_THREADED
+    if (sh->inbox && rv_relay_io_watch(&sh->io, sh->wake_fd) != 0) return -2;
+#endif
+    // Metrics on stdout carry the same counters, and text lines would break them
+    if (sh->group->metrics_out != stdout)
+        rv_timers_add(&sh->timers, rv_time_now_us(), RV_RELAY_STATS_PERIOD_MS, print_stats, sh);
+    if (sh->state.mixer && rv_timers_add(&sh->timers, rv_time_now_us(), RV_RELAY_MIX_FRAME_MS, mix_frame, sh) < 0)
+        return -3;
+    if (sh->group->metrics_out &&
+        rv_timers_add(&sh->timers, rv_time_now_us(), RV_RELAY_METRICS_PERIOD_MS, write_metrics, sh) < 0)
+        return -3;
+    if (sh->state.idle && rv_timers_add(&sh->timers, rv_time_now_us(), RV_RELAY_IDLE_TICK_MS, expire_idle, sh) < 0)
+        return -3;
+    if ((sh->state.has_upstream || sh->state.peer_allow_count) &&
+        rv_timers_add(&sh->timers, rv_time_now_us(), RV_RELAY_PEER_KEEPALIVE_MS, peers_tick, sh) < 0)
+        return -3;
+    return 0;
+}
+
+#if RV_RELAY_SHARDS_THREADED
+static void* shard_thread(void* arg) {
+    rv_relay_shard_t* sh = (rv_relay_shard_t*)arg;
+    rv_relay_shards_t* g = sh->group;
+    const int r = shard_open(sh);
+
+    pthread_mutex_lock(&g->lock);
+    g->opened++;
+    if (r != 0) g->failed++;
+    pthread_cond_broadcast(&g->cond);
+    while (g->go == 0) pthread_cond_wait(&g->cond, &g->lock);
+    const int go = g->go;
+    pthread_mutex_unlock(&g->lock);
+
+    if (go > 0) shard_loop(sh);
+    return NULL;
+}
+#endif
+
+rv_relay_shards_t* rv_relay_shards_create(rv_udp_socket_t** socks, int count, int use_uring) {
+    if (!socks || count < 1) return NULL;
+
+    rv_relay_shards_t* g = NULL;
+    if (count <= RV_RELAY_MAX_SHARDS && (count == 1 || rv_relay_shards_supported()))
+        g = (rv_relay_shards_t*)calloc(1, sizeof(*g));
+    if (g) g->shards = (rv_relay_shard_t*)calloc((size_t)count, sizeof(rv_relay_shard_t));
+    if (!g || !g->shards) {
+        free(g);
+        for (int i = 0; i < count; ++i) rv_udp_destroy(socks[i]);
+        return NULL;
+    }
+
+    g->count = count;
+    g->use_uring = use_uring;
+    g->bundle_window_us = -1;
+    g->hash_seed = (uint64_t)time(NULL) * 0x9e3779b97f4a7c15ull ^ (uint64_t)(uintptr_t)g;
+#if RV_RELAY_SHARDS_THREADED
+    pthread_mutex_init(&g->lock, NULL);
+    pthread_cond_init(&g->cond, NULL);
+#endif
+
+    int ok = 1;
+    for (int i = 0; i < count; ++i) {
+        rv_relay_shard_t* sh = &g->shards[i];
+        sh->group = g;
+        sh->index = i;
+        sh->sock = socks[i];
+        rv_relay_init(&sh->state);
+        rv_relay_routes_init(&sh->routes);
+        rv_relay_bundler_init(&sh->bundler);
+        rv_relay_mixer_init(&sh->mixer, 0);
+        rv_relay_wheel_init(&sh->idle_members, RV_RELAY_IDLE_TICK_MS, rv_time_now_us());
+        rv_relay_wheel_init(&sh->idle_routes, RV_RELAY_IDLE_TICK_MS, rv_time_now_us());
+        sh->state.metrics = &sh->metrics;
+        rv_timers_init(&sh->timers);
+#if RV_RELAY_SHARDS_THREADED
+        sh->wake_fd = -1;
+        if (count == 1) continue;
+        sh->inbox = (rv_handoff_ring_t**)calloc((size_t)count, sizeof(rv_handoff_ring_t*));
+        sh->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (!sh->inbox || sh->wake_fd < 0) {
+            ok = 0;
+            continue;
+        }
+        for (int s = 0; s < count; ++s) {
+            if (s == i) continue;
+            sh->inbox[s] = (rv_handoff_ring_t*)calloc(1, sizeof(rv_handoff_ring_t));
+            if (!sh->inbox[s]) ok = 0;
+        }
+#endif
+    }
+
+    if (!ok) {
+        rv_relay_shards_destroy(g);
+        return NULL;
+    }
+    rv_relay_shards_set_idle(g, RV_RELAY_IDLE_MS);
+    rv_relay_shards_set_rate(g, RV_RELAY_RATE_PPS, RV_RELAY_RATE_BYTES);
+    return g;
+}
+
+void rv_relay_shards_destroy(rv_relay_shards_t* g) {
+    if (!g) return;
+    for (int i = 0; i < g->count; ++i) {
+        rv_relay_shard_t* sh = &g->shards[i];
+        if (sh->io_ready) rv_relay_io_free(&sh->io);
+        rv_relay_free(&sh->state);
+        rv_relay_mixer_free(&sh->mixer);
+        rv_relay_routes_free(&sh->routes);
+        rv_relay_wheel_free(&sh->idle_members);
+        rv_relay_wheel_free(&sh->idle_routes);
+        free(sh->voice_rx);
+        rv_relay_bundler_free(&sh->bundler);
+        rv_udp_destroy(sh->sock);
+#if RV_RELAY_SHARDS_THREADED
+        if (sh->inbox) {
+            for (int s = 0; s < g->count; ++s) free(sh->inbox[s]);
+            free(sh->inbox);
+        }
+        if (sh->wake_fd >= 0) close(sh->wake_fd);
+#endif
+    }
+#if RV_RELAY_SHARDS_THREADED
+    pthread_mutex_destroy(&g->lock);
+    pthread_cond_destroy(&g->cond);
+#endif
+    free(g->shards);
+    free(g);
+}
+
+int rv_relay_shards_start(rv_relay_shards_t* g) {
+    if (!g) return -1;
+#if RV_RELAY_SHARDS_THREADED
+    int spawned = 1;
+    for (; spawned < g->count; ++spawned) {
+        rv_relay_shard_t* sh = &g->shards[spawned];
+        if (pthread_create(&sh->thread, NULL, shard_thread, sh) != 0) break;
+    }
+    const int r0 = shard_open(&g->shards[0]);
+
+    pthread_mutex_lock(&g->lock);
+    while (g->opened < spawned - 1) pthread_cond_wait(&g->cond, &g->lock);
+    const int ok = r0 == 0 && g->failed == 0 && spawned == g->count;
+    g->go = ok ? 1 : -1;
+    pthread_cond_broadcast(&g->cond);
+    pthread_mutex_unlock(&g->lock);
+
+    if (!ok) {
+        for (int i = 1; i < spawned; ++i) pthread_join(g->shards[i].thread, NULL);
+        return -2;
+    }
+    return 0;
+#else
+    return shard_open(&g->shards[0]) == 0 ? 0 : -2;
+#endif
+}
+
+void rv_relay_shards_run(rv_relay_shards_t* g) {
+    shard_loop(&g->shards[0]);
+}
+
+void rv_relay_shards_set_last_n(rv_relay_shards_t* g, uint32_t n) {
+    if (!g) return;
+    for (int i = 0; i < g->count; ++i) g->shards[i].state.last_n = n;
+}
+
+void rv_relay_shards_set_bundle(rv_relay_shards_t* g, int window_ms) {
+    if (!g) return;
+    g->bundle_window_us = window_ms < 0 ? -1 : (int64_t)window_ms * 1000;
+    for (int i = 0; i < g->count; ++i)
+        g->shards[i].state.bundler = window_ms < 0 ? NULL : &g->shards[i].bundler;
+}
+
+void rv_relay_shards_set_metrics(rv_relay_shards_t* g, FILE* out) {
+    if (g) g->metrics_out = out;
+}
+
+void rv_relay_shards_set_idle(rv_relay_shards_t* g, uint32_t idle_ms) {
+    if (!g) return;
+    for (int i = 0; i < g->count; ++i) {
+        rv_relay_shard_t* sh = &g->shards[i];
+        sh->state.idle = idle_ms ? &sh->idle_members : NULL;
+        sh->state.idle_us = (uint64_t)idle_ms * 1000u;
+        sh->routes.idle = idle_ms ? &sh->idle_routes : NULL;
+        sh->routes.idle_us = (uint64_t)idle_ms * 1000u;
+    }
+}
+
+void rv_relay_shards_set_rate(rv_relay_shards_t* g, uint32_t pps, uint32_t bytes) {
+    if (!g) return;
+    const rv_relay_rate_t rate = { pps, bytes };
+    const rv_relay_rate_t none = { 0, 0 };
+    // Checked once per packet: by the route on the arriving shard when
+    // there is one, so the owner does not check again
+    for (int i = 0; i < g->count; ++i) {
+        g->shards[i].state.rate = g->count == 1 ? rate : none;
+        g->shards[i].routes.rate = g->count == 1 ? none : rate;
+    }
+}
+
+void rv_relay_shards_set_upstream(rv_relay_shards_t* g, const rv_sockaddr_t* upstream) {
+    if (!g) return;
+    for (int i = 0; i < g->count; ++i) rv_relay_set_upstream(&g->shards[i].state, upstream);
+}
+
+int rv_relay_shards_allow_peer(rv_relay_shards_t* g, const rv_sockaddr_t* addr) {
+    if (!g) return -1;
+    for (int i = 0; i < g->count; ++i) {
+        if (rv_relay_allow_peer(&g->shards[i].state, addr) != 0) return -1;
+    }
+    return 0;
+}
+
+int rv_relay_shards_set_mix(rv_relay_shards_t* g, uint32_t min_members) {
+    if (!g) return -1;
+    if (!rv_relay_mix_supported()) return -2;
+    for (int i = 0; i < g->count; ++i) {
+        rv_relay_shard_t* sh = &g->shards[i];
+        rv_relay_mixer_init(&sh->mixer, min_members);
+        sh->state.mixer = &sh->mixer;
+    }
+    return 0;
+}
+
+int rv_relay_shards_count(const rv_relay_shards_t* g) {
+    return g ? g->count : 0;
+}
+
+const char* rv_relay_shards_backend(const rv_relay_shards_t* g) {
+    return rv_relay_io_backend(g ? &g->shards[0].io : NULL);
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include "rv_udp.h"
+
+/*
+ * Relay event loops, one per shard.
+ *
+ * Each shard owns a socket bound to the relay port with SO_REUSEPORT, an
+ * rv_relay_io and an rv_relay_state_t, and runs on its own thread, so the
+ * packet path takes no locks. The kernel picks the socket by a hash of the
+ * sender's address, while sessions are pinned to shards by session_id. A
+ * packet that arrives on a shard other than its session's owner is handed
+ * over through a single-producer ring (one per pair of shards), and the
+ * owner sends the forwards and JOIN_ACKs from its own socket. All sockets
+ * share the local port, so clients see one relay address either way.
+ *
+ * The arriving shard learns an endpoint's owner from its JOIN. Only that
+ * shard ever receives from the endpoint, so its route table is private.
+ * With one shard this is the plain single-threaded loop.
+ */
+
+#ifndef RV_RELAY_MAX_SHARDS
+#define RV_RELAY_MAX_SHARDS 64
+#endif
+
+#ifndef RV_RELAY_SHARD_RING_BYTES
+#define RV_RELAY_SHARD_RING_BYTES (64 * 1024)   // per pair of shards, power of two
+#endif
+
+typedef struct rv_relay_shards rv_relay_shards_t;
+
+// One shard per socket; more than one needs rv_relay_shards_supported()
+// and sockets from rv_udp_create_reuseport. Takes ownership of the
+// sockets, also when it fails.
+rv_relay_shards_t* rv_relay_shards_create(rv_udp_socket_t** socks, int count, int use_uring);
+// Not while shards are running (after a successful start)
+void rv_relay_shards_destroy(rv_relay_shards_t* g);
+
+// Forward at most n speakers per session (0 = all, the default); before start
+void rv_relay_shards_set_last_n(rv_relay_shards_t* g, uint32_t n);
+// Bundle forwards to clients that take RV_PKT_BUNDLE, holding each for at
+// most window_ms (0 = one receive batch, < 0 = off, the default); before start
+void rv_relay_shards_set_bundle(rv_relay_shards_t* g, int window_ms);
+
+// Drop members and routes that send nothing for idle_ms (0 = never; the
+// default is RV_RELAY_IDLE_MS); before start
+void rv_relay_shards_set_idle(rv_relay_shards_t* g, uint32_t idle_ms);
+
+// Forward at most pps VOICE packets and bytes of them per second from
+// each endpoint, with bursts of RV_RELAY_RATE_BURST_MS (0 = unlimited; the
+// defaults are RV_RELAY_RATE_PPS and RV_RELAY_RATE_BYTES); before start
+void rv_relay_shards_set_rate(rv_relay_shards_t* g, uint32_t pps, uint32_t bytes);
+
+// Join every session at the relay at upstream as well, so clients of
+// both share it (NULL = none, the default); before start
+void rv_relay_shards_set_upstream(rv_relay_shards_t* g, const rv_sockaddr_t* upstream);
+// Let relays at addr's IP address (any port) join sessions as peers, up to
+// RV_RELAY_MAX_PEER_ADDRS; before start
+int  rv_relay_shards_allow_peer(rv_relay_shards_t* g, const rv_sockaddr_t* addr);
+
+// Every shard appends a JSON line of its counters (see rv_relay_metrics.h)
+// to out every RV_RELAY_METRICS_PERIOD_MS (NULL = off, the default); out
+// stays the caller's. Before start.
+void rv_relay_shards_set_metrics(rv_relay_shards_t* g, FILE* out);
+
+// Mix sessions of at least min_members clients (see rv_relay_mix.h); before
+// start. Fails when the relay was built without RV_RELAY_MIX.
+int  rv_relay_shards_set_mix(rv_relay_shards_t* g, uint32_t min_members);
+
+// Set up every shard's I/O on the thread that will run it, shard 0 on the
+// calling one. Returns 0 when all are ready; the other shards are running
+// from then on.
+int  rv_relay_shards_start(rv_relay_shards_t* g);
+
+// Run shard 0 on the calling thread; does not return.
+void rv_relay_shards_run(rv_relay_shards_t* g);
+
+int  rv_relay_shards_count(const rv_relay_shards_t* g);
+const char* rv_relay_shards_backend(const rv_relay_shards_t* g);
+
+// Whether this build can run more than one shard (threads, SO_REUSEPORT)
+int  rv_relay_shards_supported(void);
@@ -0,0 +1,603 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE       // syscall()
+#endif
+#include "rv_relay_uring.h"
+#include "rv_relay_io.h"
+
+#include <linux/io_uring.h>
+
+// Multishot recvmsg (6.0) implies provided buffer rings (5.19) and CQE
+// skipping (5.17)
+#ifdef IORING_RECV_MULTISHOT
+
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RV_URING_SQ_ENTRIES 4096
+#define RV_URING_CQ_ENTRIES 16384
+#define RV_URING_SENDS      4096     // SENDMSGs in flight
+#define RV_URING_BUFS       512      // receive buffers, power of two
+#define RV_URING_BUF_SIZE   2048     // recvmsg_out + address + datagram
+#define RV_URING_COPIES     1024     // relay-built packets in flight, one per send
+#define RV_URING_BGID       1
+
+#define RV_UD_RECV    (~(uint64_t)0)
+#define RV_UD_WAKE    (~(uint64_t)1)
+#define RV_UD_NONTAIL ((uint64_t)1 << 32)   // link inside a chain, not its tail
+
+#ifndef IORING_SETUP_SUBMIT_ALL
+#define IORING_SETUP_SUBMIT_ALL 0
+#endif
+#ifndef IORING_SETUP_COOP_TASKRUN
+#define IORING_SETUP_COOP_TASKRUN 0
+#endif
+#ifndef IORING_SETUP_SINGLE_ISSUER
+#define IORING_SETUP_SINGLE_ISSUER 0
+#endif
+
+typedef struct rv_uring_send {
+    struct msghdr mh;
+    struct iovec iov;
+    struct sockaddr_storage ss;
+    int next;          // next link of the chain, or next free entry
+    int head;          // tail only: first link of the chain
+    int buf;           // tail only: receive buffer the chain reads, or -1
+    int copy;          // tail only: copy slot the chain reads, or -1
+} rv_uring_send_t;
+
+typedef struct rv_uring_rx {
+    int32_t res;
+    uint32_t flags;
+} rv_uring_rx_t;
+
+struct rv_relay_uring {
+    rv_udp_socket_t* sock;
+    int sock_fd;
+    int ring_fd;
+
+    void* ring;                // SQ and CQ rings (single mmap)
+    size_t ring_size;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sq_local;         // tail including SQEs not yet published
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    struct io_uring_cqe* cqes;
+    unsigned cq_mask;
+
+    // Provided buffers: a buffer is in the ring, or held by the current
+    // receive batch and/or by send chains (refs counts the holders).
+    struct io_uring_buf_ring* br;
+    size_t br_size;
+    uint8_t* bufs;
+    uint16_t br_tail;
+    int bufs_free;
+    uint16_t refs[RV_URING_BUFS];
+    int rx_bid[RV_RELAY_IO_BATCH];
+    int rx_count;
+
+    // Receive completions not yet handed out (each holds a buffer)
+    rv_uring_rx_t stash[RV_URING_BUFS];
+    unsigned stash_head, stash_tail;
+
+    struct msghdr recv_msg;
+    int recv_armed;
+
+    int wake_fd;               // watched by a multishot poll, or -1
+    int wake_armed;
+    int woken;
+
+    rv_uring_send_t* sends;
+    int send_free;
+    uint8_t* copies;
+    int copy_free[RV_URING_COPIES];
+    int copy_free_n;
+
+    // Chain being built (tail SQE not yet submitted)
+    int chain_head, chain_tail;
+    const uint8_t* chain_data;
+    int chain_len;
+    int chain_buf, chain_copy;
+    struct io_uring_sqe* chain_sqe;
+
+    uint64_t tx_failed;
+    uint64_t enters;
+};
+
+static int sys_setup(unsigned entries, struct io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+                     const struct io_uring_getevents_arg* arg) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg,
+                        arg ? sizeof(*arg) : 0);
+}
+
+static int sys_register(int fd, unsigned op, void* arg, unsigned nr) {
+    return (int)syscall(__NR_io_uring_register, fd, op, arg, nr);
+}
+
+static unsigned sq_pending(const rv_relay_uring_t* u) {
+    return u->sq_local - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+}
+
+static struct io_uring_sqe* get_sqe(rv_relay_uring_t* u) {
+    if (sq_pending(u) >= u->sq_entries) return NULL;
+    const unsigned idx = u->sq_local & u->sq_mask;
+    u->sq_array[idx] = idx;
+    u->sq_local++;
+    struct io_uring_sqe* sqe = &u->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+static void buf_push(rv_relay_uring_t* u, int bid) {
+    struct io_uring_buf* b = &u->br->bufs[u->br_tail & (RV_URING_BUFS - 1)];
+    b->addr = (uint64_t)(uintptr_t)(u->bufs + (size_t)bid * RV_URING_BUF_SIZE);
+    b->len = RV_URING_BUF_SIZE;
+    b->bid = (uint16_t)bid;
+    u->br_tail++;
+    __atomic_store_n(&u->br->tail, u->br_tail, __ATOMIC_RELEASE);
+    u->bufs_free++;
+}
+
+static void buf_unref(rv_relay_uring_t* u, int bid) {
+    if (--u->refs[bid] == 0) buf_push(u, bid);
+}
+
+static int buf_of(const rv_relay_uring_t* u, const uint8_t* p, int len) {
+    const uint8_t* end = u->bufs + (size_t)RV_URING_BUFS * RV_URING_BUF_SIZE;
+    if (p < u->bufs || p + len > end) return -1;
+    return (int)((size_t)(p - u->bufs) / RV_URING_BUF_SIZE);
+}
+
+static int arm_recv(rv_relay_uring_t* u) {
+    struct io_uring_sqe* sqe = get_sqe(u);
+    if (!sqe) return -1;
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = u->sock_fd;
+    sqe->addr = (uint64_t)(uintptr_t)&u->recv_msg;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RV_URING_BGID;
+    sqe->user_data = RV_UD_RECV;
+    u->recv_armed = 1;
+    return 0;
+}
+
+static int arm_wake(rv_relay_uring_t* u) {
+    struct io_uring_sqe* sqe = get_sqe(u);
+    if (!sqe) return -1;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = u->wake_fd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = RV_UD_WAKE;
+    u->wake_armed = 1;
+    return 0;
+}
+
+// The tail's completion is the last one the chain posts, so it carries
+// everything needed to release the chain.
+static void close_chain(rv_relay_uring_t* u) {
+    if (u->chain_tail < 0) return;
+    rv_uring_send_t* t = &u->sends[u->chain_tail];
+    t->head = u->chain_head;
+    t->buf = u->chain_buf;
+    t->copy = u->chain_copy;
+    u->chain_head = -1;
+    u->chain_tail = -1;
+    u->chain_sqe = NULL;
+    u->chain_data = NULL;
+}
+
+// Submit and wait for min_complete completions, or until timeout_ms
+// passes when min_complete > 0 and timeout_ms >= 0.
+static int ring_enter(rv_relay_uring_t* u, unsigned min_complete, int timeout_ms) {
+    close_chain(u);
+    __atomic_store_n(u->sq_tail, u->sq_local, __ATOMIC_RELEASE);
+
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    unsigned flags = IORING_ENTER_GETEVENTS;
+    const struct io_uring_getevents_arg* argp = NULL;
+    if (min_complete > 0 && timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000LL;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        argp = &arg;
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+
+    for (;;) {
+        u->enters++;
+        const int r = sys_enter(u->ring_fd, sq_pending(u), min_complete, flags, argp);
+        if (r >= 0) return 0;
+        if (errno == ETIME || errno == EINTR) return 0;    // the caller re-checks its timers
+        if (errno == EAGAIN || errno == EBUSY) return 0;   // completions pending: reap first
+        return -1;
+    }
+}
+
+static void on_send_done(rv_relay_uring_t* u, uint64_t user_data, int32_t res) {
+    if (res < 0) u->tx_failed++;
+    if (user_data & RV_UD_NONTAIL) return;   // reported a failure; the tail follows
+
+    const int tail = (int)(uint32_t)user_data;
+    rv_uring_send_t* t = &u->sends[tail];
+    if (t->buf >= 0) buf_unref(u, t->buf);
+    if (t->copy >= 0) u->copy_free[u->copy_free_n++] = t->copy;
+
+    int i = t->head;
+    while (i >= 0) {
+        const int next = i == tail ? -1 : u->sends[i].next;
+        u->sends[i].next = u->send_free;
+        u->send_free = i;
+        i = next;
+    }
+}
+
+static void reap(rv_relay_uring_t* u) {
+    unsigned head = *u->cq_head;
+    const unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        const struct io_uring_cqe* c = &u->cqes[head & u->cq_mask];
+        if (c->user_data == RV_UD_WAKE) {
+            if (!(c->flags & IORING_CQE_F_MORE)) u->wake_armed = 0;
+            if (c->res > 0) u->woken = 1;
+            continue;
+        }
+        if (c->user_data != RV_UD_RECV) {
+            on_send_done(u, c->user_data, c->res);
+            continue;
+        }
+        if (!(c->flags & IORING_CQE_F_MORE)) u->recv_armed = 0;
+        if (c->flags & IORING_CQE_F_BUFFER) {
+            rv_uring_rx_t* s = &u->stash[u->stash_tail++ & (RV_URING_BUFS - 1)];
+            s->res = c->res;
+            s->flags = c->flags;
+            u->bufs_free--;
+        }
+    }
+    __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+}
+
+static void unstash(rv_relay_uring_t* u, rv_udp_msg_t* m) {
+    const rv_uring_rx_t* s = &u->stash[u->stash_head++ & (RV_URING_BUFS - 1)];
+    const int bid = (int)(s->flags >> IORING_CQE_BUFFER_SHIFT);
+    uint8_t* b = u->bufs + (size_t)bid * RV_URING_BUF_SIZE;
+
+    struct io_uring_recvmsg_out out;
+    memcpy(&out, b, sizeof(out));
+    const uint8_t* name = b + sizeof(out);
+
+    u->refs[bid] = 1;
+    u->rx_bid[u->rx_count++] = bid;
+
+    m->data = b + sizeof(out) + u->recv_msg.msg_namelen + u->recv_msg.msg_controllen;
+    m->len = (out.flags & MSG_TRUNC) ? 0 : (int)out.payloadlen;
+    m->cap = m->len;
+
+    struct sockaddr_storage ss;
+    memset(&ss, 0, sizeof(ss));
+    const unsigned namelen = out.namelen < u->recv_msg.msg_namelen ? out.namelen : u->recv_msg.msg_namelen;
+    memcpy(&ss, name, namelen);
+    if (rv_udp_addr_from_native(&ss, &m->addr) != 0) m->len = 0;
+}
+
+// Make room for one more send: submit what is queued and take whatever
+// completions have arrived.
+static void reclaim(rv_relay_uring_t* u) {
+    (void)ring_enter(u, 0, 0);
+    reap(u);
+}
+
+void rv_relay_uring_destroy(rv_relay_uring_t* u) {
+    if (!u) return;
+    if (u->ring_fd >= 0) {
+        if (u->br) {
+            struct io_uring_buf_reg reg;
+            memset(&reg, 0, sizeof(reg));
+            reg.bgid = RV_URING_BGID;
+            (void)sys_register(u->ring_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        }
+        close(u->ring_fd);
+    }
+    if (u->sqes) munmap(u->sqes, u->sqes_size);
+    if (u->ring) munmap(u->ring, u->ring_size);
+    if (u->br) munmap(u->br, u->br_size);
+    free(u->bufs);
+    free(u->sends);
+    free(u->copies);
+    free(u);
+}
+
+// No DEFER_TASKRUN: each link of a chain is started from task work, and
+// deferred task work would advance a chain by one link per wait.
+static int setup_ring(rv_relay_uring_t* u) {
+    static const unsigned k_flags[3] = {
+        IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN |
+            IORING_SETUP_SINGLE_ISSUER,
+        IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN,
+        IORING_SETUP_CQSIZE,
+    };
+
+    struct io_uring_params p;
+    for (int i = 0; i < 3 && u->ring_fd < 0; ++i) {
+        memset(&p, 0, sizeof(p));
+        p.flags = k_flags[i];
+        p.cq_entries = RV_URING_CQ_ENTRIES;
+        u->ring_fd = sys_setup(RV_URING_SQ_ENTRIES, &p);
+    }
+    if (u->ring_fd < 0) return -1;
+
+    const unsigned need = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG |
+                          IORING_FEAT_CQE_SKIP;
+    if ((p.features & need) != need) return -2;
+
+    const size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    const size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    u->ring_size = sq_size > cq_size ? sq_size : cq_size;
+    u->ring = mmap(NULL, u->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   u->ring_fd, IORING_OFF_SQ_RING);
+    if (u->ring == MAP_FAILED) {
+        u->ring = NULL;
+        return -3;
+    }
+    u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = (struct io_uring_sqe*)mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE,
+                                         MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) {
+        u->sqes = NULL;
+        return -3;
+    }
+
+    uint8_t* r = (uint8_t*)u->ring;
+    u->sq_head = (unsigned*)(r + p.sq_off.head);
+    u->sq_tail = (unsigned*)(r + p.sq_off.tail);
+    u->sq_array = (unsigned*)(r + p.sq_off.array);
+    u->sq_mask = *(unsigned*)(r + p.sq_off.ring_mask);
+    u->sq_entries = p.sq_entries;
+    u->sq_local = *u->sq_tail;
+    u->cq_head = (unsigned*)(r + p.cq_off.head);
+    u->cq_tail = (unsigned*)(r + p.cq_off.tail);
+    u->cq_mask = *(unsigned*)(r + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe*)(r + p.cq_off.cqes);
+    return 0;
+}
+
+static int setup_buffers(rv_relay_uring_t* u) {
+    u->br_size = RV_URING_BUFS * sizeof(struct io_uring_buf);
+    u->br = (struct io_uring_buf_ring*)mmap(NULL, u->br_size, PROT_READ | PROT_WRITE,
+                                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (u->br == MAP_FAILED) {
+        u->br = NULL;
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)u->br;
+    reg.ring_entries = RV_URING_BUFS;
+    reg.bgid = RV_URING_BGID;
+    if (sys_register(u->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        munmap(u->br, u->br_size);
+        u->br = NULL;
+        return -2;
+    }
+
+    u->bufs = (uint8_t*)malloc((size_t)RV_URING_BUFS * RV_URING_BUF_SIZE);
+    u->sends = (rv_uring_send_t*)malloc(sizeof(rv_uring_send_t) * RV_URING_SENDS);
+    u->copies = (uint8_t*)malloc((size_t)RV_URING_COPIES * RV_RELAY_IO_PKT);
+    if (!u->bufs || !u->sends || !u->copies) return -3;
+
+    for (int i = 0; i < RV_URING_BUFS; ++i) buf_push(u, i);
+    for (int i = 0; i < RV_URING_SENDS; ++i) u->sends[i].next = i + 1 < RV_URING_SENDS ? i + 1 : -1;
+    u->send_free = 0;
+    for (int i = 0; i < RV_URING_COPIES; ++i) u->copy_free[i] = i;
+    u->copy_free_n = RV_URING_COPIES;
+
+    // Address space for the larger family; control messages are not used
+    u->recv_msg.msg_namelen = sizeof(struct sockaddr_in6);
+    return 0;
+}
+
+rv_relay_uring_t* rv_relay_uring_create(rv_udp_socket_t* sock) {
+    const int fd = rv_udp_fd(sock);
+    if (fd < 0) return NULL;
+
+    rv_relay_uring_t* u = (rv_relay_uring_t*)calloc(1, sizeof(*u));
+    if (!u) return NULL;
+    u->sock = sock;
+    u->sock_fd = fd;
+    u->ring_fd = -1;
+    u->wake_fd = -1;
+    u->chain_head = -1;
+    u->chain_tail = -1;
+
+    if (setup_ring(u) != 0 || setup_buffers(u) != 0 || arm_recv(u) != 0 ||
+        ring_enter(u, 0, 0) != 0) {
+        rv_relay_uring_destroy(u);
+        return NULL;
+    }
+
+    // Kernels without multishot recvmsg reject the armed request at once
+    const unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+    for (unsigned h = *u->cq_head; h != tail; ++h) {
+        const struct io_uring_cqe* c = &u->cqes[h & u->cq_mask];
+        if (c->user_data == RV_UD_RECV && c->res == -EINVAL) {
+            rv_relay_uring_destroy(u);
+            return NULL;
+        }
+    }
+    return u;
+}
+
+int rv_relay_uring_recv(rv_relay_uring_t* u, rv_udp_msg_t* msgs, int count, int timeout_ms) {
+    if (!u || !msgs || count <= 0) return -1;
+    if (count > RV_RELAY_IO_BATCH) count = RV_RELAY_IO_BATCH;
+
+    for (;;) {
+        if (!u->recv_armed && u->bufs_free > 0) (void)arm_recv(u);
+        if (!u->wake_armed && u->wake_fd >= 0) (void)arm_wake(u);
+
+        // Submit last batch's sends; block only when nothing is ready
+        const unsigned cq_ready = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE) - *u->cq_head;
+        const int ready = u->stash_head != u->stash_tail || cq_ready > 0 || u->woken;
+        const int wait = !ready && timeout_ms != 0;
+        if ((wait || sq_pending(u) > 0) && ring_enter(u, wait ? 1 : 0, timeout_ms) != 0) return -2;
+        reap(u);
+
+        int n = 0;
+        while (n < count && u->stash_head != u->stash_tail) unstash(u, &msgs[n++]);
+
+        // Send completions also end a wait; only an unlimited wait goes round
+        if (n > 0 || timeout_ms >= 0 || u->woken) return n;
+    }
+}
+
+int rv_relay_uring_watch(rv_relay_uring_t* u, int fd) {
+    if (!u || fd < 0) return -1;
+    u->wake_fd = fd;
+    return arm_wake(u);
+}
+
+int rv_relay_uring_woken(rv_relay_uring_t* u) {
+    if (!u || !u->woken) return 0;
+    u->woken = 0;
+    return 1;
+}
+
+int rv_relay_uring_send(rv_relay_uring_t* u, const rv_sockaddr_t* to, const uint8_t* data, int len) {
+    if (!u || !to || !data || len <= 0 || len > RV_RELAY_IO_PKT) return -1;
+
+    // Only receive buffers are chained: callers rebuild their own buffers
+    // between sends, so each of those sends gets a copy of its own
+    if (u->chain_tail >= 0 && (data != u->chain_data || len != u->chain_len || u->chain_buf < 0))
+        close_chain(u);
+
+    const int bid = buf_of(u, data, len);
+    if (u->send_free < 0 || sq_pending(u) >= u->sq_entries ||
+        (u->chain_tail < 0 && bid < 0 && u->copy_free_n == 0)) {
+        reclaim(u);
+        if (u->send_free < 0 || sq_pending(u) >= u->sq_entries ||
+            (u->chain_tail < 0 && bid < 0 && u->copy_free_n == 0))
+            return -2;
+    }
+
+    const int idx = u->send_free;
+    rv_uring_send_t* s = &u->sends[idx];
+    unsigned sslen = 0;
+    if (rv_udp_addr_to_native(u->sock, to, &s->ss, &sslen) != 0) return -3;
+
+    if (u->chain_tail < 0) {
+        u->chain_data = data;
+        u->chain_len = len;
+        u->chain_buf = bid;
+        u->chain_copy = -1;
+        if (bid >= 0) {
+            u->refs[bid]++;
+        } else {
+            u->chain_copy = u->copy_free[--u->copy_free_n];
+            memcpy(u->copies + (size_t)u->chain_copy * RV_RELAY_IO_PKT, data, (size_t)len);
+        }
+    }
+    const uint8_t* src = u->chain_copy >= 0 ? u->copies + (size_t)u->chain_copy * RV_RELAY_IO_PKT : data;
+
+    u->send_free = s->next;
+    s->next = -1;
+    s->iov.iov_base = (void*)(uintptr_t)src;
+    s->iov.iov_len = (size_t)len;
+    memset(&s->mh, 0, sizeof(s->mh));
+    s->mh.msg_name = &s->ss;
+    s->mh.msg_namelen = (socklen_t)sslen;
+    s->mh.msg_iov = &s->iov;
+    s->mh.msg_iovlen = 1;
+
+    struct io_uring_sqe* sqe = get_sqe(u);
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = u->sock_fd;
+    sqe->addr = (uint64_t)(uintptr_t)&s->mh;
+    sqe->len = 1;
+    sqe->user_data = (uint64_t)(uint32_t)idx;
+
+    // Earlier links complete silently and only report a failure, which
+    // leaves the later ones running (hard links); the tail always reports
+    if (u->chain_tail >= 0) {
+        u->chain_sqe->flags |= IOSQE_IO_HARDLINK | IOSQE_CQE_SKIP_SUCCESS;
+        u->chain_sqe->user_data |= RV_UD_NONTAIL;
+        u->sends[u->chain_tail].next = idx;
+    } else {
+        u->chain_head = idx;
+    }
+    u->chain_tail = idx;
+    u->chain_sqe = sqe;
+    return len;
+}
+
+void rv_relay_uring_flush(rv_relay_uring_t* u) {
+    if (!u) return;
+    close_chain(u);
+    for (int i = 0; i < u->rx_count; ++i) buf_unref(u, u->rx_bid[i]);
+    u->rx_count = 0;
+}
+
+void rv_relay_uring_counts(const rv_relay_uring_t* u, uint64_t* out_tx_failed, uint64_t* out_enters) {
+    if (out_tx_failed) *out_tx_failed = u ? u->tx_failed : 0;
+    if (out_enters) *out_enters = u ? u->enters : 0;
+}
+
+#else // headers older than 6.0
+
+rv_relay_uring_t* rv_relay_uring_create(rv_udp_socket_t* sock) {
+    (void)sock;
+    return NULL;
+}
+
+void rv_relay_uring_destroy(rv_relay_uring_t* u) { (void)u; }
+
+int rv_relay_uring_recv(rv_relay_uring_t* u, rv_udp_msg_t* msgs, int count, int timeout_ms) {
+    (void)u; (void)msgs; (void)count; (void)timeout_ms;
+    return -1;
+}
+
+int rv_relay_uring_watch(rv_relay_uring_t* u, int fd) {
+    (void)u; (void)fd;
+    return -1;
+}
+
+int rv_relay_uring_woken(rv_relay_uring_t* u) {
+    (void)u;
+    return 0;
+}
+
+int rv_relay_uring_send(rv_relay_uring_t* u, const rv_sockaddr_t* to, const uint8_t* data, int len) {
+    (void)u; (void)to; (void)data; (void)len;
+    return -1;
+}
+
+void rv_relay_uring_flush(rv_relay_uring_t* u) { (void)u; }
+
+void rv_relay_uring_counts(const rv_relay_uring_t* u, uint64_t* out_tx_failed, uint64_t* out_enters) {
+    (void)u;
+    if (out_tx_failed) *out_tx_failed = 0;
+    if (out_enters) *out_enters = 0;
+}
+
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+#include "rv_udp.h"
+
+/*
+ * io_uring engine for the relay socket (Linux 6.0+).
+ *
+ * One multishot RECVMSG stays armed on the socket and fills buffers from a
+ * provided buffer ring, so receiving costs no submissions at all. The
+ * sends for one packet are queued as a chain of linked SENDMSGs that point
+ * straight into the receive buffer; only the last link posts a completion
+ * on success, and that completion hands the buffer back to the ring. The
+ * links are hard, so one failed send does not cancel the rest.
+ * Submitting the sends and waiting for new packets is one io_uring_enter.
+ *
+ * Used through rv_relay_io; see rv_relay_io.h for the calling pattern.
+ */
+
+typedef struct rv_relay_uring rv_relay_uring_t;
+
+// NULL when io_uring or one of the features above is unavailable
+rv_relay_uring_t* rv_relay_uring_create(rv_udp_socket_t* sock);
+void rv_relay_uring_destroy(rv_relay_uring_t* u);
+
+// Submit queued sends and wait up to timeout_ms (<0: no limit) for
+// datagrams. Returns the count, 0 on timeout. Buffers stay valid until the
+// next rv_relay_uring_flush.
+int  rv_relay_uring_recv(rv_relay_uring_t* u, rv_udp_msg_t* msgs, int count, int timeout_ms);
+
+// Keep a multishot poll armed on fd; its completions end a wait like a
+// datagram would. rv_relay_uring_woken reports (and clears) whether one
+// arrived.
+int  rv_relay_uring_watch(rv_relay_uring_t* u, int fd);
+int  rv_relay_uring_woken(rv_relay_uring_t* u);
+
+// Queue a send. Consecutive sends of the same receive buffer form one
+// linked chain; other data is copied per send, so the caller may reuse its
+// buffer right away. Returns len or <0 (dropped).
+int  rv_relay_uring_send(rv_relay_uring_t* u, const rv_sockaddr_t* to, const uint8_t* data, int len);
+
+// End the current chain and release the buffers of the last receive batch
+// (those not referenced by a pending send go straight back to the ring).
+void rv_relay_uring_flush(rv_relay_uring_t* u);
+
+// Sends that failed after submission, and io_uring_enter calls so far
+void rv_relay_uring_counts(const rv_relay_uring_t* u, uint64_t* out_tx_failed, uint64_t* out_enters);
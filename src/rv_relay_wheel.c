@@ -0,0 +1,110 @@
+#include "rv_relay_wheel.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define RV_WHEEL_MASK ((uint64_t)RV_RELAY_WHEEL_SLOTS - 1)
+
+// Furthest deadline the top level can hold; later ones fire early and
+// their owners arm them again
+#define RV_WHEEL_SPAN ((uint64_t)1 << (RV_RELAY_WHEEL_BITS * RV_RELAY_WHEEL_LEVELS))
+
+void rv_relay_wheel_init(rv_relay_wheel_t* w, uint32_t tick_ms, uint64_t now_us) {
+    memset(w, 0, sizeof(*w));
+    w->tick_us = (uint64_t)(tick_ms ? tick_ms : 1) * 1000u;
+    w->now = now_us / w->tick_us;
+}
+
+void rv_relay_wheel_free(rv_relay_wheel_t* w) {
+    if (!w) return;
+    for (int l = 0; l < RV_RELAY_WHEEL_LEVELS; ++l) {
+        for (uint32_t i = 0; i < RV_RELAY_WHEEL_SLOTS; ++i) free(w->slots[l][i].items);
+    }
+    memset(w, 0, sizeof(*w));
+}
+
+uint32_t rv_relay_wheel_gen(rv_relay_wheel_t* w) {
+    if (++w->next_gen == 0) w->next_gen = 1;
+    return w->next_gen;
+}
+
+// t->due >= w->now: due this tick lands in the slot about to run
+static int place(rv_relay_wheel_t* w, const rv_relay_timer_t* t) {
+    const uint64_t delta = t->due - w->now;
+    int l = 0;
+    while (l < RV_RELAY_WHEEL_LEVELS - 1 && delta >> (RV_RELAY_WHEEL_BITS * (l + 1))) l++;
+
+    rv_relay_wheel_slot_t* s = &w->slots[l][(t->due >> (RV_RELAY_WHEEL_BITS * l)) & RV_WHEEL_MASK];
+    if (s->count == s->cap) {
+        const uint32_t cap = s->cap ? s->cap * 2 : 8;
+        rv_relay_timer_t* grown = (rv_relay_timer_t*)realloc(s->items, cap * sizeof(*grown));
+        if (!grown) return -1;
+        s->items = grown;
+        s->cap = cap;
+    }
+    s->items[s->count++] = *t;
+    w->count++;
+    return 0;
+}
+
+int rv_relay_wheel_add(rv_relay_wheel_t* w, const rv_relay_ep_key_t* key, uint32_t gen, uint64_t due_us) {
+    rv_relay_timer_t t;
+    t.key = *key;
+    t.gen = gen;
+    t.due = (due_us + w->tick_us - 1) / w->tick_us;
+    if (t.due <= w->now) t.due = w->now + 1;
+    if (t.due - w->now >= RV_WHEEL_SPAN) t.due = w->now + RV_WHEEL_SPAN - 1;
+    return place(w, &t);
+}
+
+// Take a slot's timers out, keeping its buffer for the next round
+static rv_relay_timer_t* detach(rv_relay_wheel_t* w, rv_relay_wheel_slot_t* s, uint32_t* n, uint32_t* cap) {
+    rv_relay_timer_t* items = s->items;
+    *n = s->count;
+    *cap = s->cap;
+    w->count -= s->count;
+    s->items = NULL;
+    s->count = 0;
+    s->cap = 0;
+    return items;
+}
+
+static void reattach(rv_relay_wheel_slot_t* s, rv_relay_timer_t* items, uint32_t cap) {
+    if (s->items) {
+        free(items);
+        return;
+    }
+    s->items = items;
+    s->cap = cap;
+}
+
+void rv_relay_wheel_advance(rv_relay_wheel_t* w, uint64_t now_us, rv_relay_wheel_fn fn, void* ctx) {
+    const uint64_t target = now_us / w->tick_us;
+    while (w->now < target) {
+        if (w->count == 0) {
+            w->now = target;
+            return;
+        }
+        w->now++;
+
+        // Higher levels first, so what they hand down is in place when
+        // the level below comes up in the same tick. A timer with no room
+        // below fires early rather than getting lost; owners re-check.
+        for (int l = RV_RELAY_WHEEL_LEVELS - 1; l > 0; --l) {
+            const unsigned shift = RV_RELAY_WHEEL_BITS * (unsigned)l;
+            if (w->now & (((uint64_t)1 << shift) - 1)) continue;
+            rv_relay_wheel_slot_t* s = &w->slots[l][(w->now >> shift) & RV_WHEEL_MASK];
+            uint32_t n, cap;
+            rv_relay_timer_t* items = detach(w, s, &n, &cap);
+            for (uint32_t i = 0; i < n; ++i) {
+                if (place(w, &items[i]) != 0) fn(ctx, &items[i], now_us);
+            }
+            reattach(s, items, cap);
+        }
+
+        rv_relay_wheel_slot_t* s = &w->slots[0][w->now & RV_WHEEL_MASK];
+        uint32_t n, cap;
+        rv_relay_timer_t* items = detach(w, s, &n, &cap);
+        for (uint32_t i = 0; i < n; ++i) fn(ctx, &items[i], now_us);
+        reattach(s, items, cap);
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <stdint.h>
+#include "rv_relay.h"
+
+/*
+ * Hierarchical timer wheel for idle endpoints.
+ *
+ * A table that forgets idle endpoints (session members, shard routes)
+ * arms one timer per entry, keyed by the entry's address and a generation
+ * number. Packets only stamp the entry's last-seen time and never touch
+ * the wheel. When a timer fires, its owner looks the entry up again: a
+ * newer generation means the timer is stale, a recent stamp arms it for
+ * the rest of the idle window, and anything else is evicted.
+ *
+ * Level l has RV_RELAY_WHEEL_SLOTS slots spanning SLOTS^l ticks each. A
+ * timer goes into the lowest level whose span reaches its deadline and
+ * moves down a level each time its slot comes up, so adding and firing
+ * are O(1) and a timer is touched at most RV_RELAY_WHEEL_LEVELS times.
+ */
+
+#define RV_RELAY_WHEEL_BITS   6
+#define RV_RELAY_WHEEL_SLOTS  (1u << RV_RELAY_WHEEL_BITS)
+#define RV_RELAY_WHEEL_LEVELS 4
+
+typedef struct rv_relay_timer {
+    rv_relay_ep_key_t key;
+    uint32_t gen;
+    uint64_t due;          // tick
+} rv_relay_timer_t;
+
+typedef struct rv_relay_wheel_slot {
+    rv_relay_timer_t* items;
+    uint32_t count;
+    uint32_t cap;
+} rv_relay_wheel_slot_t;
+
+typedef struct rv_relay_wheel {
+    uint64_t tick_us;
+    uint64_t now;          // last tick run
+    uint32_t count;        // timers armed
+    uint32_t next_gen;     // for the owner's entries, never 0
+    rv_relay_wheel_slot_t slots[RV_RELAY_WHEEL_LEVELS][RV_RELAY_WHEEL_SLOTS];
+} rv_relay_wheel_t;
+
+typedef void (*rv_relay_wheel_fn)(void* ctx, const rv_relay_timer_t* t, uint64_t now_us);
+
+void rv_relay_wheel_init(rv_relay_wheel_t* w, uint32_t tick_ms, uint64_t now_us);
+void rv_relay_wheel_free(rv_relay_wheel_t* w);
+
+// A fresh generation for an entry that arms a timer
+uint32_t rv_relay_wheel_gen(rv_relay_wheel_t* w);
+
+// Fire at due_us, rounded up to a tick and at least one tick from now.
+// Returns 0, or -1 when out of memory.
+int  rv_relay_wheel_add(rv_relay_wheel_t* w, const rv_relay_ep_key_t* key, uint32_t gen, uint64_t due_us);
+
+// Run the ticks up to now_us, calling fn for every timer that came due;
+// fn may add timers
+void rv_relay_wheel_advance(rv_relay_wheel_t* w, uint64_t now_us, rv_relay_wheel_fn fn, void* ctx);
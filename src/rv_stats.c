@@ -0,0 +1,98 @@
+#include "rv_stats.h"
+#include <string.h>
+
+static void rv_rx_stats_restart(rv_rx_stats_t* s, uint16_t seq)
+{
+    memset(s, 0, sizeof(*s));
+    s->started = 1;
+    s->base_seq = seq;
+}
+
+void rv_rx_stats_init(rv_rx_stats_t* s)
+{
+    if (!s) return;
+    memset(s, 0, sizeof(*s));
+}
+
+void rv_rx_stats_on_packet(rv_rx_stats_t* s, uint16_t seq, uint32_t frames,
+                           int has_ts, uint32_t ts_us, uint64_t arrival_us)
+{
+    if (!s) return;
+    if (frames == 0) frames = 1;
+
+    const uint16_t last = (uint16_t)(seq + frames - 1u);
+    const int delta = (int16_t)(uint16_t)(last - s->max_seq);
+
+    if (!s->started || delta > RV_STATS_MAX_DROPOUT || delta < -RV_STATS_MAX_DROPOUT) {
+        rv_rx_stats_restart(s, seq);
+        if (last < seq) s->cycles = 0x10000u;
+        s->max_seq = last;
+    } else if (delta > 0) {
+        if (last < s->max_seq) s->cycles += 0x10000u;
+        s->max_seq = last;
+    }
+    s->received += frames;
+
+    if (!has_ts) return;
+
+    /*
+     * Interarrival jitter: both clocks only ever appear as differences, so
+     * the sender and receiver clocks need not agree.
+     */
+    const int32_t transit = (int32_t)((uint32_t)arrival_us - ts_us);
+    if (s->has_transit) {
+        int32_t d = transit - s->transit;
+        if (d < 0) d = -d;
+        s->jitter_q4 += (uint32_t)d - ((s->jitter_q4 + 8u) >> 4);
+    }
+    s->transit = transit;
+    s->has_transit = 1;
+
+    if (!s->has_ts || (int32_t)(ts_us - s->last_ts) > 0) {
+        s->last_ts = ts_us;
+        s->last_ts_arrival_us = arrival_us;
+        s->has_ts = 1;
+    }
+}
+
+uint32_t rv_rx_stats_highest_seq(const rv_rx_stats_t* s)
+{
+    return s ? s->cycles + s->max_seq : 0;
+}
+
+static uint32_t rv_rx_stats_expected(const rv_rx_stats_t* s)
+{
+    return rv_rx_stats_highest_seq(s) - s->base_seq + 1u;
+}
+
+uint32_t rv_rx_stats_lost(const rv_rx_stats_t* s)
+{
+    if (!s || !s->started) return 0;
+    const uint32_t expected = rv_rx_stats_expected(s);
+    // duplicates (RED, retransmits) can push received past expected
+    return expected > s->received ? expected - s->received : 0;
+}
+
+uint32_t rv_rx_stats_jitter_us(const rv_rx_stats_t* s)
+{
+    return s ? s->jitter_q4 >> 4 : 0;
+}
+
+uint8_t rv_rx_stats_close_interval(rv_rx_stats_t* s)
+{
+    if (!s || !s->started) return 0;
+
+    const uint32_t expected = rv_rx_stats_expected(s);
+    const uint32_t expected_interval = expected - s->expected_prior;
+    const uint32_t received_interval = s->received - s->received_prior;
+    s->expected_prior = expected;
+    s->received_prior = s->received;
+
+    uint32_t fraction = 0;
+    if (expected_interval > received_interval) {
+        fraction = ((expected_interval - received_interval) << 8) / expected_interval;
+        if (fraction > 255u) fraction = 255u;
+    }
+    s->last_fraction = (uint8_t)fraction;
+    return s->last_fraction;
+}
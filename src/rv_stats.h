@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Per-sender receive statistics (RFC 3550 A.1 / A.8 style).
+ *
+ * seq counts frames, so a packet carrying n frames covers seq..seq+n-1.
+ * Frames that never arrived count as lost even when RED or FEC later
+ * concealed them: this measures the network, not the playout.
+ */
+
+// A jump this large (either way) means the sender restarted its stream
+#ifndef RV_STATS_MAX_DROPOUT
+#define RV_STATS_MAX_DROPOUT 3000
+#endif
+
+typedef struct rv_rx_stats {
+    uint8_t  started;
+    uint8_t  has_transit;
+    uint8_t  has_ts;
+    uint8_t  last_fraction;       // loss of the last closed interval, /256
+
+    uint16_t max_seq;
+    uint32_t cycles;              // seq wraps << 16
+    uint32_t base_seq;            // extended seq of the first frame
+    uint32_t received;            // frames
+    uint32_t expected_prior;
+    uint32_t received_prior;
+
+    int32_t  transit;             // arrival - sender ts of the last packet (us)
+    uint32_t jitter_q4;           // interarrival jitter, us * 16
+
+    uint32_t last_ts;             // newest sender timestamp (us, sender clock)
+    uint64_t last_ts_arrival_us;  // local arrival time of that packet
+} rv_rx_stats_t;
+
+void rv_rx_stats_init(rv_rx_stats_t* s);
+
+void rv_rx_stats_on_packet(rv_rx_stats_t* s, uint16_t seq, uint32_t frames,
+                           int has_ts, uint32_t ts_us, uint64_t arrival_us);
+
+uint32_t rv_rx_stats_highest_seq(const rv_rx_stats_t* s);   // extended
+uint32_t rv_rx_stats_lost(const rv_rx_stats_t* s);          // cumulative frames
+uint32_t rv_rx_stats_jitter_us(const rv_rx_stats_t* s);
+
+// Close a report interval. Returns the fraction lost since the previous
+// call (0..255) and keeps it in last_fraction.
+uint8_t rv_rx_stats_close_interval(rv_rx_stats_t* s);
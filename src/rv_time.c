@@ -0,0 +1,29 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "rv_time.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+uint64_t rv_time_now_us(void) {
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+
+    const uint64_t q = (uint64_t)now.QuadPart;
+    const uint64_t f = (uint64_t)freq.QuadPart;
+    return (q / f) * 1000000ull + ((q % f) * 1000000ull) / f;
+}
+#else
+#include <time.h>
+
+uint64_t rv_time_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000ull;
+}
+#endif
@@ -0,0 +1,5 @@
+#pragma once
+#include <stdint.h>
+
+// Monotonic clock in microseconds. Only differences are meaningful.
+uint64_t rv_time_now_us(void);
@@ -0,0 +1,40 @@
+#include "rv_timer.h"
+#include <string.h>
+
+void rv_timers_init(rv_timers_t* ts) {
+    if (!ts) return;
+    memset(ts, 0, sizeof(*ts));
+}
+
+int rv_timers_add(rv_timers_t* ts, uint64_t now_us, uint32_t period_ms, rv_timer_fn fn, void* ctx) {
+    if (!ts || !fn || period_ms == 0 || ts->count == RV_TIMERS_MAX) return -1;
+    rv_timer_t* t = &ts->t[ts->count];
+    t->period_us = (uint64_t)period_ms * 1000u;
+    t->due_us = now_us + t->period_us;
+    t->fn = fn;
+    t->ctx = ctx;
+    return ts->count++;
+}
+
+int rv_timers_wait_ms(const rv_timers_t* ts, uint64_t now_us) {
+    if (!ts || ts->count == 0) return -1;
+
+    uint64_t next = ts->t[0].due_us;
+    for (int i = 1; i < ts->count; ++i)
+        if (ts->t[i].due_us < next) next = ts->t[i].due_us;
+
+    if (next <= now_us) return 0;
+    const uint64_t ms = (next - now_us + 999u) / 1000u;
+    return ms > 0x7fffffffu ? 0x7fffffff : (int)ms;
+}
+
+void rv_timers_run(rv_timers_t* ts, uint64_t now_us) {
+    if (!ts) return;
+    for (int i = 0; i < ts->count; ++i) {
+        rv_timer_t* t = &ts->t[i];
+        if (t->due_us > now_us) continue;
+        t->fn(t->ctx, now_us);
+        t->due_us += t->period_us;
+        if (t->due_us <= now_us) t->due_us = now_us + t->period_us;
+    }
+}
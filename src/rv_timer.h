@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Periodic housekeeping timers for a single-threaded event loop.
+ *
+ * The loop asks for the time until the next deadline, passes it as the
+ * timeout of its readiness wait, and runs whatever is due afterwards, so
+ * an idle loop only wakes when a timer fires.
+ */
+
+#define RV_TIMERS_MAX 8
+
+typedef void (*rv_timer_fn)(void* ctx, uint64_t now_us);
+
+typedef struct rv_timer {
+    uint64_t due_us;
+    uint64_t period_us;
+    rv_timer_fn fn;
+    void* ctx;
+} rv_timer_t;
+
+typedef struct rv_timers {
+    rv_timer_t t[RV_TIMERS_MAX];
+    int count;
+} rv_timers_t;
+
+void rv_timers_init(rv_timers_t* ts);
+
+// First run one period after now_us. Returns the timer index or -1 if full.
+int  rv_timers_add(rv_timers_t* ts, uint64_t now_us, uint32_t period_ms, rv_timer_fn fn, void* ctx);
+
+// Milliseconds until the next deadline, rounded up; -1 with no timers
+int  rv_timers_wait_ms(const rv_timers_t* ts, uint64_t now_us);
+
+// Call every timer that is due. A timer that fell more than a period
+// behind skips the missed runs instead of firing back to back.
+void rv_timers_run(rv_timers_t* ts, uint64_t now_us);
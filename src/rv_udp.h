@@ -21,9 +21,65 @@ int rv_udp_startup(void);
 void rv_udp_cleanup(void);
 
 rv_udp_socket_t* rv_udp_create_dualstack(uint16_t bind_port, int nonblocking);
+
+// Dual-stack socket that shares bind_port with the other sockets created
+// this way (SO_REUSEPORT); the kernel spreads senders across them by a hash
+// of their address. NULL where the OS does not balance (Linux only).
+rv_udp_socket_t* rv_udp_create_reuseport(uint16_t bind_port, int nonblocking);
 void rv_udp_destroy(rv_udp_socket_t* s);
 
+// Kernel socket buffer sizes in bytes (0 = leave as is). The OS may clamp
+// them (net.core.rmem_max / wmem_max on Linux).
+int rv_udp_set_buffers(rv_udp_socket_t* s, int rcvbuf_bytes, int sndbuf_bytes);
+
 int rv_udp_sendto(rv_udp_socket_t* s, const rv_sockaddr_t* to, const uint8_t* data, int len);
 int rv_udp_recvfrom(rv_udp_socket_t* s, rv_sockaddr_t* from, uint8_t* out, int out_cap);
 
+// Block until a datagram is waiting or timeout_ms passes (<0: no limit).
+// Returns 1 when readable, 0 on timeout or signal, <0 on error.
+int rv_udp_wait_readable(rv_udp_socket_t* s, int timeout_ms);
+
 int rv_parse_ip_port(const char* host, uint16_t port, rv_sockaddr_t* out);
+
+// ---- Batched I/O ----
+// recvmmsg / sendmmsg on Linux, one call per datagram elsewhere.
+#define RV_UDP_BATCH_MAX 64
+
+typedef struct rv_udp_msg {
+    rv_sockaddr_t addr;    // source (receive) or destination (send)
+    uint8_t* data;
+    int len;               // bytes received / bytes to send
+    int cap;               // buffer size (receive only)
+} rv_udp_msg_t;
+
+// Fill up to count messages (each with data/cap set). Returns the number
+// received, 0 if nothing is pending, <0 on error.
+int rv_udp_recv_batch(rv_udp_socket_t* s, rv_udp_msg_t* msgs, int count);
+
+// Send count messages. Adjacent messages to the same destination with the
+// same length go out as one UDP GSO (UDP_SEGMENT) send where the kernel
+// supports it. Returns the number of messages sent. A full socket buffer
+// drops the rest; a message failing on its own (unreachable destination)
+// drops just that one.
+int rv_udp_send_batch(rv_udp_socket_t* s, const rv_udp_msg_t* msgs, int count);
+
+// Syscalls issued by this socket so far (rx, tx); for profiling
+void rv_udp_syscall_counts(const rv_udp_socket_t* s, uint64_t* out_rx, uint64_t* out_tx);
+
+#ifndef _WIN32
+// ---- Native access (POSIX) ----
+// For I/O engines that drive the socket themselves (io_uring).
+struct sockaddr_storage;
+
+int rv_udp_fd(const rv_udp_socket_t* s);
+
+// rv_udp_wait_readable that also returns when fd (an eventfd or pipe) is
+// readable. Returns a mask: 1 the socket, 2 fd; 0 on timeout or signal.
+int rv_udp_wait_readable_fd(rv_udp_socket_t* s, int fd, int timeout_ms);
+
+// rv_sockaddr_t <-> sockaddr with the same v4-mapping rules as sendto /
+// recvfrom. len is a socklen_t.
+int rv_udp_addr_to_native(const rv_udp_socket_t* s, const rv_sockaddr_t* in,
+                          struct sockaddr_storage* out, unsigned* out_len);
+int rv_udp_addr_from_native(const struct sockaddr_storage* in, rv_sockaddr_t* out);
+#endif
@@ -0,0 +1,486 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE       // recvmmsg / sendmmsg
+#endif
+#include "rv_udp.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#define RV_UDP_MMSG 1
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103   // linux/udp.h, older libc headers lack it
+#endif
+#else
+#define RV_UDP_MMSG 0
+#endif
+
+// Kernel limits for one GSO send
+#define RV_UDP_GSO_MAX_SEGS   64
+#define RV_UDP_GSO_MAX_BYTES  65000
+
+struct rv_udp_socket {
+    int fd;
+    int family;      // AF_INET6 (dual-stack) or AF_INET when v6 is unavailable
+    int gso;         // 1 until the kernel rejects UDP_SEGMENT
+    uint64_t rx_calls;
+    uint64_t tx_calls;
+};
+
+int rv_udp_startup(void) {
+    return 0;
+}
+
+void rv_udp_cleanup(void) {
+}
+
+static int set_nonblocking(int fd, int nb) {
+    int fl = fcntl(fd, F_GETFL, 0);
+    if (fl < 0) return -1;
+    fl = nb ? (fl | O_NONBLOCK) : (fl & ~O_NONBLOCK);
+    return fcntl(fd, F_SETFL, fl) == 0 ? 0 : -1;
+}
+
+static int bind_any(int fd, int family, uint16_t port) {
+    if (family == AF_INET6) {
+        struct sockaddr_in6 addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin6_family = AF_INET6;
+        addr.sin6_addr = in6addr_any;
+        addr.sin6_port = htons(port);
+        return bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    return bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+}
+
+static rv_udp_socket_t* create_bound(uint16_t bind_port, int nonblocking, int reuseport) {
+    int family = AF_INET6;
+    int fd = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd < 0) {
+        // Host without IPv6: plain v4 socket
+        family = AF_INET;
+        fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (fd < 0) return NULL;
+    }
+    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    if (family == AF_INET6) {
+        // Allow v4-mapped addresses (dual stack)
+        int v6only = 0;
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only));
+    }
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#ifdef SO_REUSEPORT
+    if (reuseport && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) != 0) {
+        close(fd);
+        return NULL;
+    }
+#else
+    (void)reuseport;
+#endif
+
+    if (bind_any(fd, family, bind_port) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    if (nonblocking && set_nonblocking(fd, 1) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    rv_udp_socket_t* out = (rv_udp_socket_t*)malloc(sizeof(*out));
+    if (!out) { close(fd); return NULL; }
+    memset(out, 0, sizeof(*out));
+    out->fd = fd;
+    out->family = family;
+    out->gso = RV_UDP_MMSG;
+    return out;
+}
+
+rv_udp_socket_t* rv_udp_create_dualstack(uint16_t bind_port, int nonblocking) {
+    return create_bound(bind_port, nonblocking, 0);
+}
+
+rv_udp_socket_t* rv_udp_create_reuseport(uint16_t bind_port, int nonblocking) {
+#if defined(__linux__) && defined(SO_REUSEPORT)
+    return create_bound(bind_port, nonblocking, 1);
+#else
+    // BSD and macOS accept the option but hand every datagram to one socket
+    (void)bind_port;
+    (void)nonblocking;
+    return NULL;
+#endif
+}
+
+void rv_udp_destroy(rv_udp_socket_t* s) {
+    if (!s) return;
+    close(s->fd);
+    free(s);
+}
+
+int rv_udp_set_buffers(rv_udp_socket_t* s, int rcvbuf_bytes, int sndbuf_bytes) {
+    if (!s) return -1;
+    int r = 0;
+    if (rcvbuf_bytes > 0 && setsockopt(s->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf_bytes, sizeof(rcvbuf_bytes)) != 0) r = -2;
+    if (sndbuf_bytes > 0 && setsockopt(s->fd, SOL_SOCKET, SO_SNDBUF, &sndbuf_bytes, sizeof(sndbuf_bytes)) != 0) r = -2;
+    return r;
+}
+
+static const uint8_t k_v4_mapped_prefix[12] = { 0,0,0,0, 0,0,0,0, 0,0,0xFF,0xFF };
+
+// A v6 socket cannot sendto an AF_INET address on Linux, so v4 peers are
+// addressed as ::ffff:a.b.c.d there.
+static int to_sockaddr(const rv_udp_socket_t* s, const rv_sockaddr_t* in,
+                       struct sockaddr_storage* ss, socklen_t* sslen) {
+    memset(ss, 0, sizeof(*ss));
+    if (in->ver == RV_IPV4 && s->family == AF_INET6) {
+        struct sockaddr_in6* a = (struct sockaddr_in6*)ss;
+        a->sin6_family = AF_INET6;
+        memcpy(a->sin6_addr.s6_addr, k_v4_mapped_prefix, 12);
+        memcpy(a->sin6_addr.s6_addr + 12, in->ip.v4, 4);
+        a->sin6_port = htons(in->port);
+        *sslen = sizeof(*a);
+        return 0;
+    } else if (in->ver == RV_IPV4) {
+        struct sockaddr_in* a = (struct sockaddr_in*)ss;
+        a->sin_family = AF_INET;
+        memcpy(&a->sin_addr, in->ip.v4, 4);
+        a->sin_port = htons(in->port);
+        *sslen = sizeof(*a);
+        return 0;
+    } else if (in->ver == RV_IPV6 && s->family == AF_INET6) {
+        struct sockaddr_in6* a = (struct sockaddr_in6*)ss;
+        a->sin6_family = AF_INET6;
+        memcpy(&a->sin6_addr, in->ip.v6, 16);
+        a->sin6_port = htons(in->port);
+        *sslen = sizeof(*a);
+        return 0;
+    }
+    return -1;
+}
+
+// v4-mapped sources are reported as RV_IPV4 so a client has one identity
+// whichever way its packets arrive.
+static int from_sockaddr(const struct sockaddr_storage* ss, rv_sockaddr_t* out) {
+    if (ss->ss_family == AF_INET) {
+        const struct sockaddr_in* a = (const struct sockaddr_in*)ss;
+        out->ver = RV_IPV4;
+        out->port = ntohs(a->sin_port);
+        memcpy(out->ip.v4, &a->sin_addr, 4);
+        return 0;
+    } else if (ss->ss_family == AF_INET6) {
+        const struct sockaddr_in6* a = (const struct sockaddr_in6*)ss;
+        out->port = ntohs(a->sin6_port);
+        if (memcmp(a->sin6_addr.s6_addr, k_v4_mapped_prefix, 12) == 0) {
+            out->ver = RV_IPV4;
+            memcpy(out->ip.v4, a->sin6_addr.s6_addr + 12, 4);
+        } else {
+            out->ver = RV_IPV6;
+            memcpy(out->ip.v6, &a->sin6_addr, 16);
+        }
+        return 0;
+    }
+    return -1;
+}
+
+int rv_udp_fd(const rv_udp_socket_t* s) {
+    return s ? s->fd : -1;
+}
+
+int rv_udp_addr_to_native(const rv_udp_socket_t* s, const rv_sockaddr_t* in,
+                          struct sockaddr_storage* out, unsigned* out_len) {
+    if (!s || !in || !out || !out_len) return -1;
+    socklen_t len = 0;
+    if (to_sockaddr(s, in, out, &len) != 0) return -2;
+    *out_len = (unsigned)len;
+    return 0;
+}
+
+int rv_udp_addr_from_native(const struct sockaddr_storage* in, rv_sockaddr_t* out) {
+    if (!in || !out) return -1;
+    return from_sockaddr(in, out);
+}
+
+int rv_udp_sendto(rv_udp_socket_t* s, const rv_sockaddr_t* to, const uint8_t* data, int len) {
+    if (!s || !to || !data || len <= 0) return -1;
+    struct sockaddr_storage ss;
+    socklen_t sslen = 0;
+    if (to_sockaddr(s, to, &ss, &sslen) != 0) return -2;
+
+    ssize_t r;
+    do {
+        s->tx_calls++;
+        r = sendto(s->fd, data, (size_t)len, 0, (struct sockaddr*)&ss, sslen);
+    } while (r < 0 && errno == EINTR);
+    if (r < 0) return -3;
+    return (int)r;
+}
+
+int rv_udp_recvfrom(rv_udp_socket_t* s, rv_sockaddr_t* from, uint8_t* out, int out_cap) {
+    if (!s || !out || out_cap <= 0) return -1;
+
+    struct sockaddr_storage ss;
+    socklen_t sslen = sizeof(ss);
+    ssize_t r;
+    do {
+        s->rx_calls++;
+        r = recvfrom(s->fd, out, (size_t)out_cap, 0, (struct sockaddr*)&ss, &sslen);
+    } while (r < 0 && errno == EINTR);
+
+    if (r < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0; // no data
+        return -2;
+    }
+
+    if (from) (void)from_sockaddr(&ss, from);
+    return (int)r;
+}
+
+int rv_udp_wait_readable(rv_udp_socket_t* s, int timeout_ms) {
+    if (!s) return -1;
+    struct pollfd p;
+    p.fd = s->fd;
+    p.events = POLLIN;
+    p.revents = 0;
+
+    s->rx_calls++;
+    const int r = poll(&p, 1, timeout_ms < 0 ? -1 : timeout_ms);
+    if (r < 0) return errno == EINTR ? 0 : -2;
+    return r > 0 ? 1 : 0;
+}
+
+int rv_udp_wait_readable_fd(rv_udp_socket_t* s, int fd, int timeout_ms) {
+    if (!s) return -1;
+    struct pollfd p[2];
+    p[0].fd = s->fd;
+    p[0].events = POLLIN;
+    p[0].revents = 0;
+    p[1].fd = fd;
+    p[1].events = POLLIN;
+    p[1].revents = 0;
+
+    s->rx_calls++;
+    const int r = poll(p, 2, timeout_ms < 0 ? -1 : timeout_ms);
+    if (r < 0) return errno == EINTR ? 0 : -2;
+    return (p[0].revents ? 1 : 0) | (p[1].revents ? 2 : 0);
+}
+
+int rv_parse_ip_port(const char* host, uint16_t port, rv_sockaddr_t* out) {
+    if (!host || !out) return -1;
+
+    // IPv6 literal?
+    struct in6_addr a6;
+    if (inet_pton(AF_INET6, host, &a6) == 1) {
+        out->ver = RV_IPV6;
+        out->port = port;
+        memcpy(out->ip.v6, &a6, 16);
+        return 0;
+    }
+
+    // IPv4 literal?
+    struct in_addr a4;
+    if (inet_pton(AF_INET, host, &a4) == 1) {
+        out->ver = RV_IPV4;
+        out->port = port;
+        memcpy(out->ip.v4, &a4, 4);
+        return 0;
+    }
+
+    return -2;
+}
+
+static int addr_equal(const rv_sockaddr_t* a, const rv_sockaddr_t* b) {
+    if (a->ver != b->ver || a->port != b->port) return 0;
+    if (a->ver == RV_IPV4) return memcmp(a->ip.v4, b->ip.v4, 4) == 0;
+    return memcmp(a->ip.v6, b->ip.v6, 16) == 0;
+}
+
+void rv_udp_syscall_counts(const rv_udp_socket_t* s, uint64_t* out_rx, uint64_t* out_tx) {
+    if (out_rx) *out_rx = s ? s->rx_calls : 0;
+    if (out_tx) *out_tx = s ? s->tx_calls : 0;
+}
+
+#if RV_UDP_MMSG
+
+int rv_udp_recv_batch(rv_udp_socket_t* s, rv_udp_msg_t* msgs, int count) {
+    if (!s || !msgs || count <= 0) return -1;
+    if (count > RV_UDP_BATCH_MAX) count = RV_UDP_BATCH_MAX;
+
+    struct mmsghdr mh[RV_UDP_BATCH_MAX];
+    struct iovec iov[RV_UDP_BATCH_MAX];
+    struct sockaddr_storage ss[RV_UDP_BATCH_MAX];
+    memset(mh, 0, sizeof(mh[0]) * (size_t)count);
+
+    for (int i = 0; i < count; ++i) {
+        iov[i].iov_base = msgs[i].data;
+        iov[i].iov_len = (size_t)msgs[i].cap;
+        mh[i].msg_hdr.msg_iov = &iov[i];
+        mh[i].msg_hdr.msg_iovlen = 1;
+        mh[i].msg_hdr.msg_name = &ss[i];
+        mh[i].msg_hdr.msg_namelen = sizeof(ss[i]);
+    }
+
+    int n;
+    do {
+        s->rx_calls++;
+        n = recvmmsg(s->fd, mh, (unsigned)count, MSG_DONTWAIT, NULL);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        return -2;
+    }
+
+    for (int i = 0; i < n; ++i) {
+        msgs[i].len = (int)mh[i].msg_len;
+        if (mh[i].msg_hdr.msg_flags & MSG_TRUNC) msgs[i].len = 0;   // larger than cap
+        if (from_sockaddr(&ss[i], &msgs[i].addr) != 0) msgs[i].len = 0;
+    }
+    return n;
+}
+
+/*
+ * Adjacent messages to one destination with one length become a single
+ * GSO send: the kernel splits the iovec chain into gso_size datagrams.
+ * Fan-out (one packet, many destinations) is what sendmmsg covers; GSO
+ * pays off when one peer is sent a burst, e.g. load generators or links
+ * between relays.
+ */
+int rv_udp_send_batch(rv_udp_socket_t* s, const rv_udp_msg_t* msgs, int count) {
+    if (!s || !msgs || count <= 0) return -1;
+
+    struct mmsghdr mh[RV_UDP_BATCH_MAX];
+    struct iovec iov[RV_UDP_BATCH_MAX];
+    struct sockaddr_storage ss[RV_UDP_BATCH_MAX];
+    union {
+        char buf[CMSG_SPACE(sizeof(uint16_t))];
+        size_t align;               // cmsghdr alignment
+    } ctl[RV_UDP_BATCH_MAX];
+    int first[RV_UDP_BATCH_MAX];    // input index of each mmsghdr
+    int covers[RV_UDP_BATCH_MAX];   // input messages per mmsghdr
+
+    int sent = 0;
+    int i = 0;
+    while (i < count) {
+        int nmsg = 0, niov = 0, j = i;
+        memset(mh, 0, sizeof(mh));
+
+        while (j < count && niov < RV_UDP_BATCH_MAX) {
+            const rv_udp_msg_t* m = &msgs[j];
+            socklen_t sslen = 0;
+            if (m->len <= 0 || !m->data || to_sockaddr(s, &m->addr, &ss[nmsg], &sslen) != 0) {
+                j++;            // unsendable: dropped
+                continue;
+            }
+
+            int run = 1;
+            if (s->gso) {
+                int bytes = m->len;
+                while (j + run < count && run < RV_UDP_GSO_MAX_SEGS && niov + run < RV_UDP_BATCH_MAX &&
+                       bytes + m->len <= RV_UDP_GSO_MAX_BYTES) {
+                    const rv_udp_msg_t* n = &msgs[j + run];
+                    if (n->len != m->len || !n->data || !addr_equal(&n->addr, &m->addr)) break;
+                    bytes += m->len;
+                    run++;
+                }
+            }
+
+            for (int k = 0; k < run; ++k) {
+                iov[niov + k].iov_base = msgs[j + k].data;
+                iov[niov + k].iov_len = (size_t)m->len;
+            }
+
+            struct msghdr* h = &mh[nmsg].msg_hdr;
+            h->msg_name = &ss[nmsg];
+            h->msg_namelen = sslen;
+            h->msg_iov = &iov[niov];
+            h->msg_iovlen = (size_t)run;
+
+            if (run > 1) {
+                h->msg_control = ctl[nmsg].buf;
+                h->msg_controllen = sizeof(ctl[nmsg].buf);
+                struct cmsghdr* c = CMSG_FIRSTHDR(h);
+                c->cmsg_level = IPPROTO_UDP;
+                c->cmsg_type = UDP_SEGMENT;
+                c->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                const uint16_t seg = (uint16_t)m->len;
+                memcpy(CMSG_DATA(c), &seg, sizeof(seg));
+            }
+
+            first[nmsg] = j;
+            covers[nmsg] = run;
+            nmsg++;
+            niov += run;
+            j += run;
+        }
+
+        int h = 0;
+        while (h < nmsg) {
+            s->tx_calls++;
+            const int r = sendmmsg(s->fd, mh + h, (unsigned)(nmsg - h), 0);
+            if (r > 0) {
+                for (int k = h; k < h + r; ++k) sent += covers[k];
+                h += r;
+                continue;
+            }
+            if (r < 0 && errno == EINTR) continue;
+
+            // Kernel or device without UDP GSO: turn it off and rebuild
+            // from the message that failed.
+            if (r < 0 && s->gso && covers[h] > 1 && (errno == EINVAL || errno == EIO || errno == ENOPROTOOPT)) {
+                s->gso = 0;
+                break;
+            }
+            // A full socket buffer stops the rest; an error for one
+            // destination (unreachable, no scope id) drops only its message
+            if (r == 0 || errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) return sent;
+            h++;
+        }
+
+        i = h < nmsg ? first[h] : j;
+    }
+    return sent;
+}
+
+#else
+
+int rv_udp_recv_batch(rv_udp_socket_t* s, rv_udp_msg_t* msgs, int count) {
+    if (!s || !msgs || count <= 0) return -1;
+    int n = 0;
+    while (n < count) {
+        int r = rv_udp_recvfrom(s, &msgs[n].addr, msgs[n].data, msgs[n].cap);
+        if (r < 0) return n ? n : r;
+        if (r == 0) break;
+        msgs[n++].len = r;
+    }
+    return n;
+}
+
+int rv_udp_send_batch(rv_udp_socket_t* s, const rv_udp_msg_t* msgs, int count) {
+    if (!s || !msgs || count <= 0) return -1;
+    int sent = 0;
+    for (int i = 0; i < count; ++i) {
+        if (rv_udp_sendto(s, &msgs[i].addr, msgs[i].data, msgs[i].len) > 0) sent++;
+    }
+    return sent;
+}
+
+#endif
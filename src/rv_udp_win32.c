@@ -7,6 +7,8 @@
 
 struct rv_udp_socket {
     SOCKET sock;
+    uint64_t rx_calls;
+    uint64_t tx_calls;
 };
 
 int rv_udp_startup(void) {
@@ -50,16 +52,35 @@ rv_udp_socket_t* rv_udp_create_dualstack(uint16_t bind_port, int nonblocking) {
 
     rv_udp_socket_t* out = (rv_udp_socket_t*)malloc(sizeof(*out));
     if (!out) { closesocket(s); return NULL; }
+    memset(out, 0, sizeof(*out));
     out->sock = s;
     return out;
 }
 
+// Winsock has no load-balancing port sharing (SO_REUSEADDR lets one
+// socket take over the port instead)
+rv_udp_socket_t* rv_udp_create_reuseport(uint16_t bind_port, int nonblocking) {
+    (void)bind_port;
+    (void)nonblocking;
+    return NULL;
+}
+
 void rv_udp_destroy(rv_udp_socket_t* s) {
     if (!s) return;
     closesocket(s->sock);
     free(s);
 }
 
+int rv_udp_set_buffers(rv_udp_socket_t* s, int rcvbuf_bytes, int sndbuf_bytes) {
+    if (!s) return -1;
+    int r = 0;
+    if (rcvbuf_bytes > 0 &&
+        setsockopt(s->sock, SOL_SOCKET, SO_RCVBUF, (const char*)&rcvbuf_bytes, sizeof(rcvbuf_bytes)) != 0) r = -2;
+    if (sndbuf_bytes > 0 &&
+        setsockopt(s->sock, SOL_SOCKET, SO_SNDBUF, (const char*)&sndbuf_bytes, sizeof(sndbuf_bytes)) != 0) r = -2;
+    return r;
+}
+
 static int to_sockaddr(const rv_sockaddr_t* in, struct sockaddr_storage* ss, int* sslen) {
     memset(ss, 0, sizeof(*ss));
     if (in->ver == RV_IPV4) {
@@ -103,6 +124,7 @@ int rv_udp_sendto(rv_udp_socket_t* s, const rv_sockaddr_t* to, const uint8_t* da
     struct sockaddr_storage ss;
     int sslen = 0;
     if (to_sockaddr(to, &ss, &sslen) != 0) return -2;
+    s->tx_calls++;
     int r = sendto(s->sock, (const char*)data, len, 0, (struct sockaddr*)&ss, sslen);
     if (r == SOCKET_ERROR) return -3;
     return r;
@@ -113,6 +135,7 @@ int rv_udp_recvfrom(rv_udp_socket_t* s, rv_sockaddr_t* from, uint8_t* out, int o
 
     struct sockaddr_storage ss;
     int sslen = sizeof(ss);
+    s->rx_calls++;
     int r = recvfrom(s->sock, (char*)out, out_cap, 0, (struct sockaddr*)&ss, &sslen);
     if (r == SOCKET_ERROR) {
         int e = WSAGetLastError();
@@ -124,6 +147,19 @@ int rv_udp_recvfrom(rv_udp_socket_t* s, rv_sockaddr_t* from, uint8_t* out, int o
     return r;
 }
 
+int rv_udp_wait_readable(rv_udp_socket_t* s, int timeout_ms) {
+    if (!s) return -1;
+    WSAPOLLFD p;
+    p.fd = s->sock;
+    p.events = POLLRDNORM;
+    p.revents = 0;
+
+    s->rx_calls++;
+    const int r = WSAPoll(&p, 1, timeout_ms < 0 ? -1 : timeout_ms);
+    if (r == SOCKET_ERROR) return -2;
+    return r > 0 ? 1 : 0;
+}
+
 int rv_parse_ip_port(const char* host, uint16_t port, rv_sockaddr_t* out) {
     if (!host || !out) return -1;
 
@@ -147,3 +183,30 @@ int rv_parse_ip_port(const char* host, uint16_t port, rv_sockaddr_t* out) {
 
     return -2;
 }
+
+// No recvmmsg / sendmmsg on Windows: one call per datagram
+int rv_udp_recv_batch(rv_udp_socket_t* s, rv_udp_msg_t* msgs, int count) {
+    if (!s || !msgs || count <= 0) return -1;
+    int n = 0;
+    while (n < count) {
+        int r = rv_udp_recvfrom(s, &msgs[n].addr, msgs[n].data, msgs[n].cap);
+        if (r < 0) return n ? n : r;
+        if (r == 0) break;
+        msgs[n++].len = r;
+    }
+    return n;
+}
+
+int rv_udp_send_batch(rv_udp_socket_t* s, const rv_udp_msg_t* msgs, int count) {
+    if (!s || !msgs || count <= 0) return -1;
+    int sent = 0;
+    for (int i = 0; i < count; ++i) {
+        if (rv_udp_sendto(s, &msgs[i].addr, msgs[i].data, msgs[i].len) > 0) sent++;
+    }
+    return sent;
+}
+
+void rv_udp_syscall_counts(const rv_udp_socket_t* s, uint64_t* out_rx, uint64_t* out_tx) {
+    if (out_rx) *out_rx = s ? s->rx_calls : 0;
+    if (out_tx) *out_tx = s ? s->tx_calls : 0;
+}
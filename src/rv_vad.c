@@ -0,0 +1,152 @@
+#include "rv_vad.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RV_VAD_SSE2 1
+#else
+#define RV_VAD_SSE2 0
+#endif
+
+// Loud frames (energy above floor by this ratio) count as speech whatever
+// their zero-crossing rate, so fricatives ("s", "f") keep the gate open.
+#define RV_VAD_STRONG_SNR 10.0f
+
+// Marginal frames only count as speech when they are tonal; broadband
+// noise (fans, hiss) crosses zero on a large fraction of samples.
+#define RV_VAD_WEAK_SNR   3.0f
+#define RV_VAD_NOISE_ZCR  0.25f
+
+#define RV_VAD_FLOOR_MIN  100.0f
+
+void rv_vad_init(rv_vad_t* vad, uint32_t frame_ms, uint32_t hangover_ms)
+{
+    if (!vad) return;
+
+    if (frame_ms == 0) frame_ms = 20u;
+
+    vad->hangover_frames = (hangover_ms + frame_ms - 1u) / frame_ms;
+    vad->hangover_left = 0;
+    vad->noise_floor = RV_VAD_MIN_ENERGY * 0.25f;
+    vad->last_energy = 0.0f;
+    vad->active = 0;
+}
+
+void rv_vad_analyze(const int16_t* pcm, uint32_t n,
+                    uint64_t* out_energy, uint32_t* out_zero_crossings)
+{
+    uint64_t energy = 0;
+    uint32_t zc = 0;
+    uint32_t i = 0;
+
+#if RV_VAD_SSE2
+    /*
+     * 8 samples per step. Squares are taken on x/2 so two products fit a
+     * signed 32-bit madd lane, then widened into 64-bit accumulators.
+     * A sign change between x[i] and x[i+1] shows up as a negative xor,
+     * which srai turns into -1 per lane.
+     */
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+
+    while (i + 8u < n) {
+        __m128i zacc = _mm_setzero_si128();
+        uint32_t steps = 0;
+
+        for (; i + 8u < n && steps < 4096u; i += 8u, ++steps) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(const void*)(pcm + i));
+            __m128i b = _mm_loadu_si128((const __m128i*)(const void*)(pcm + i + 1));
+
+            __m128i h = _mm_srai_epi16(a, 1);
+            __m128i sq = _mm_madd_epi16(h, h);
+            acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(sq, zero));
+            acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(sq, zero));
+
+            zacc = _mm_sub_epi16(zacc, _mm_srai_epi16(_mm_xor_si128(a, b), 15));
+        }
+
+        int16_t lanes[8];
+        _mm_storeu_si128((__m128i*)(void*)lanes, zacc);
+        for (int k = 0; k < 8; ++k) zc += (uint32_t)lanes[k];
+    }
+
+    uint64_t acc64[2];
+    _mm_storeu_si128((__m128i*)(void*)acc64, acc);
+    energy = (acc64[0] + acc64[1]) << 2;
+#endif
+
+    for (; i < n; ++i) {
+        int32_t x = pcm[i];
+        energy += (uint64_t)(x * x);
+        if (i + 1u < n && ((pcm[i] ^ pcm[i + 1u]) < 0)) zc++;
+    }
+
+    if (out_energy) *out_energy = energy;
+    if (out_zero_crossings) *out_zero_crossings = zc;
+}
+
+uint8_t rv_vad_level(float mean_square)
+{
+    if (!(mean_square >= 1.0f)) return 127u;
+    const uint64_t ms = (uint64_t)(mean_square + 0.5f);
+
+    // log2 in Q8: bit length plus the next 8 bits as a linear fraction
+    uint32_t e = 0;
+    while (e < 63u && (ms >> (e + 1u)) != 0) e++;
+    const uint32_t frac = (uint32_t)(e >= 8u ? ms >> (e - 8u) : ms << (8u - e)) & 0xFFu;
+    const int32_t log2_q8 = (int32_t)(e * 256u + frac);
+
+    // Full scale (32767^2) is 2^30; 10*log10(2) = 3.0103 ~ 771 / 2^8 in Q8
+    int32_t d = 30 * 256 - log2_q8;
+    if (d < 0) d = 0;
+    const int32_t level = (d * 771 + 32768) >> 16;
+    return (uint8_t)(level > 127 ? 127 : level);
+}
+
+int rv_vad_process(rv_vad_t* vad, const int16_t* pcm, uint32_t n)
+{
+    if (!vad || !pcm || n == 0) return 1;
+
+    uint64_t sum = 0;
+    uint32_t zc = 0;
+    rv_vad_analyze(pcm, n, &sum, &zc);
+
+    const float energy = (float)sum / (float)n;
+    const float zcr = (float)zc / (float)n;
+    vad->last_energy = energy;
+
+    int speech = 0;
+    if (energy > RV_VAD_MIN_ENERGY) {
+        const float snr = energy / vad->noise_floor;
+        if (snr > RV_VAD_STRONG_SNR) speech = 1;
+        else if (snr > RV_VAD_WEAK_SNR && zcr < RV_VAD_NOISE_ZCR) speech = 1;
+    }
+
+    /*
+     * Noise floor: follow quiet frames down quickly, rise slowly through
+     * non-speech and noise-like (high ZCR) frames, and creep up during
+     * tonal speech so a permanent step in background level eventually
+     * stops reading as talk.
+     */
+    if (energy < vad->noise_floor) {
+        vad->noise_floor += (energy - vad->noise_floor) * 0.2f;
+    } else if (!speech || zcr >= RV_VAD_NOISE_ZCR) {
+        vad->noise_floor += (energy - vad->noise_floor) * 0.02f;
+    } else {
+        vad->noise_floor *= 1.005f;
+    }
+    if (vad->noise_floor < RV_VAD_FLOOR_MIN) vad->noise_floor = RV_VAD_FLOOR_MIN;
+
+    if (speech) {
+        vad->active = 1;
+        vad->hangover_left = vad->hangover_frames;
+        return 1;
+    }
+
+    if (vad->hangover_left > 0) {
+        vad->hangover_left--;
+        return 1;
+    }
+
+    vad->active = 0;
+    return 0;
+}
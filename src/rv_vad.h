@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+
+#ifndef RV_VAD_HANGOVER_MS
+#define RV_VAD_HANGOVER_MS 300u
+#endif
+
+// Mean-square energy below which a frame is never treated as speech
+// (about -54 dBFS RMS).
+#ifndef RV_VAD_MIN_ENERGY
+#define RV_VAD_MIN_ENERGY 4000.0f
+#endif
+
+typedef struct rv_vad {
+    uint32_t hangover_frames;   // frames kept open after speech ends
+    uint32_t hangover_left;
+    float    noise_floor;       // tracked background mean-square energy
+    float    last_energy;       // mean-square energy of the last frame
+    uint8_t  active;            // 1 while speech (or hangover) is open
+} rv_vad_t;
+
+void rv_vad_init(rv_vad_t* vad, uint32_t frame_ms, uint32_t hangover_ms);
+
+// Sum of squares and zero-crossing count of one frame.
+void rv_vad_analyze(const int16_t* pcm, uint32_t n,
+                    uint64_t* out_energy, uint32_t* out_zero_crossings);
+
+// Audio level of a frame from its mean-square energy: -dBov of the RMS,
+// 0 (full scale) to 127 (silence), to within a dB.
+uint8_t rv_vad_level(float mean_square);
+
+// Returns 1 if the frame should be transmitted (speech or hangover),
+// 0 if it is background noise / silence.
+int rv_vad_process(rv_vad_t* vad, const int16_t* pcm, uint32_t n);
@@ -3,8 +3,13 @@
 
 #include "rv_opus.h"
 #include "rv_opus_jitter.h"
+#include "rv_stats.h"
 #include "rv_netproto.h"
 #include "rv_event_queue.h"
+#include "rv_vad.h"
+#include "rv_enc_ctl.h"
+#include "rv_time.h"
+#include "rv_crypto.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -27,6 +32,49 @@
 #define RV_MAX_PKT_SIZE 1400u
 #endif
 
+#ifndef RV_RED_BITRATE
+#define RV_RED_BITRATE 8000
+#endif
+
+#define RV_PACK_MAX_FRAMES 3u
+
+#ifndef RV_REPORT_INTERVAL_MS
+#define RV_REPORT_INTERVAL_MS 1000u
+#endif
+
+// Peer reports older than this no longer count toward remote loss / RTT
+#define RV_REPORT_STALE_MS (3u * RV_REPORT_INTERVAL_MS)
+
+#ifndef RV_INTEREST_REFRESH_MS
+#define RV_INTEREST_REFRESH_MS 2000u
+#endif
+
+// Changes are coalesced to at most one INTEREST per this interval
+#define RV_INTEREST_MIN_GAP_MS 100u
+
+// The JOIN is resent this often, well inside the relay's idle timeout
+#ifndef RV_KEEPALIVE_INTERVAL_MS
+#define RV_KEEPALIVE_INTERVAL_MS 5000u
+#endif
+
+#define RV_JOIN_CAPS (RV_CAP_V2 | RV_CAP_BUNDLE)
+
+// RED history also holds the frames of the packet being assembled
+#define RV_RED_HIST (RV_RED_MAX_DEPTH + RV_PACK_MAX_FRAMES)
+
+/* ============================================================
+   What a peer last reported about our stream (RV_PKT_REPORT)
+   ============================================================ */
+typedef struct rv_peer_tx {
+    uint8_t  has_report;
+    uint8_t  fresh;              // arrived since the controller last looked
+    uint8_t  loss_pct;
+    uint32_t lost;
+    uint32_t jitter_us;
+    uint32_t rtt_us;             // EWMA, 0 = unknown
+    uint32_t last_report_ms;
+} rv_peer_tx_t;
+
 /* ============================================================
    Internal packet queue (engine -> host transport)
    ============================================================ */
@@ -105,36 +153,90 @@ struct rv_voice {
 
     uint64_t session_id;
     uint16_t player_id;
+    uint8_t  wire_ver;           // header version for sent voice (JOIN_ACK)
+    uint16_t keepalives;         // JOINs resent since connect
+    uint32_t keepalive_ms;       // when the last one (or the JOIN) went out
+    int      keepalive_clock_started;
 
     rv_opus_config_t opus_cfg;
 
     rv_opus_enc_t* enc;
-    rv_opus_dec_t** dec;         // [max_players]
-    rv_opus_jitter_t* jb;        // [max_players]
-
-    int16_t**  pcm_buf;          // [max_players] decoded frame per speaker
-    uint32_t*  pcm_count;        // [max_players] decoded samples per frame
+    rv_enc_ctl_t enc_ctl;
+    int enc_adaptive;
+
+    // Redundancy (RED): low-bitrate copies of the last frames ride along
+    rv_opus_enc_t* red_enc;      // created on first use
+    uint32_t red_depth;          // host setting (ceiling when adaptive)
+    uint8_t  red_hist[RV_RED_HIST][RV_RED_MAX_BLOCK];
+    uint8_t  red_hist_len[RV_RED_HIST];
+    uint16_t red_hist_seq[RV_RED_HIST];
+    uint32_t red_hist_count;     // valid entries, newest first
+
+    // Multi-frame packing: encoded frames waiting to share one packet
+    uint32_t frames_per_packet;
+    uint8_t  pack_buf[RV_PACK_MAX_FRAMES][RV_OPUS_MAX_PACKET];
+    uint16_t pack_len[RV_PACK_MAX_FRAMES];
+    uint32_t pack_count;
+    uint16_t pack_seq;           // seq of pack_buf[0]
+    uint16_t pack_roc;           // seq_roc at pack_buf[0]
+    uint8_t  pack_flags;
+    uint8_t  pack_level;         // loudest frame in the pack, -dBov
+
+    // Per-speaker state is indexed by speaker_id - 1; a relay mix
+    // (RV_VOICE_MIX_SPEAKER_ID) takes the slot after the players
+    rv_opus_dec_t** dec;         // [slots]
+    rv_opus_jitter_t* jb;        // [slots]
+
+    int16_t**  pcm_buf;          // [slots] decoded frame per speaker
+    uint32_t*  pcm_count;        // [slots] decoded samples per frame
     uint32_t   frame_samples;    // samples per channel per frame
 
     // Thread-safe capture queue (audio thread -> voice thread)
     rv_spsc_pcm_ring_t cap_q;
 
-    uint8_t*   speaking;         // [max_players]
-    uint32_t*  last_rx_ms;        // [max_players]
+    uint8_t*   speaking;         // [slots]
+    uint32_t*  last_rx_ms;        // [slots]
 
     // Remember latest rx flags per speaker so host can route PCM events
-    uint8_t*   last_rx_flags;     // [max_players]
+    uint8_t*   last_rx_flags;     // [slots]
+
+    // Telemetry
+    rv_rx_stats_t* rx_stats;     // [slots] measured on their streams
+    rv_peer_tx_t*  peer_tx;      // [max_players] reported about ours
+    uint32_t last_report_ms;
+    int      report_clock_started;
+    uint32_t tx_packets, tx_bytes;
+    uint32_t rx_packets, rx_bytes;
+    uint32_t rx_auth_failures;
+
+    // Payload encryption (RV_EXT_ENC), on once the host sets a session key
+    int has_key;
+    rv_aead_key_t key;
+    rv_replay_t* rx_replay;      // [max_players]
 
     // Local state (PTT, radio mode, channel)
     rv_voice_player_state_t local_state;
     int has_local_state;
 
+    // Relay interest (RV_PKT_INTEREST), resent while connected
+    rv_interest_t interest;
+    int has_interest;
+    int interest_dirty;
+    int interest_sent;           // since connect
+    uint32_t interest_sent_ms;
+
     // Outgoing network packets (voice -> transport)
     rv_out_pkt_t out_q[RV_MAX_OUT_PKTS];
     uint32_t out_r;
     uint32_t out_w;
 
     uint16_t seq;
+    uint16_t seq_roc;            // seq wraps; high bits of the packet index
+
+    // Outgoing silence suppression
+    rv_vad_t vad;
+    int vad_enabled;
+    int tx_gap;                  // frames were skipped since the last sent packet
 
     // Events
     rv_event_queue_t evq;
@@ -167,6 +269,14 @@ static void rv_free_mem(rv_voice_t* v, void* p) {
     rv_free_raw(v ? &v->allocs : NULL, p);
 }
 
+static uint32_t rv_slot_count(const rv_voice_t* v) {
+    return v->cfg.max_players + 1u;
+}
+
+static uint16_t rv_slot_speaker(const rv_voice_t* v, uint32_t slot) {
+    return slot == v->cfg.max_players ? (uint16_t)RV_VOICE_MIX_SPEAKER_ID : (uint16_t)(slot + 1u);
+}
+
 static char* rv_next_msg_buf(rv_voice_t* v) {
     char* buf = v->msg_buf[v->msg_flip & 1u];
     v->msg_flip++;
@@ -225,6 +335,17 @@ static int out_push(rv_voice_t* v, const uint8_t* data, uint32_t len) {
     return 1;
 }
 
+// Build in place: reserve the next slot, write into it, then commit.
+static rv_out_pkt_t* out_reserve(rv_voice_t* v) {
+    if (out_count(v) >= RV_MAX_OUT_PKTS) return NULL;
+    return &v->out_q[v->out_w % RV_MAX_OUT_PKTS];
+}
+
+static void out_commit(rv_voice_t* v, uint32_t len) {
+    v->out_q[v->out_w % RV_MAX_OUT_PKTS].len = (uint16_t)len;
+    v->out_w++;
+}
+
 static int out_pop(rv_voice_t* v, uint8_t* out, uint32_t cap, uint32_t* out_len) {
     if (!v || !out || !out_len) return -1;
     if (v->out_r == v->out_w) return 0;
@@ -277,41 +398,377 @@ static inline int rv_capture_should_transmit(const rv_voice_t* v) {
     return 1;
 }
 
+/* ============================================================
+   Encoder control
+   ============================================================ */
+
+static void rv_enc_ctl_apply(rv_voice_t* v) {
+    rv_opus_config_t cfg = *rv_opus_enc_config(v->enc);
+    if (rv_enc_ctl_update(&v->enc_ctl, &cfg)) {
+        (void)rv_opus_enc_apply(v->enc, &cfg);
+    }
+}
+
+static uint32_t rv_red_depth(const rv_voice_t* v) {
+    if (!v->red_enc) return 0;
+    return v->enc_adaptive ? (uint32_t)v->enc_ctl.red_depth : v->red_depth;
+}
+
+// Encode the low-bitrate copy of the frame just sent as `seq`.
+static void rv_red_remember(rv_voice_t* v, const int16_t* samples, uint32_t sample_count, uint16_t seq) {
+    uint8_t block[RV_RED_MAX_BLOCK];
+    int len = rv_opus_encode(v->red_enc, samples, (int)sample_count, block, (int)sizeof(block));
+
+    // newest first
+    for (uint32_t k = RV_RED_HIST - 1; k > 0; --k) {
+        memcpy(v->red_hist[k], v->red_hist[k - 1], v->red_hist_len[k - 1]);
+        v->red_hist_len[k] = v->red_hist_len[k - 1];
+        v->red_hist_seq[k] = v->red_hist_seq[k - 1];
+    }
+
+    // encoder failure or DTX leaves nothing usable for this seq
+    if (len <= 2) len = 0;
+    memcpy(v->red_hist[0], block, (size_t)len);
+    v->red_hist_len[0] = (uint8_t)len;
+    v->red_hist_seq[0] = seq;
+    if (v->red_hist_count < RV_RED_HIST) v->red_hist_count++;
+}
+
+/* ============================================================
+   Payload encryption (RV_EXT_ENC)
+   ============================================================ */
+
+// Seal a built VOICE packet in place. Returns the new length or <0.
+static int rv_voice_seal(rv_voice_t* v, uint8_t* pkt, int len, int cap, uint16_t seq, uint16_t roc) {
+    int aad_len = 0;
+    len = rv_pkt_enc_prepare(pkt, len, cap, roc, &aad_len);
+    if (len <= 0) return len;
+
+    uint8_t nonce[RV_AEAD_NONCE_LEN];
+    rv_aead_voice_nonce(nonce, v->player_id, ((uint64_t)roc << 16) | seq);
+
+    uint8_t* pt = pkt + aad_len;
+    const size_t pt_len = (size_t)(len - aad_len - RV_ENC_TAG_LEN);
+    rv_aead_seal(&v->key, nonce, pkt, (size_t)aad_len, pt, pt, pt_len, pt + pt_len);
+    return len;
+}
+
+// Authenticate and decrypt into plain, then point the view at it.
+// Replays and forgeries are rejected before anything is decrypted.
+static int rv_voice_open(rv_voice_t* v, rv_pkt_view_t* pv, uint8_t* plain, uint32_t plain_cap) {
+    uint16_t roc = 0, aad_len = 0, ct_len = 0;
+    const uint8_t* aad = NULL;
+    const uint8_t* ct = NULL;
+    const uint8_t* tag = NULL;
+    if (rv_pkt_view_enc(pv, &roc, &aad, &aad_len, &ct, &ct_len, &tag) != 0) return -1;
+    if (ct_len > plain_cap) return -1;
+
+    const uint64_t index = ((uint64_t)roc << 16) | pv->seq;
+    rv_replay_t* rp = &v->rx_replay[pv->speaker_id - 1u];
+    if (!rv_replay_check(rp, index)) return -1;
+
+    uint8_t nonce[RV_AEAD_NONCE_LEN];
+    rv_aead_voice_nonce(nonce, pv->speaker_id, index);
+    if (rv_aead_open(&v->key, nonce, aad, aad_len, ct, plain, ct_len, tag) != 0) return -1;
+
+    rv_replay_accept(rp, index);
+    pv->payload = plain;
+    pv->payload_len = ct_len;
+    pv->ext = (uint8_t)(pv->ext & ~RV_EXT_ENC);
+    return 0;
+}
+
+// Send the pending frames. Normally one packet; more only if the encoder
+// changed configuration mid-pack and the frames cannot share a TOC.
+static rv_voice_result_t rv_flush_voice(rv_voice_t* v) {
+    const uint32_t red_depth = rv_red_depth(v);
+    uint32_t done = 0;
+
+    while (done < v->pack_count) {
+        const uint8_t* frames[RV_PACK_MAX_FRAMES];
+        for (uint32_t k = done; k < v->pack_count; ++k) frames[k - done] = v->pack_buf[k];
+
+        uint8_t opus[RV_MAX_PKT_SIZE];
+        int consumed = 0;
+        int olen = rv_opus_enc_pack(v->enc, frames, v->pack_len + done, (int)(v->pack_count - done),
+                                    &consumed, opus, (int)sizeof(opus));
+        if (olen <= 0 || consumed <= 0) {
+            v->pack_count = 0;
+            rv_emit_error(v, RV_VOICE_ERR_INTERNAL, "opus repacketize failed");
+            return RV_VOICE_ERR_INTERNAL;
+        }
+
+        const uint16_t seq = (uint16_t)(v->pack_seq + done);
+        const uint8_t flags = done == 0 ? v->pack_flags : (uint8_t)(v->pack_flags & ~RV_FLAG_TALKSPURT);
+
+        // Redundant copies of the frames just before this packet
+        rv_red_block_t red[RV_RED_MAX_DEPTH];
+        int red_count = 0;
+        for (uint32_t k = 0; k < v->red_hist_count && red_count < RV_RED_MAX_DEPTH; ++k) {
+            const uint16_t off = (uint16_t)(seq - v->red_hist_seq[k]);
+            if (off == 0 || off > red_depth || v->red_hist_len[k] == 0) continue;
+            red[red_count].seq_offset = (uint8_t)off;
+            red[red_count].len = v->red_hist_len[k];
+            red[red_count].data = v->red_hist[k];
+            red_count++;
+        }
+
+        // Sender timestamp for receiver jitter / RTT and the audio level
+        // for the relay's speaker ranking. Only once the session negotiated
+        // v2: every member then knows both extensions.
+        const uint32_t ts_us = (uint32_t)rv_time_now_us();
+        const uint32_t* ts = v->wire_ver == RV_PROTO_VER2 ? &ts_us : NULL;
+        const uint8_t* level = v->wire_ver == RV_PROTO_VER2 ? &v->pack_level : NULL;
+
+        rv_out_pkt_t* slot = out_reserve(v);
+        if (!slot) {
+            done += (uint32_t)consumed;
+            // dropping is expected under congestion; keep engine realtime
+            rv_emit_log(v, 1, "outgoing queue full (dropping voice)");
+            continue;
+        }
+
+        // Built and sealed directly in the queue slot
+        int pkt_len = rv_build_voice_packet_red(slot->data, (int)sizeof(slot->data),
+                                               v->wire_ver,
+                                               v->player_id, seq,
+                                               flags,
+                                               ts,
+                                               level,
+                                               red, red_count,
+                                               opus, (uint16_t)olen);
+        if (pkt_len > 0 && v->has_key) {
+            const uint16_t roc = (uint16_t)(v->pack_roc + (seq < v->pack_seq ? 1u : 0u));
+            pkt_len = rv_voice_seal(v, slot->data, pkt_len, (int)sizeof(slot->data), seq, roc);
+        }
+        done += (uint32_t)consumed;
+
+        if (pkt_len <= 0) {
+            v->pack_count = 0;
+            rv_emit_error(v, RV_VOICE_ERR_INTERNAL, "build voice packet failed");
+            return RV_VOICE_ERR_INTERNAL;
+        }
+
+        out_commit(v, (uint32_t)pkt_len);
+
+        v->tx_packets++;
+        v->tx_bytes += (uint32_t)pkt_len;
+        v->tx_gap = 0;
+    }
+
+    v->pack_count = 0;
+    return RV_VOICE_OK;
+}
+
+// Start of a transmit gap: send what is pending, then mark the gap.
+static void rv_voice_gap(rv_voice_t* v) {
+    if (v->pack_count) (void)rv_flush_voice(v);
+    v->tx_gap = 1;
+}
+
 static rv_voice_result_t rv_encode_and_queue_voice(rv_voice_t* v,
                                                   const int16_t* samples,
                                                   uint32_t sample_count)
 {
-    if (!rv_capture_should_transmit(v)) return RV_VOICE_OK;
+    if (!rv_capture_should_transmit(v)) {
+        rv_voice_gap(v);
+        return RV_VOICE_OK;
+    }
 
-    uint8_t opus[RV_OPUS_MAX_PACKET];
-    int olen = rv_opus_encode(v->enc, samples, (int)sample_count, opus, (int)sizeof(opus));
+    // Silence: skip the encoder entirely and do not advance seq, so the
+    // receiver sees a contiguous stream and never has a hole to conceal.
+    if (v->vad_enabled && !rv_vad_process(&v->vad, samples, sample_count)) {
+        rv_voice_gap(v);
+        return RV_VOICE_OK;
+    }
+
+    uint8_t* opus = v->pack_buf[v->pack_count];
+    const uint64_t enc_start_us = v->enc_adaptive ? rv_time_now_us() : 0;
+    int olen = rv_opus_encode(v->enc, samples, (int)sample_count, opus, RV_OPUS_MAX_PACKET);
+    if (v->enc_adaptive) {
+        rv_enc_ctl_on_encode_time(&v->enc_ctl, (uint32_t)(rv_time_now_us() - enc_start_us));
+        rv_enc_ctl_apply(v);
+    }
     if (olen <= 0) {
         rv_emit_error(v, RV_VOICE_ERR_INTERNAL, "opus encode failed");
         return RV_VOICE_ERR_INTERNAL;
     }
 
-    uint8_t flags = 0;
-    rv_get_tx_flags(v, NULL, NULL, NULL, &flags);
+    // DTX frame (TOC only): nothing worth sending
+    if (olen <= 2) {
+        rv_voice_gap(v);
+        return RV_VOICE_OK;
+    }
 
-    uint8_t pkt[RV_MAX_PKT_SIZE];
-    uint16_t seq = v->seq++;
+    // The VAD already measured the frame; otherwise it is one cheap pass
+    uint8_t level = RV_LEVEL_SILENT;
+    if (v->wire_ver == RV_PROTO_VER2) {
+        float mean_square = v->vad.last_energy;
+        if (!v->vad_enabled) {
+            uint64_t sum = 0;
+            rv_vad_analyze(samples, sample_count, &sum, NULL);
+            mean_square = (float)sum / (float)sample_count;
+        }
+        level = rv_vad_level(mean_square);
+    }
 
-    int pkt_len = rv_build_voice_packet_ex(pkt, (int)sizeof(pkt),
-                                          v->player_id, seq,
-                                          flags,
-                                          opus, (uint16_t)olen);
-    if (pkt_len <= 0) {
-        rv_emit_error(v, RV_VOICE_ERR_INTERNAL, "build voice packet failed");
-        return RV_VOICE_ERR_INTERNAL;
+    if (v->pack_count == 0) {
+        // History from before a transmit gap belongs to a talkspurt the
+        // receiver has already left.
+        if (v->tx_gap) v->red_hist_count = 0;
+
+        uint8_t flags = 0;
+        rv_get_tx_flags(v, NULL, NULL, NULL, &flags);
+        if (v->tx_gap) flags |= RV_FLAG_TALKSPURT;
+
+        v->pack_seq = v->seq;
+        v->pack_roc = v->seq_roc;
+        v->pack_flags = flags;
+        v->pack_level = level;
     }
 
-    if (!out_push(v, pkt, (uint32_t)pkt_len)) {
-        // dropping is expected under congestion; keep engine realtime
-        rv_emit_log(v, 1, "outgoing queue full (dropping voice)");
-        return RV_VOICE_OK;
+    if (level < v->pack_level) v->pack_level = level;
+
+    const uint16_t seq = v->seq++;
+    if (v->seq == 0) v->seq_roc++;
+    v->pack_len[v->pack_count++] = (uint16_t)olen;
+
+    if (rv_red_depth(v) > 0) rv_red_remember(v, samples, sample_count, seq);
+    else v->red_hist_count = 0;
+
+    const uint32_t fpp = v->frames_per_packet ? v->frames_per_packet : 1u;
+    if (v->pack_count < fpp) return RV_VOICE_OK;
+
+    return rv_flush_voice(v);
+}
+
+/* ============================================================
+   Telemetry (RV_PKT_REPORT)
+   ============================================================ */
+
+static void rv_on_report(rv_voice_t* v, uint16_t reporter_id, const rv_report_t* rep, uint32_t now_ms) {
+    if (reporter_id == 0 || reporter_id > (uint16_t)v->cfg.max_players) return;
+    rv_peer_tx_t* p = &v->peer_tx[reporter_id - 1u];
+
+    p->has_report = 1;
+    p->fresh = 1;
+    p->loss_pct = (uint8_t)(((uint32_t)rep->fraction_lost * 100u + 128u) >> 8);
+    p->lost = rep->cumulative_lost;
+    p->jitter_us = rep->jitter_us;
+    p->last_report_ms = now_ms;
+
+    // RTT = now - (our timestamp they echoed) - (time they held it)
+    if (rep->lsr_us != 0) {
+        const uint32_t rtt = (uint32_t)rv_time_now_us() - rep->lsr_us - rep->dlsr_us;
+        if ((int32_t)rtt >= 0) p->rtt_us = p->rtt_us ? (p->rtt_us * 7u + rtt) / 8u : rtt;
     }
+}
 
-    return RV_VOICE_OK;
+// One REPORT per active sender, then hand the worst fresh remote loss to
+// the adaptive controller: the bitrate has to work for every listener.
+static void rv_report_tick(rv_voice_t* v, uint32_t now_ms) {
+    if (!v->report_clock_started) {
+        v->report_clock_started = 1;
+        v->last_report_ms = now_ms;
+        return;
+    }
+    if (now_ms - v->last_report_ms < RV_REPORT_INTERVAL_MS) return;
+    v->last_report_ms = now_ms;
+
+    const uint64_t now_us = rv_time_now_us();
+    const uint32_t n = v->cfg.max_players;
+
+    for (uint32_t i = 0; i < n && v->connected; ++i) {
+        rv_rx_stats_t* st = &v->rx_stats[i];
+        if (!st->started || st->received == st->received_prior) continue;
+        if ((uint16_t)(i + 1u) == v->player_id) continue;
+
+        rv_report_t rep;
+        rep.target_id = (uint16_t)(i + 1u);
+        rep.fraction_lost = rv_rx_stats_close_interval(st);
+        rep.cumulative_lost = rv_rx_stats_lost(st);
+        rep.highest_seq = rv_rx_stats_highest_seq(st);
+        rep.jitter_us = rv_rx_stats_jitter_us(st);
+        rep.lsr_us = st->has_ts ? st->last_ts : 0;
+        rep.dlsr_us = st->has_ts ? (uint32_t)(now_us - st->last_ts_arrival_us) : 0;
+
+        uint8_t pkt[64];
+        int pkt_len = rv_build_report_packet(pkt, (int)sizeof(pkt), v->wire_ver, v->player_id, &rep);
+        if (pkt_len > 0) (void)out_push(v, pkt, (uint32_t)pkt_len);
+    }
+
+    int any = 0;
+    uint32_t worst = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        rv_peer_tx_t* p = &v->peer_tx[i];
+        if (!p->fresh) continue;
+        p->fresh = 0;
+        any = 1;
+        if (p->loss_pct > worst) worst = p->loss_pct;
+    }
+    if (any && v->enc_adaptive) {
+        rv_enc_ctl_on_loss_report(&v->enc_ctl, (float)worst / 100.0f);
+        rv_enc_ctl_apply(v);
+    }
+}
+
+/* ============================================================
+   Relay interest (RV_PKT_INTEREST)
+   ============================================================ */
+
+// Whole units, saturated to what the wire carries; NaN lands on lo
+static int32_t rv_interest_coord(float x, float lo, float hi) {
+    if (!(x > lo)) return (int32_t)lo;
+    if (x >= hi) return (int32_t)hi;
+    return (int32_t)(x >= 0.0f ? x + 0.5f : x - 0.5f);
+}
+
+// Send on change (rate limited) and refresh now and then, so a relay that
+// restarted or evicted us learns it again without the host doing anything.
+static void rv_interest_tick(rv_voice_t* v, uint32_t now_ms) {
+    if (!v->has_interest || !v->connected) return;
+
+    if (v->interest_sent) {
+        const uint32_t since = now_ms - v->interest_sent_ms;
+        if (since < (v->interest_dirty ? RV_INTEREST_MIN_GAP_MS : RV_INTEREST_REFRESH_MS)) return;
+    }
+
+    uint8_t pkt[64];
+    int pkt_len = rv_build_interest_packet(pkt, (int)sizeof(pkt), v->wire_ver, v->player_id, &v->interest);
+    if (pkt_len <= 0 || !out_push(v, pkt, (uint32_t)pkt_len)) return;
+
+    v->interest_dirty = 0;
+    v->interest_sent = 1;
+    v->interest_sent_ms = now_ms;
+}
+
+// A relay mix comes in RV_MIX_FRAME_MS frames, which only a decoder set
+// up for that frame length plays in step
+static uint16_t rv_join_caps(const rv_voice_t* v) {
+    return (uint16_t)(RV_JOIN_CAPS | (v->cfg.frame_ms == RV_MIX_FRAME_MS ? RV_CAP_MIX : 0u));
+}
+
+// The relay drops members it has not heard from in a while, and a silent
+// listener sends nothing else. A relay that restarted or evicted us takes
+// the keepalive as a JOIN.
+static void rv_keepalive_tick(rv_voice_t* v, uint32_t now_ms) {
+    if (!v->connected) return;
+    if (!v->keepalive_clock_started) {
+        v->keepalive_clock_started = 1;
+        v->keepalive_ms = now_ms;
+        return;
+    }
+    if (now_ms - v->keepalive_ms < RV_KEEPALIVE_INTERVAL_MS) return;
+
+    uint16_t count = (uint16_t)(v->keepalives + 1u);
+    if (count == 0) count = 1;
+    uint8_t pkt[64];
+    int pkt_len = rv_build_keepalive_packet(pkt, (int)sizeof(pkt), v->session_id, v->player_id,
+                                            rv_join_caps(v), count);
+    if (pkt_len <= 0 || !out_push(v, pkt, (uint32_t)pkt_len)) return;
+
+    v->keepalives = count;
+    v->keepalive_ms = now_ms;
 }
 
 /* ============================================================
@@ -353,7 +810,21 @@ rv_voice_t* rv_voice_create(const rv_voice_config_t* cfg,
     v->opus_cfg.channels     = 1;
     v->opus_cfg.frame_ms     = (int)v->cfg.frame_ms;
     v->opus_cfg.bitrate_bps  = 20000;
-    v->opus_cfg.use_fec      = 0;
+    v->opus_cfg.use_fec      = 1;
+    v->opus_cfg.complexity   = 9;
+    v->opus_cfg.expected_loss_pct = 5;
+    v->opus_cfg.signal       = RV_OPUS_SIGNAL_AUTO;
+
+    // Sanitize vad_mode (callers older than API 2.2 leave it zero = AUTO)
+    if (v->cfg.vad_mode == RV_VOICE_VAD_ON) {
+        v->vad_enabled = 1;
+    } else if (v->cfg.vad_mode == RV_VOICE_VAD_OFF) {
+        v->vad_enabled = 0;
+    } else {
+        v->cfg.vad_mode = RV_VOICE_VAD_AUTO;
+        v->vad_enabled = (v->cfg.capture_mode == RV_VOICE_CAPTURE_ALWAYS_ON) ? 1 : 0;
+    }
+    v->opus_cfg.use_dtx      = v->vad_enabled;
 
     v->frame_samples = (v->cfg.sample_rate_hz * v->cfg.frame_ms) / 1000u;
     if (v->frame_samples == 0 || v->frame_samples > RV_CAPTURE_MAX_SAMPLES) {
@@ -363,6 +834,10 @@ rv_voice_t* rv_voice_create(const rv_voice_config_t* cfg,
 
     rv_eventq_init(&v->evq);
     rv_ring_init(&v->cap_q);
+    rv_vad_init(&v->vad, v->cfg.frame_ms, RV_VAD_HANGOVER_MS);
+    v->tx_gap = 1;
+    v->frames_per_packet = 1;
+    v->wire_ver = RV_PROTO_VER;
 
     // default local state: PTT up, radio off, channel 0
     memset(&v->local_state, 0, sizeof(v->local_state));
@@ -374,7 +849,7 @@ rv_voice_t* rv_voice_create(const rv_voice_config_t* cfg,
         return NULL;
     }
 
-    const uint32_t n = v->cfg.max_players;
+    const uint32_t n = rv_slot_count(v);
 
     v->dec           = (rv_opus_dec_t**)rv_alloc_mem(v, sizeof(rv_opus_dec_t*) * n);
     v->jb            = (rv_opus_jitter_t*)rv_alloc_mem(v, sizeof(rv_opus_jitter_t) * n);
@@ -383,8 +858,12 @@ rv_voice_t* rv_voice_create(const rv_voice_config_t* cfg,
     v->speaking      = (uint8_t*)rv_alloc_mem(v, sizeof(uint8_t) * n);
     v->last_rx_ms    = (uint32_t*)rv_alloc_mem(v, sizeof(uint32_t) * n);
     v->last_rx_flags = (uint8_t*)rv_alloc_mem(v, sizeof(uint8_t) * n);
+    v->rx_stats      = (rv_rx_stats_t*)rv_alloc_mem(v, sizeof(rv_rx_stats_t) * n);
+    v->peer_tx       = (rv_peer_tx_t*)rv_alloc_mem(v, sizeof(rv_peer_tx_t) * n);
+    v->rx_replay     = (rv_replay_t*)rv_alloc_mem(v, sizeof(rv_replay_t) * n);
 
-    if (!v->dec || !v->jb || !v->pcm_buf || !v->pcm_count || !v->speaking || !v->last_rx_ms || !v->last_rx_flags) {
+    if (!v->dec || !v->jb || !v->pcm_buf || !v->pcm_count || !v->speaking || !v->last_rx_ms || !v->last_rx_flags ||
+        !v->rx_stats || !v->peer_tx || !v->rx_replay) {
         rv_voice_destroy(v);
         return NULL;
     }
@@ -395,10 +874,13 @@ rv_voice_t* rv_voice_create(const rv_voice_config_t* cfg,
     memset(v->speaking, 0, sizeof(uint8_t) * n);
     memset(v->last_rx_ms, 0, sizeof(uint32_t) * n);
     memset(v->last_rx_flags, 0, sizeof(uint8_t) * n);
+    memset(v->peer_tx, 0, sizeof(rv_peer_tx_t) * n);
+    memset(v->rx_replay, 0, sizeof(rv_replay_t) * n);
 
     for (uint32_t i = 0; i < n; ++i) {
         v->dec[i] = rv_opus_dec_create(&v->opus_cfg);
         rv_opus_jitter_init(&v->jb[i]);
+        rv_rx_stats_init(&v->rx_stats[i]);
 
         v->pcm_buf[i] = (int16_t*)rv_alloc_mem(v, sizeof(int16_t) * v->frame_samples);
         if (!v->dec[i] || !v->pcm_buf[i]) {
@@ -416,15 +898,16 @@ void rv_voice_destroy(rv_voice_t* v) {
     if (!v) return;
 
     if (v->enc) rv_opus_enc_destroy(v->enc);
+    if (v->red_enc) rv_opus_enc_destroy(v->red_enc);
 
     if (v->dec) {
-        for (uint32_t i = 0; i < v->cfg.max_players; ++i) {
+        for (uint32_t i = 0; i < rv_slot_count(v); ++i) {
             if (v->dec[i]) rv_opus_dec_destroy(v->dec[i]);
         }
     }
 
     if (v->pcm_buf) {
-        for (uint32_t i = 0; i < v->cfg.max_players; ++i) {
+        for (uint32_t i = 0; i < rv_slot_count(v); ++i) {
             if (v->pcm_buf[i]) rv_free_mem(v, v->pcm_buf[i]);
         }
     }
@@ -436,7 +919,11 @@ void rv_voice_destroy(rv_voice_t* v) {
     rv_free_mem(v, v->speaking);
     rv_free_mem(v, v->last_rx_ms);
     rv_free_mem(v, v->last_rx_flags);
+    rv_free_mem(v, v->rx_stats);
+    rv_free_mem(v, v->peer_tx);
+    rv_free_mem(v, v->rx_replay);
 
+    rv_aead_key_wipe(&v->key);
     rv_free_mem(v, v);
 }
 
@@ -448,8 +935,11 @@ rv_voice_result_t rv_voice_connect(rv_voice_t* v, const rv_voice_connect_info_t*
     v->session_id = info->session_id;
     v->player_id  = info->player_id;
 
+    // v1 until the relay confirms every member of the session can parse v2
+    v->wire_ver = RV_PROTO_VER;
+
     uint8_t pkt[64];
-    int pkt_len = rv_build_join_packet(pkt, (int)sizeof(pkt), info->session_id, info->player_id);
+    int pkt_len = rv_build_join_packet(pkt, (int)sizeof(pkt), info->session_id, info->player_id, rv_join_caps(v));
     if (pkt_len <= 0) {
         rv_emit_error(v, RV_VOICE_ERR_INTERNAL, "rv_voice_connect: failed to build join packet");
         return RV_VOICE_ERR_INTERNAL;
@@ -461,6 +951,9 @@ rv_voice_result_t rv_voice_connect(rv_voice_t* v, const rv_voice_connect_info_t*
     }
 
     v->connected = 1;
+    v->interest_sent = 0;        // first tick after the JOIN sends it
+    v->keepalives = 0;
+    v->keepalive_clock_started = 0;
 
     rv_voice_event_t ev;
     memset(&ev, 0, sizeof(ev));
@@ -475,6 +968,10 @@ rv_voice_result_t rv_voice_disconnect(rv_voice_t* v) {
 
     v->connected = 0;
 
+    // frames waiting for a multi-frame packet are not sent
+    v->pack_count = 0;
+    v->tx_gap = 1;
+
     rv_voice_event_t ev;
     memset(&ev, 0, sizeof(ev));
     ev.type = RV_VOICE_EVENT_DISCONNECTED;
@@ -521,6 +1018,178 @@ rv_voice_result_t rv_voice_submit_capture_pcm(rv_voice_t* v,
     return rv_voice_submit_capture_pcm_async(v, samples, sample_count);
 }
 
+rv_voice_result_t rv_voice_set_encoder_params(rv_voice_t* v,
+                                              const rv_voice_encoder_params_t* params)
+{
+    if (!v || !params) return RV_VOICE_ERR_INVALID_ARGUMENT;
+    if (!v->initialized) return RV_VOICE_ERR_NOT_INITIALIZED;
+
+    if (params->bitrate_bps < 6000u || params->bitrate_bps > 510000u) return RV_VOICE_ERR_INVALID_ARGUMENT;
+    if (params->complexity > 10u) return RV_VOICE_ERR_INVALID_ARGUMENT;
+    if (params->expected_loss_pct > 100u) return RV_VOICE_ERR_INVALID_ARGUMENT;
+    if (params->signal_type > RV_VOICE_SIGNAL_MUSIC) return RV_VOICE_ERR_INVALID_ARGUMENT;
+
+    rv_opus_config_t want = *rv_opus_enc_config(v->enc);
+    want.bitrate_bps = (int)params->bitrate_bps;
+    want.complexity = (int)params->complexity;
+    want.use_fec = params->use_fec ? 1 : 0;
+    want.expected_loss_pct = (int)params->expected_loss_pct;
+    want.signal = (int)params->signal_type;
+
+    if (params->red_depth > RV_RED_MAX_DEPTH) return RV_VOICE_ERR_INVALID_ARGUMENT;
+    if (params->frames_per_packet > RV_PACK_MAX_FRAMES) return RV_VOICE_ERR_INVALID_ARGUMENT;
+
+    if (params->red_depth > 0 && !v->red_enc) {
+        rv_opus_config_t red_cfg = want;
+        red_cfg.bitrate_bps = RV_RED_BITRATE;
+        red_cfg.use_fec = 0;
+        red_cfg.use_dtx = 0;
+        v->red_enc = rv_opus_enc_create(&red_cfg);
+        if (!v->red_enc) {
+            rv_emit_error(v, RV_VOICE_ERR_OUT_OF_MEMORY, "rv_voice_set_encoder_params: RED encoder");
+            return RV_VOICE_ERR_OUT_OF_MEMORY;
+        }
+    }
+    v->red_depth = params->red_depth;
+
+    // Frames already waiting were encoded under the old packing
+    if (v->pack_count) (void)rv_flush_voice(v);
+    v->frames_per_packet = params->frames_per_packet ? params->frames_per_packet : 1u;
+
+    // Adaptive mode starts from the host's values and treats them as limits
+    v->enc_adaptive = params->adaptive ? 1 : 0;
+    if (v->enc_adaptive) rv_enc_ctl_init(&v->enc_ctl, v->cfg.frame_ms, &want, (int)params->red_depth);
+
+    if (rv_opus_enc_apply(v->enc, &want) != 0) {
+        rv_emit_error(v, RV_VOICE_ERR_INTERNAL, "rv_voice_set_encoder_params: opus rejected a setting");
+        return RV_VOICE_ERR_INTERNAL;
+    }
+
+    return RV_VOICE_OK;
+}
+
+rv_voice_result_t rv_voice_get_encoder_params(rv_voice_t* v,
+                                              rv_voice_encoder_params_t* out_params)
+{
+    if (!v || !out_params) return RV_VOICE_ERR_INVALID_ARGUMENT;
+    if (!v->initialized) return RV_VOICE_ERR_NOT_INITIALIZED;
+
+    const rv_opus_config_t* cur = rv_opus_enc_config(v->enc);
+
+    memset(out_params, 0, sizeof(*out_params));
+    out_params->bitrate_bps = (uint32_t)cur->bitrate_bps;
+    out_params->complexity = (uint32_t)cur->complexity;
+    out_params->use_fec = cur->use_fec ? 1u : 0u;
+    out_params->expected_loss_pct = (uint8_t)cur->expected_loss_pct;
+    out_params->signal_type = (uint8_t)cur->signal;
+    out_params->adaptive = v->enc_adaptive ? 1u : 0u;
+    out_params->red_depth = (uint8_t)rv_red_depth(v);
+    out_params->frames_per_packet = (uint8_t)v->frames_per_packet;
+    return RV_VOICE_OK;
+}
+
+rv_voice_result_t rv_voice_report_remote_loss(rv_voice_t* v, uint32_t loss_pct)
+{
+    if (!v || loss_pct > 100u) return RV_VOICE_ERR_INVALID_ARGUMENT;
+    if (!v->initialized) return RV_VOICE_ERR_NOT_INITIALIZED;
+    if (!v->enc_adaptive) return RV_VOICE_OK;
+
+    rv_enc_ctl_on_loss_report(&v->enc_ctl, (float)loss_pct / 100.0f);
+    rv_enc_ctl_apply(v);
+    return RV_VOICE_OK;
+}
+
+rv_voice_result_t rv_voice_set_session_key(rv_voice_t* v, const uint8_t* key, uint32_t key_len)
+{
+    if (!v) return RV_VOICE_ERR_INVALID_ARGUMENT;
+    if (!v->initialized) return RV_VOICE_ERR_NOT_INITIALIZED;
+    if (key && key_len != RV_VOICE_SESSION_KEY_BYTES) return RV_VOICE_ERR_INVALID_ARGUMENT;
+
+    // Frames already waiting go out under the key they were captured with
+    if (v->pack_count) (void)rv_flush_voice(v);
+
+    rv_aead_key_wipe(&v->key);
+    v->has_key = 0;
+    memset(v->rx_replay, 0, sizeof(rv_replay_t) * v->cfg.max_players);
+
+    if (key) {
+        rv_aead_key_init(&v->key, key);
+        v->has_key = 1;
+    }
+    return RV_VOICE_OK;
+}
+
+rv_voice_result_t rv_voice_set_interest(rv_voice_t* v, const rv_voice_interest_t* interest)
+{
+    if (!v || !interest) return RV_VOICE_ERR_INVALID_ARGUMENT;
+    if (!v->initialized) return RV_VOICE_ERR_NOT_INITIALIZED;
+
+    rv_interest_t in;
+    memset(&in, 0, sizeof(in));
+    in.channels = interest->radio_channel_mask;
+    if (interest->has_position) {
+        in.flags = RV_INTEREST_POS;
+        in.pos[0] = (int16_t)rv_interest_coord(interest->position.x, -32767.0f, 32767.0f);
+        in.pos[1] = (int16_t)rv_interest_coord(interest->position.y, -32767.0f, 32767.0f);
+        in.pos[2] = (int16_t)rv_interest_coord(interest->position.z, -32767.0f, 32767.0f);
+        // round up: the relay must not cut off someone we can still hear
+        if (interest->hearing_range > 0.0f)
+            in.range = (uint16_t)rv_interest_coord(interest->hearing_range + 0.5f, 1.0f, 65535.0f);
+    }
+
+    if (v->has_interest && memcmp(&in, &v->interest, sizeof(in)) == 0) return RV_VOICE_OK;
+    v->interest = in;
+    v->has_interest = 1;
+    v->interest_dirty = 1;
+    return RV_VOICE_OK;
+}
+
+rv_voice_result_t rv_voice_get_stats(rv_voice_t* v, rv_voice_stats_t* out_stats)
+{
+    if (!v || !out_stats) return RV_VOICE_ERR_INVALID_ARGUMENT;
+    if (!v->initialized) return RV_VOICE_ERR_NOT_INITIALIZED;
+
+    memset(out_stats, 0, sizeof(*out_stats));
+    out_stats->tx_packets = v->tx_packets;
+    out_stats->tx_bytes = v->tx_bytes;
+    out_stats->rx_packets = v->rx_packets;
+    out_stats->rx_bytes = v->rx_bytes;
+    out_stats->rx_auth_failures = v->rx_auth_failures;
+
+    for (uint32_t i = 0; i < v->cfg.max_players; ++i) {
+        const rv_peer_tx_t* p = &v->peer_tx[i];
+        if (!p->has_report || v->last_report_ms - p->last_report_ms > RV_REPORT_STALE_MS) continue;
+        if (p->loss_pct > out_stats->remote_loss_pct) out_stats->remote_loss_pct = p->loss_pct;
+        if (p->rtt_us > out_stats->rtt_us) out_stats->rtt_us = p->rtt_us;
+    }
+    return RV_VOICE_OK;
+}
+
+rv_voice_result_t rv_voice_get_peer_stats(rv_voice_t* v,
+                                          uint16_t speaker_id,
+                                          rv_voice_peer_stats_t* out_stats)
+{
+    if (!v || !out_stats) return RV_VOICE_ERR_INVALID_ARGUMENT;
+    if (!v->initialized) return RV_VOICE_ERR_NOT_INITIALIZED;
+    if (speaker_id == 0 || speaker_id > (uint16_t)v->cfg.max_players) return RV_VOICE_ERR_INVALID_ARGUMENT;
+
+    const rv_rx_stats_t* st = &v->rx_stats[speaker_id - 1u];
+    const rv_peer_tx_t* p = &v->peer_tx[speaker_id - 1u];
+
+    memset(out_stats, 0, sizeof(*out_stats));
+    out_stats->speaker_id = speaker_id;
+    out_stats->rx_loss_pct = (uint8_t)(((uint32_t)st->last_fraction * 100u + 128u) >> 8);
+    out_stats->rx_frames = st->received;
+    out_stats->rx_lost = rv_rx_stats_lost(st);
+    out_stats->rx_jitter_us = rv_rx_stats_jitter_us(st);
+
+    out_stats->tx_loss_pct = p->loss_pct;
+    out_stats->tx_lost = p->lost;
+    out_stats->tx_jitter_us = p->jitter_us;
+    out_stats->rtt_us = p->rtt_us;
+    return RV_VOICE_OK;
+}
+
 rv_voice_result_t rv_voice_ingest_packet(rv_voice_t* v,
                                         const uint8_t* data,
                                         uint32_t size,
@@ -529,27 +1198,108 @@ rv_voice_result_t rv_voice_ingest_packet(rv_voice_t* v,
     if (!v || !data || size == 0) return RV_VOICE_ERR_INVALID_ARGUMENT;
     if (!v->initialized) return RV_VOICE_ERR_NOT_INITIALIZED;
 
-    rv_pkt_hdr_t hdr;
-    if (rv_parse_packet_header(data, (int)size, &hdr) != 0)
+    rv_pkt_view_t pv;
+    if (rv_pkt_view_parse(data, (int)size, &pv) != 0)
         return RV_VOICE_OK;
 
-    if (hdr.type != RV_PKT_VOICE) return RV_VOICE_OK;
+    // The relay coalesced several datagrams for us; each goes through as
+    // if it had arrived alone
+    if (pv.type == RV_PKT_BUNDLE) {
+        uint32_t pos = 0;
+        const uint8_t* item = NULL;
+        uint16_t item_len = 0;
+        while (rv_pkt_view_bundle_next(&pv, &pos, &item, &item_len) == 1) {
+            rv_pkt_view_t iv;
+            if (rv_pkt_view_parse(item, item_len, &iv) != 0 || iv.type == RV_PKT_BUNDLE) continue;
+            (void)rv_voice_ingest_packet(v, item, item_len, now_ms);
+        }
+        return RV_VOICE_OK;
+    }
 
-    uint16_t speaker_id = 0, seq = 0;
-    uint8_t flags = 0;
-    const uint8_t* payload = NULL;
-    uint16_t payload_len = 0;
+    if (pv.type == RV_PKT_JOIN_ACK) {
+        uint8_t wire_ver = 0;
+        if (rv_pkt_view_join_ack(&pv, &wire_ver) == 0 &&
+            (wire_ver == RV_PROTO_VER || wire_ver == RV_PROTO_VER2))
+            v->wire_ver = wire_ver;
+        return RV_VOICE_OK;
+    }
 
-    if (rv_parse_voice_packet(data, (int)size, &speaker_id, &seq, &flags, &payload, &payload_len) != 0)
+    if (pv.type == RV_PKT_REPORT) {
+        rv_report_t rep;
+        if (rv_pkt_view_report(&pv, &rep) == 0 && rep.target_id == v->player_id)
+            rv_on_report(v, pv.speaker_id, &rep, now_ms);
         return RV_VOICE_OK;
+    }
+
+    if (pv.type != RV_PKT_VOICE) return RV_VOICE_OK;
 
-    if (speaker_id == 0 || speaker_id > (uint16_t)v->cfg.max_players)
+    if (pv.speaker_id > (uint16_t)v->cfg.max_players)
         return RV_VOICE_OK;
 
-    uint32_t idx = (uint32_t)(speaker_id - 1u);
+    // With a session key only sealed voice is accepted, and without one
+    // sealed voice cannot be played. A relay mix is never sealed.
+    uint8_t plain[RV_MAX_PKT_SIZE];
+    const int sealed = (pv.ext & RV_EXT_ENC) ? 1 : 0;
+    if (sealed != v->has_key) return RV_VOICE_OK;
+    if (sealed && pv.speaker_id == RV_VOICE_MIX_SPEAKER_ID) return RV_VOICE_OK;
+    if (sealed && rv_voice_open(v, &pv, plain, (uint32_t)sizeof(plain)) != 0) {
+        v->rx_auth_failures++;
+        return RV_VOICE_OK;
+    }
+
+    const uint64_t arrival_us = rv_time_now_us();
+    uint32_t ts_us = 0;
+    const int has_ts = rv_pkt_view_take_ts(&pv, &ts_us);
+    if (has_ts < 0) return RV_VOICE_OK;
+
+    const uint16_t speaker_id = pv.speaker_id;
+    const uint16_t seq = pv.seq;
+    const uint8_t flags = pv.flags;
+    const uint8_t* payload = pv.payload;
+    uint16_t payload_len = pv.payload_len;
+
+    const uint32_t idx = speaker_id == RV_VOICE_MIX_SPEAKER_ID ? v->cfg.max_players
+                                                               : (uint32_t)(speaker_id - 1u);
+
+    rv_red_block_t red[RV_RED_MAX_DEPTH];
+    int red_count = 0;
+    if (pv.ext & RV_EXT_RED) {
+        if (rv_parse_red_payload(payload, payload_len, red, RV_RED_MAX_DEPTH, &red_count,
+                                 &payload, &payload_len) != 0)
+            return RV_VOICE_OK;
+    }
+
+    if (flags & RV_FLAG_TALKSPURT) rv_opus_jitter_resync(&v->jb[idx], seq);
+
+    v->last_rx_flags[idx] = (uint8_t)(flags & ~RV_FLAG_TALKSPURT);
+
+    uint32_t frame_count = 1;
+    if ((payload[0] & 0x3u) == 0) {
+        rv_opus_jitter_push(&v->jb[idx], seq, payload, payload_len);
+    } else {
+        // Multi-frame packet: one jitter slot per frame, seq counts frames
+        uint8_t frames[RV_MAX_PKT_SIZE + RV_PACK_MAX_FRAMES];
+        uint16_t lens[RV_PACK_MAX_FRAMES];
+        int count = rv_opus_packet_split(payload, (int)payload_len, frames, (int)sizeof(frames),
+                                         lens, (int)RV_PACK_MAX_FRAMES);
+        if (count <= 0) return RV_VOICE_OK;
+
+        const uint8_t* f = frames;
+        for (int k = 0; k < count; ++k) {
+            rv_opus_jitter_push(&v->jb[idx], (uint16_t)(seq + k), f, lens[k]);
+            f += lens[k];
+        }
+        frame_count = (uint32_t)count;
+    }
+
+    rv_rx_stats_on_packet(&v->rx_stats[idx], seq, frame_count, has_ts, ts_us, arrival_us);
+    v->rx_packets++;
+    v->rx_bytes += size;
 
-    v->last_rx_flags[idx] = flags;
-    rv_opus_jitter_push(&v->jb[idx], seq, payload, payload_len);
+    for (int k = 0; k < red_count; ++k) {
+        rv_opus_jitter_push_redundant(&v->jb[idx], (uint16_t)(seq - red[k].seq_offset),
+                                      red[k].data, red[k].len);
+    }
     v->last_rx_ms[idx] = now_ms;
 
     if (!v->speaking[idx]) {
@@ -578,7 +1328,7 @@ rv_voice_result_t rv_voice_tick(rv_voice_t* v, uint32_t now_ms) {
     if (!v) return RV_VOICE_ERR_INVALID_ARGUMENT;
     if (!v->initialized) return RV_VOICE_ERR_NOT_INITIALIZED;
 
-    const uint32_t n = v->cfg.max_players;
+    const uint32_t n = rv_slot_count(v);
     const uint32_t speaking_timeout_ms = 250u;
 
     /* ------------------------------------------------------------
@@ -591,6 +1341,10 @@ rv_voice_result_t rv_voice_tick(rv_voice_t* v, uint32_t now_ms) {
         (void)rv_encode_and_queue_voice(v, f.samples, f.count);
     }
 
+    rv_report_tick(v, now_ms);
+    rv_interest_tick(v, now_ms);
+    rv_keepalive_tick(v, now_ms);
+
     /* ------------------------------------------------------------
        2) Decode incoming per-speaker frames -> emit PCM events
        ------------------------------------------------------------ */
@@ -604,22 +1358,23 @@ rv_voice_result_t rv_voice_tick(rv_voice_t* v, uint32_t now_ms) {
             rv_voice_event_t ev;
             memset(&ev, 0, sizeof(ev));
             ev.type = RV_VOICE_EVENT_SPEAKING;
-            ev.as.speaking.speaker_id = (uint16_t)(i + 1u);
+            ev.as.speaking.speaker_id = rv_slot_speaker(v, i);
             ev.as.speaking.is_speaking = 0;
             (void)rv_eventq_push(&v->evq, &ev);
         }
 
         const uint8_t* pkt = NULL;
         uint16_t pkt_len = 0;
+        uint8_t fec = 0;
 
-        if (!rv_opus_jitter_pop(&v->jb[i], &pkt, &pkt_len))
+        if (!rv_opus_jitter_pop(&v->jb[i], &pkt, &pkt_len, &fec))
             continue;
 
+        // fec => pkt is the successor of a lost frame; recover from its LBRR.
         // pkt==NULL && pkt_len==0 => PLC is allowed by your decoder; it should output comfort noise/silence
-        int decoded = rv_opus_decode(v->dec[i],
-                                     pkt, (int)pkt_len,
-                                     v->pcm_buf[i],
-                                     (int)v->frame_samples);
+        int decoded = fec
+            ? rv_opus_decode_fec(v->dec[i], pkt, (int)pkt_len, v->pcm_buf[i], (int)v->frame_samples)
+            : rv_opus_decode(v->dec[i], pkt, (int)pkt_len, v->pcm_buf[i], (int)v->frame_samples);
         if (decoded <= 0) continue;
 
         v->pcm_count[i] = (uint32_t)decoded;
@@ -630,7 +1385,7 @@ rv_voice_result_t rv_voice_tick(rv_voice_t* v, uint32_t now_ms) {
         rv_voice_event_t ev;
         memset(&ev, 0, sizeof(ev));
         ev.type = RV_VOICE_EVENT_PCM_FRAME;
-        ev.as.pcm.speaker_id = (uint16_t)(i + 1u);
+        ev.as.pcm.speaker_id = rv_slot_speaker(v, i);
         ev.as.pcm.sample_rate = v->cfg.sample_rate_hz;
         ev.as.pcm.channels = 1;
 
@@ -670,7 +1425,7 @@ int rv_voice_mix_output(rv_voice_t* v,
 
     memset(out_pcm, 0, sizeof(int16_t) * out_samples_per_ch);
 
-    const uint32_t n = v->cfg.max_players;
+    const uint32_t n = rv_slot_count(v);
     uint32_t any = 0;
 
     for (uint32_t i = 0; i < n; ++i) {